@@ -0,0 +1,151 @@
+#include <R.h>
+#include <Rinternals.h>
+
+#include "constants.h"
+
+SEXP tables_names_;
+SEXP columns_names_;
+SEXP constraints_names_;
+SEXP flat_constraints_names_;
+SEXP idx_cols_names_;
+SEXP fk_cols_names_;
+SEXP result_names_;
+SEXP flat_result_names_;
+SEXP script_names_;
+SEXP flat_script_names_;
+SEXP skipped_names_;
+SEXP db_names_;
+SEXP flat_db_names_;
+SEXP schema_names_;
+SEXP crawl_names_;
+SEXP flat_crawl_names_;
+SEXP files_names_;
+SEXP storage_names_;
+
+SEXP tbl_df_class_;
+SEXP factor_class_;
+
+SEXP order_levels_;
+SEXP conflict_levels_;
+SEXP fk_action_levels_;
+SEXP deferrable_levels_;
+SEXP con_type_levels_;
+
+SEXP table_types_;
+SEXP error_messages_;
+SEXP skip_reasons_;
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Create a preserved, immutable character vector
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP preserved_strings(const char **strs, int n) {
+  SEXP vec_ = PROTECT(allocVector(STRSXP, n));
+  for (int i = 0; i < n; i++) {
+    SET_STRING_ELT(vec_, i, mkChar(strs[i]));
+  }
+  R_PreserveObject(vec_);
+  MARK_NOT_MUTABLE(vec_);
+  UNPROTECT(1);
+  return vec_;
+}
+
+#define PRESERVED_STRINGS(...) \
+  preserved_strings((const char *[]){__VA_ARGS__}, sizeof((const char *[]){__VA_ARGS__}) / sizeof(const char *))
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Build all constants. Called from R_init_sqlitemeta()
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+void init_constants(void) {
+  
+  tables_names_ = PRESERVED_STRINGS(
+    "stmt_id", "name", "schema", "comment", "temporary", "if_not_exists", 
+    "without_rowid", "type", "current_name", "new_name", "error"
+  );
+  
+  columns_names_ = PRESERVED_STRINGS(
+    "stmt_id", "name", "type", "length", "constraint_name", "comment",
+    "primary_key", "auto_increment", "not_null", "unique",
+    "order_pk", "conflict_pk", "conflict_no_null", "conflict_unique",
+    "check_expr", "default_expr", "collate_name"
+  );
+  
+  constraints_names_ = PRESERVED_STRINGS(
+    "stmt_id", "name", "type", "idx_cols", "conflict_clause", "check_expr", 
+    "num_fk_cols", "fk_cols", "fk_table", "fk_num_cols", "fk_ref_cols", 
+    "fk_on_delete", "fk_on_update", "fk_match", "fk_deferrable"
+  );
+  
+  // 'idx_cols', 'fk_cols' and 'fk_ref_cols' hold offsets into the flat tables
+  flat_constraints_names_ = PRESERVED_STRINGS(
+    "stmt_id", "name", "type", "idx_cols", "num_idx_cols", "conflict_clause", 
+    "check_expr", "num_fk_cols", "fk_cols", "fk_table", "fk_num_cols", 
+    "fk_ref_cols", "fk_on_delete", "fk_on_update", "fk_match", "fk_deferrable"
+  );
+  
+  idx_cols_names_ = PRESERVED_STRINGS("name", "collate", "order");
+  fk_cols_names_  = PRESERVED_STRINGS("name");
+  
+  result_names_      = PRESERVED_STRINGS("tables", "columns", "constraints");
+  flat_result_names_ = PRESERVED_STRINGS("tables", "columns", "constraints", "idx_cols", "fk_cols");
+  script_names_      = PRESERVED_STRINGS("tables", "columns", "constraints", "skipped");
+  flat_script_names_ = PRESERVED_STRINGS("tables", "columns", "constraints", "idx_cols", "fk_cols", "skipped");
+  skipped_names_  = PRESERVED_STRINGS("stmt_id", "start", "end", "reason");
+  db_names_          = PRESERVED_STRINGS("tables", "columns", "constraints", "schema");
+  flat_db_names_     = PRESERVED_STRINGS("tables", "columns", "constraints", "idx_cols", "fk_cols", "schema");
+  schema_names_      = PRESERVED_STRINGS("stmt_id", "type", "name", "tbl_name", "rootpage", "sql");
+  crawl_names_       = PRESERVED_STRINGS("tables", "columns", "constraints", "schema", "files");
+  flat_crawl_names_  = PRESERVED_STRINGS("tables", "columns", "constraints", "idx_cols", "fk_cols", "schema", "files");
+  files_names_       = PRESERVED_STRINGS("file_id", "path", "error");
+  
+  storage_names_ = PRESERVED_STRINGS(
+    "stmt_id", "type", "name", "tbl_name", "rootpage", "origin", "without_rowid",
+    "num_columns", "num_constraints", "entries", "depth", "interior_pages", 
+    "leaf_pages", "overflow_pages", "total_pages", "payload_bytes", "avg_payload",
+    "max_payload", "overflow_entries", "unused_bytes", "fill_factor", "error"
+  );
+  
+  tbl_df_class_ = PRESERVED_STRINGS("tbl_df", "tbl", "data.frame");
+  factor_class_ = PRESERVED_STRINGS("factor");
+  
+  order_levels_ = PRESERVED_STRINGS("none", "ascending", "descending");
+  
+  // SQL3CONFLICT_NONE, SQL3CONFLICT_ROLLBACK, SQL3CONFLICT_ABORT,
+  // SQL3CONFLICT_FAIL, SQL3CONFLICT_IGNORE, SQL3CONFLICT_REPLACE
+  conflict_levels_ = PRESERVED_STRINGS(
+    "none", "rollback", "abort", "fail", "ignore", "replace"
+  );
+  
+  // SQL3FKACTION_NONE, SQL3FKACTION_SETNULL, SQL3FKACTION_SETDEFAULT,
+  // SQL3FKACTION_CASCADE, SQL3FKACTION_RESTRICT, SQL3FKACTION_NOACTION
+  fk_action_levels_ = PRESERVED_STRINGS(
+    "none", "set null", "set default", "cascade", "restrict", "no action"
+  );
+  
+  // SQL3DEFTYPE_NONE, SQL3DEFTYPE_DEFERRABLE, 
+  // SQL3DEFTYPE_DEFERRABLE_INITIALLY_DEFERRED, SQL3DEFTYPE_DEFERRABLE_INITIALLY_IMMEDIATE, 
+  // SQL3DEFTYPE_NOTDEFERRABLE, 
+  // SQL3DEFTYPE_NOTDEFERRABLE_INITIALLY_DEFERRED, SQL3DEFTYPE_NOTDEFERRABLE_INITIALLY_IMMEDIATE
+  deferrable_levels_ = PRESERVED_STRINGS(
+    "none", "deferrable", 
+    "deferrable initially deferred", "deferrable initially immediate",
+    "not deferrable",
+    "not deferrable initially deferred", "not deferrable initially immediate"
+  );
+  
+  // SQL3TABLECONSTRAINT_PRIMARYKEY, SQL3TABLECONSTRAINT_UNIQUE,
+  // SQL3TABLECONSTRAINT_CHECK, SQL3TABLECONSTRAINT_FOREIGNKEY
+  con_type_levels_ = PRESERVED_STRINGS("primary key", "unique", "check", "foreign key");
+  
+  table_types_ = PRESERVED_STRINGS(
+    "unknown", "table", "rename table", "rename column", "add column", "drop column"
+  );
+  
+  // SQL3ERROR_SYNTAX, SQL3ERROR_UNSUPPORTEDSQL, SQL3ERROR_MEMORY, anything else
+  error_messages_ = PRESERVED_STRINGS(
+    "syntax error", "unsupported statement", "out of memory", "empty statement"
+  );
+  
+  skip_reasons_ = PRESERVED_STRINGS("not a table statement", "syntax error");
+}
@@ -0,0 +1,55 @@
+#ifndef CONSTANTS_H
+#define CONSTANTS_H
+
+#include <R.h>
+#include <Rinternals.h>
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Constant SEXPs shared by every result.
+// Built once by init_constants() when the package is loaded, preserved
+// for the lifetime of the session and marked as not mutable so R copies
+// them before any modification
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// names of data.frames and lists
+extern SEXP tables_names_;
+extern SEXP columns_names_;
+extern SEXP constraints_names_;
+extern SEXP flat_constraints_names_;
+extern SEXP idx_cols_names_;
+extern SEXP fk_cols_names_;
+extern SEXP result_names_;
+extern SEXP flat_result_names_;
+extern SEXP script_names_;
+extern SEXP flat_script_names_;
+extern SEXP skipped_names_;
+extern SEXP db_names_;
+extern SEXP flat_db_names_;
+extern SEXP schema_names_;
+extern SEXP crawl_names_;
+extern SEXP flat_crawl_names_;
+extern SEXP files_names_;
+extern SEXP storage_names_;
+
+// classes
+extern SEXP tbl_df_class_;
+extern SEXP factor_class_;
+
+// factor levels
+extern SEXP order_levels_;
+extern SEXP conflict_levels_;
+extern SEXP fk_action_levels_;
+extern SEXP deferrable_levels_;
+extern SEXP con_type_levels_;
+
+// CHARSXPs for the 'type' of a table statement (indexed by sql3statement_type)
+extern SEXP table_types_;
+
+// CHARSXPs for the 'error' of a failed statement and the 'reason' a script
+// statement was skipped
+extern SEXP error_messages_;
+extern SEXP skip_reasons_;
+
+void init_constants(void);
+
+#endif
@@ -0,0 +1,1345 @@
+#include <R.h>
+#include <Rinternals.h>
+#include <Rdefines.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "sql3parse_table.h"
+#include "sql3db.h"
+#include "table-parser.h"
+#include "constants.h"
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Finalizer for a database file wrapped in an external pointer.
+// The file is normally closed explicitly at the end of the .Call, this
+// only catches the case where an R error longjmps out of the conversion
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static void db_finalizer(SEXP db_) {
+  sql3db *db = (sql3db *)R_ExternalPtrAddr(db_);
+  if (db != NULL) {
+    sql3db_close(db);
+    R_ClearExternalPtr(db_);
+  }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Open the database file at 'path' (a single string) as an external pointer
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP db_open(SEXP path_) {
+  
+  if (!isString(path_) || length(path_) != 1 || STRING_ELT(path_, 0) == NA_STRING) {
+    error("'path' must be a single character string");
+  }
+  const char *path = R_ExpandFileName(translateChar(STRING_ELT(path_, 0)));
+  
+  sql3db_error err;
+  sql3db *db = sql3db_open(path, &err);
+  if (db == NULL) {
+    error("Couldn't read '%s': %s", path, sql3db_errmsg(err));
+  }
+  
+  SEXP db_ = PROTECT(R_MakeExternalPtr(db, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(db_, db_finalizer, FALSE);
+  UNPROTECT(1);
+  return db_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Rows of sqlite_schema.
+// The strings handed to the callback only live as long as the callback, so
+// they are copied. Memory comes from R_alloc() and is reclaimed at the end
+// of the .Call
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  sql3db_schema_entry *entries;
+  size_t               count;
+  size_t               capacity;
+  size_t               ntables;
+} schema_result;
+
+
+static sql3string schema_copy(sql3string str) {
+  if (str.ptr == NULL) {
+    return str;
+  }
+  char *ptr = R_alloc(str.length + 1, 1);
+  memcpy(ptr, str.ptr, str.length);
+  ptr[str.length] = '\0';
+  str.ptr = ptr;
+  return str;
+}
+
+
+static bool is_table_entry(const sql3db_schema_entry *entry) {
+  return entry->sql.ptr != NULL && entry->type.length == 5 && memcmp(entry->type.ptr, "table", 5) == 0;
+}
+
+
+static bool schema_callback(void *xdata, const sql3db_schema_entry *entry) {
+  schema_result *res = (schema_result *)xdata;
+  
+  if (res->count == res->capacity) {
+    size_t capacity = (res->capacity == 0) ? 64 : res->capacity * 2;
+    res->entries = (sql3db_schema_entry *)S_realloc((char *)res->entries, (long)capacity, (long)res->capacity, sizeof(sql3db_schema_entry));
+    res->capacity = capacity;
+  }
+  
+  sql3db_schema_entry *copy = &res->entries[res->count++];
+  copy->rowid    = entry->rowid;
+  copy->type     = schema_copy(entry->type);
+  copy->name     = schema_copy(entry->name);
+  copy->tbl_name = schema_copy(entry->tbl_name);
+  copy->rootpage = entry->rootpage;
+  copy->sql      = schema_copy(entry->sql);
+  
+  if (is_table_entry(copy)) res->ntables++;
+  return true;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// 'schema' data.frame with one row per entry of sqlite_schema.
+// Root pages are doubles as page numbers are unsigned 32-bit integers
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP schema_to_df(const schema_result *res) {
+  
+  unsigned int nprotect = 0;
+  R_xlen_t N = (R_xlen_t)res->count;
+  
+  SEXP df_ = PROTECT(allocVector(VECSXP, 6)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, schema_names_);
+  
+  SEXP stmt_id_  = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP type_     = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP name_     = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP tbl_name_ = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP rootpage_ = PROTECT(allocVector(REALSXP, N)); nprotect++;
+  SEXP sql_      = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  
+  SET_VECTOR_ELT(df_, 0, stmt_id_);
+  SET_VECTOR_ELT(df_, 1, type_);
+  SET_VECTOR_ELT(df_, 2, name_);
+  SET_VECTOR_ELT(df_, 3, tbl_name_);
+  SET_VECTOR_ELT(df_, 4, rootpage_);
+  SET_VECTOR_ELT(df_, 5, sql_);
+  
+  for (R_xlen_t i = 0; i < N; i++) {
+    const sql3db_schema_entry *entry = &res->entries[i];
+    INTEGER(stmt_id_)[i] = (int)(i + 1);
+    SET_STRING_ELT(type_    , i, rchr(entry->type));
+    SET_STRING_ELT(name_    , i, rchr(entry->name));
+    SET_STRING_ELT(tbl_name_, i, rchr(entry->tbl_name));
+    REAL(rootpage_)[i] = (double)entry->rootpage;
+    SET_STRING_ELT(sql_     , i, rchr(entry->sql));
+  }
+  
+  list_to_df(df_, N);
+  
+  UNPROTECT(nprotect);
+  return df_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Read and parse the schema of a SQLite database file
+//
+// The sqlite_schema table b-tree is walked directly from page 1 of the
+// file, without libsqlite or a connection. The 'sql' of every table is
+// parsed as with parse_()
+//
+// @param path_ path to the database file
+// @param flat_,fields_ see parse_script_()
+// @return list with the 'tables', 'columns' and 'constraints' data.frames of
+//         the tables and 'schema' (every row of sqlite_schema). 'stmt_id'
+//         is the row of the table in 'schema'
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP read_schema_(SEXP path_, SEXP flat_, SEXP fields_) {
+  
+  unsigned int nprotect = 0;
+  
+  int flat = asLogical(flat_);
+  if (flat == NA_LOGICAL) {
+    error("'flat' must be TRUE or FALSE");
+  }
+  unsigned fields = parse_fields(fields_);
+  
+  SEXP db_ = PROTECT(db_open(path_)); nprotect++;
+  sql3db *db = (sql3db *)R_ExternalPtrAddr(db_);
+  
+  schema_result res = {0};
+  sql3db_error err = sql3db_read_schema(db, schema_callback, &res);
+  db_finalizer(db_);
+  if (err != SQL3DB_OK) {
+    error("Couldn't read the schema of '%s': %s", translateChar(STRING_ELT(path_, 0)), sql3db_errmsg(err));
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Parse the tables. The tables are views into the R_alloc() copies
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parser_ = PROTECT(parser_create()); nprotect++;
+  sql3parser *parser = (sql3parser *)R_ExternalPtrAddr(parser_);
+  sql3parser_set_fields(parser, fields);
+  
+  sql3table     **tables   = (sql3table **)    R_alloc(res.ntables, sizeof(sql3table *));
+  sql3error_code *errors   = (sql3error_code *)R_alloc(res.ntables, sizeof(sql3error_code));
+  int            *stmt_ids = (int *)           R_alloc(res.ntables, sizeof(int));
+  
+  size_t table_idx = 0;
+  for (size_t i = 0; i < res.count; i++) {
+    const sql3db_schema_entry *entry = &res.entries[i];
+    if (!is_table_entry(entry)) continue;
+  
+    tables[table_idx] = sql3parser_parse(parser, entry->sql.ptr, entry->sql.length, &errors[table_idx]);
+    if (errors[table_idx] == SQL3ERROR_MEMORY) {
+      parser_release(parser_);
+      error("Out of memory while parsing sql");
+    }
+    stmt_ids[table_idx] = (int)(i + 1);
+    table_idx++;
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Result: the same data.frames as parse_sql() plus the 'schema'
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parsed_ = PROTECT(parse_result(tables, stmt_ids, errors, (R_xlen_t)res.ntables, flat, R_NilValue)); nprotect++;
+  int nparsed = length(parsed_);
+  
+  SEXP res_ = PROTECT(allocVector(VECSXP, nparsed + 1)); nprotect++;
+  setAttrib(res_, R_NamesSymbol, flat ? flat_db_names_ : db_names_);
+  for (int i = 0; i < nparsed; i++) {
+    SET_VECTOR_ELT(res_, i, VECTOR_ELT(parsed_, i));
+  }
+  SET_VECTOR_ELT(res_, nparsed, schema_to_df(&res));
+  
+  parser_release(parser_);
+  UNPROTECT(nprotect);
+  return res_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Schemas read by the crawler.
+// The files are read and parsed on worker threads into malloc()ed memory,
+// owned by an external pointer so it is released even if an R error 
+// longjmps out of the conversion
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  sql3db_schema_file *files;
+  size_t              count;
+} crawl_state;
+
+
+static void crawl_finalizer(SEXP crawl_) {
+  crawl_state *state = (crawl_state *)R_ExternalPtrAddr(crawl_);
+  if (state != NULL) {
+    for (size_t i = 0; i < state->count; i++) {
+      sql3db_schema_file_clear(&state->files[i]);
+    }
+    free(state->files);
+    free(state);
+    R_ClearExternalPtr(crawl_);
+  }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Copy of a data.frame keyed by 'stmt_id' with a leading 'file_id' column
+//
+// @param stmt_files file id of every statement, indexed by stmt_id - 1
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP df_add_file_id(SEXP df_, const int *stmt_files) {
+  
+  unsigned int nprotect = 0;
+  
+  SEXP names_   = getAttrib(df_, R_NamesSymbol);
+  SEXP stmt_id_ = VECTOR_ELT(df_, 0);
+  int ncols     = length(df_);
+  R_xlen_t N    = xlength(stmt_id_);
+  
+  SEXP res_       = PROTECT(allocVector(VECSXP, ncols + 1)); nprotect++;
+  SEXP res_names_ = PROTECT(allocVector(STRSXP, ncols + 1)); nprotect++;
+  SEXP file_id_   = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  
+  for (R_xlen_t i = 0; i < N; i++) {
+    INTEGER(file_id_)[i] = stmt_files[INTEGER(stmt_id_)[i] - 1];
+  }
+  
+  SET_VECTOR_ELT(res_, 0, file_id_);
+  SET_STRING_ELT(res_names_, 0, mkChar("file_id"));
+  for (int j = 0; j < ncols; j++) {
+    SET_VECTOR_ELT(res_, j + 1, VECTOR_ELT(df_, j));
+    SET_STRING_ELT(res_names_, j + 1, STRING_ELT(names_, j));
+  }
+  setAttrib(res_, R_NamesSymbol, res_names_);
+  list_to_df(res_, N);
+  
+  UNPROTECT(nprotect);
+  return res_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Read and parse the schemas of many SQLite database files
+//
+// The files are opened, their schema read and parsed on a pool of 
+// 'threads' workers, each with its own parser. Only the header and the 
+// pages of the sqlite_schema b-tree of each file are touched. R objects are
+// created afterwards on the main thread. A file which can't be read is 
+// reported in the 'files' data.frame and doesn't stop the crawl
+//
+// @param paths_ character vector of paths to database files
+// @param threads_ number of threads to use
+// @param flat_,fields_ see parse_script_()
+// @return list with the 'tables', 'columns', 'constraints' and 'schema'
+//         data.frames of read_schema_() for all files with a leading
+//         'file_id' column, and 'files' (one row per file). 'stmt_id' is the
+//         row in the combined 'schema'
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP crawl_schemas_(SEXP paths_, SEXP threads_, SEXP flat_, SEXP fields_) {
+  
+  unsigned int nprotect = 0;
+  
+  if (!isString(paths_)) {
+    error("'paths' must be a character vector");
+  }
+  
+  R_xlen_t nfiles = xlength(paths_);
+  int nthreads = asInteger(threads_);
+  if (nthreads == NA_INTEGER || nthreads < 1) {
+    error("'threads' must be a positive integer");
+  }
+  int flat = asLogical(flat_);
+  if (flat == NA_LOGICAL) {
+    error("'flat' must be TRUE or FALSE");
+  }
+  unsigned fields = parse_fields(fields_);
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // One parser per thread
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parsers_ = PROTECT(allocVector(VECSXP, nthreads)); nprotect++;
+  sql3parser **parsers = (sql3parser **)R_alloc(nthreads, sizeof(sql3parser *));
+  for (int i = 0; i < nthreads; i++) {
+    SET_VECTOR_ELT(parsers_, i, parser_create());
+    parsers[i] = (sql3parser *)R_ExternalPtrAddr(VECTOR_ELT(parsers_, i));
+    sql3parser_set_fields(parsers[i], fields);
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Gather the paths on the main thread. R_ExpandFileName() returns a 
+  // static buffer so every path is copied
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  const char **paths = (const char **)R_alloc(nfiles, sizeof(const char *));
+  for (R_xlen_t i = 0; i < nfiles; i++) {
+    SEXP path_ = STRING_ELT(paths_, i);
+    const char *path = (path_ == NA_STRING) ? "" : R_ExpandFileName(translateChar(path_));
+    char *copy = R_alloc(strlen(path) + 1, 1);
+    strcpy(copy, path);
+    paths[i] = copy;
+  }
+  
+  crawl_state *state = (crawl_state *)calloc(1, sizeof(crawl_state));
+  if (state == NULL) {
+    error("Couldn't allocate the crawl");
+  }
+  SEXP crawl_ = PROTECT(R_MakeExternalPtr(state, R_NilValue, R_NilValue)); nprotect++;
+  R_RegisterCFinalizerEx(crawl_, crawl_finalizer, FALSE);
+  
+  state->files = (sql3db_schema_file *)calloc((size_t)nfiles + 1, sizeof(sql3db_schema_file));
+  if (state->files == NULL) {
+    error("Couldn't allocate the crawl");
+  }
+  state->count = (size_t)nfiles;
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Read and parse. No R API calls are allowed until all workers have finished
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  sql3db_crawl_schemas(paths, (size_t)nfiles, parsers, (size_t)nthreads, state->files);
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Combine the files. Statement ids are rows of the combined 'schema'
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  schema_result res = {0};
+  for (R_xlen_t i = 0; i < nfiles; i++) {
+    const sql3db_schema_file *file = &state->files[i];
+    res.count += file->count;
+    for (size_t j = 0; j < file->count; j++) {
+      if (file->tables[j] != NULL || file->errors[j] != SQL3ERROR_NONE) res.ntables++;
+    }
+  }
+  
+  res.entries = (sql3db_schema_entry *)R_alloc(res.count, sizeof(sql3db_schema_entry));
+  int            *stmt_files = (int *)           R_alloc(res.count, sizeof(int));
+  sql3table     **tables     = (sql3table **)    R_alloc(res.ntables, sizeof(sql3table *));
+  sql3error_code *errors     = (sql3error_code *)R_alloc(res.ntables, sizeof(sql3error_code));
+  int            *stmt_ids   = (int *)           R_alloc(res.ntables, sizeof(int));
+  
+  size_t entry_idx = 0, table_idx = 0;
+  for (R_xlen_t i = 0; i < nfiles; i++) {
+    const sql3db_schema_file *file = &state->files[i];
+    for (size_t j = 0; j < file->count; j++) {
+      res.entries[entry_idx] = file->entries[j];
+      stmt_files [entry_idx] = (int)(i + 1);
+      entry_idx++;
+      
+      if (file->tables[j] != NULL || file->errors[j] != SQL3ERROR_NONE) {
+        tables  [table_idx] = file->tables[j];
+        errors  [table_idx] = file->errors[j];
+        stmt_ids[table_idx] = (int)entry_idx;
+        table_idx++;
+      }
+    }
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // 'files' data.frame
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP files_ = PROTECT(allocVector(VECSXP, 3)); nprotect++;
+  setAttrib(files_, R_NamesSymbol, files_names_);
+  
+  SEXP file_id_ = PROTECT(allocVector(INTSXP, nfiles)); nprotect++;
+  SEXP path_    = PROTECT(allocVector(STRSXP, nfiles)); nprotect++;
+  SEXP error_   = PROTECT(allocVector(STRSXP, nfiles)); nprotect++;
+  SET_VECTOR_ELT(files_, 0, file_id_);
+  SET_VECTOR_ELT(files_, 1, path_);
+  SET_VECTOR_ELT(files_, 2, error_);
+  
+  for (R_xlen_t i = 0; i < nfiles; i++) {
+    sql3db_error err = state->files[i].error;
+    INTEGER(file_id_)[i] = (int)(i + 1);
+    SET_STRING_ELT(path_ , i, STRING_ELT(paths_, i));
+    SET_STRING_ELT(error_, i, err == SQL3DB_OK ? NA_STRING : mkChar(sql3db_errmsg(err)));
+  }
+  list_to_df(files_, nfiles);
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Result: the data.frames of parse_sql() and 'schema' with the file ids,
+  // plus the 'files'
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parsed_ = PROTECT(parse_result(tables, stmt_ids, errors, (R_xlen_t)res.ntables, flat, R_NilValue)); nprotect++;
+  int nparsed = length(parsed_);
+  
+  SEXP res_ = PROTECT(allocVector(VECSXP, nparsed + 2)); nprotect++;
+  setAttrib(res_, R_NamesSymbol, flat ? flat_crawl_names_ : crawl_names_);
+  for (int i = 0; i < nparsed; i++) {
+    SEXP df_ = VECTOR_ELT(parsed_, i);
+    // the flat idx_cols and fk_cols are keyed by offsets, not statements
+    SET_VECTOR_ELT(res_, i, i < 3 ? df_add_file_id(df_, stmt_files) : df_);
+  }
+  SEXP schema_ = PROTECT(schema_to_df(&res)); nprotect++;
+  SET_VECTOR_ELT(res_, nparsed    , df_add_file_id(schema_, stmt_files));
+  SET_VECTOR_ELT(res_, nparsed + 1, files_);
+  
+  crawl_finalizer(crawl_);
+  for (int i = 0; i < nthreads; i++) {
+    parser_release(VECTOR_ELT(parsers_, i));
+  }
+  UNPROTECT(nprotect);
+  return res_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Read the stamp of a SQLite database file: its change counter and schema
+// cookie, with a single small read of the header (or from the -wal file
+// for a database in WAL mode)
+//
+// @param path_ path to the database file
+// @return numeric vector c(change_counter, schema_cookie)
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP read_stamp_(SEXP path_) {
+  
+  if (!isString(path_) || length(path_) != 1 || STRING_ELT(path_, 0) == NA_STRING) {
+    error("'path' must be a single character string");
+  }
+  const char *path = R_ExpandFileName(translateChar(STRING_ELT(path_, 0)));
+  
+  uint32_t change_counter, schema_cookie;
+  sql3db_error err = sql3db_read_stamp(path, &change_counter, &schema_cookie);
+  if (err != SQL3DB_OK) {
+    error("Couldn't read '%s': %s", path, sql3db_errmsg(err));
+  }
+  
+  SEXP stamp_ = PROTECT(allocVector(REALSXP, 2));
+  REAL(stamp_)[0] = (double)change_counter;
+  REAL(stamp_)[1] = (double)schema_cookie;
+  UNPROTECT(1);
+  return stamp_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Lookup of a single table in sqlite_schema by name (case insensitive for
+// ASCII letters, as in SQLite). The entry is copied with R_alloc()
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  sql3string          name;
+  sql3db_schema_entry entry;
+  bool                found;
+} table_lookup;
+
+
+static bool name_equal(sql3string a, sql3string b) {
+  if (a.ptr == NULL || b.ptr == NULL || a.length != b.length) {
+    return false;
+  }
+  for (size_t i = 0; i < a.length; i++) {
+    char ca = a.ptr[i], cb = b.ptr[i];
+    if (ca >= 'A' && ca <= 'Z') ca += 'a' - 'A';
+    if (cb >= 'A' && cb <= 'Z') cb += 'a' - 'A';
+    if (ca != cb) return false;
+  }
+  return true;
+}
+
+
+static bool lookup_callback(void *xdata, const sql3db_schema_entry *entry) {
+  table_lookup *lookup = (table_lookup *)xdata;
+  
+  if (!is_table_entry(entry) || !name_equal(entry->name, lookup->name)) {
+    return true;
+  }
+  
+  lookup->entry          = *entry;
+  lookup->entry.type     = schema_copy(entry->type);
+  lookup->entry.name     = schema_copy(entry->name);
+  lookup->entry.tbl_name = schema_copy(entry->tbl_name);
+  lookup->entry.sql      = schema_copy(entry->sql);
+  lookup->found = true;
+  return false;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Rows of a table decoded into R vectors.
+// Each column starts with the R type of the affinity of its declared type
+// and is widened (integer -> double -> character) the first time a value
+// doesn't fit, as SQLite doesn't enforce declared types. Columns without
+// affinity are lists holding every value as its own R vector
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  SEXPTYPE     type;
+  int          field;      // position of the value in the record
+  bool         is_rowid;   // INTEGER PRIMARY KEY column, stored as the rowid
+  sql3db_value missing;    // value of records written before the column was added
+  R_xlen_t     nblobs;     // blobs stored as NA in atomic vectors
+} table_column;
+
+typedef struct {
+  SEXP             df_;
+  table_column    *columns;
+  int              ncols;
+  sql3db_value    *values;
+  sql3db_encoding  encoding;
+  R_xlen_t         nrows;
+  R_xlen_t         capacity;
+  bool             corrupt;
+  char            *buffer;   // UTF-8 copies of UTF-16 text
+  size_t           buffer_size;
+} table_reader;
+
+
+static bool type_contains(sql3string type, const char *word) {
+  size_t n = strlen(word);
+  for (size_t i = 0; i + n <= type.length; i++) {
+    size_t j = 0;
+    while (j < n && (type.ptr[i + j] & ~0x20) == word[j]) j++;
+    if (j == n) return true;
+  }
+  return false;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// R type for the affinity of a declared type (the rules of section 3.1 of
+// https://www.sqlite.org/datatype3.html). NUMERIC columns mostly hold
+// integers (booleans, dates as numbers) so they start as integer vectors
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXPTYPE affinity_type(sql3table *table, sql3column *column) {
+  sql3string type = sql3column_type(column);
+  
+  if (type.ptr == NULL || type.length == 0)  return VECSXP;
+  if (type_contains(type, "INT"))            return INTSXP;
+  if (type_contains(type, "CHAR") || type_contains(type, "CLOB") || type_contains(type, "TEXT")) return STRSXP;
+  if (type_contains(type, "BLOB"))           return VECSXP;
+  if (type_contains(type, "REAL") || type_contains(type, "FLOA") || type_contains(type, "DOUB")) return REALSXP;
+  if (sql3table_is_strict(table) && type.length == 3 && type_contains(type, "ANY")) return VECSXP;
+  return INTSXP;
+}
+
+
+static bool is_integer_type(sql3column *column) {
+  sql3string type = sql3column_type(column);
+  sql3string length = sql3column_length(column);
+  return type.ptr != NULL && type.length == 7 && type_contains(type, "INTEGER") && 
+    (length.ptr == NULL || length.length == 0);
+}
+
+
+static int column_index(sql3table *table, sql3string name) {
+  size_t ncols = sql3table_num_columns(table);
+  for (size_t i = 0; i < ncols; i++) {
+    if (name_equal(sql3column_name(sql3table_get_column(table, i)), name)) return (int)i;
+  }
+  return -1;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Columns of the primary key in key order, returns the number of columns.
+// A column level PRIMARY KEY is flagged in 'desc' when declared DESC
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static int primary_key(sql3table *table, int *pk, bool *desc) {
+  size_t ncols = sql3table_num_columns(table);
+  *desc = false;
+  
+  for (size_t i = 0; i < ncols; i++) {
+    sql3column *column = sql3table_get_column(table, i);
+    if (sql3column_is_primarykey(column)) {
+      pk[0] = (int)i;
+      *desc = sql3column_pk_order(column) == SQL3ORDER_DESC;
+      return 1;
+    }
+  }
+  
+  size_t ncons = sql3table_num_constraints(table);
+  for (size_t i = 0; i < ncons; i++) {
+    sql3tableconstraint *constraint = sql3table_get_constraint(table, i);
+    if (sql3table_constraint_type(constraint) != SQL3TABLECONSTRAINT_PRIMARYKEY) continue;
+    
+    // a column listed twice is only stored once
+    int n = 0;
+    size_t nidx = sql3table_constraint_num_idxcolumns(constraint);
+    for (size_t j = 0; j < nidx; j++) {
+      int col = column_index(table, sql3idxcolumn_name(sql3table_constraint_get_idxcolumn(constraint, j)));
+      bool seen = col < 0;
+      for (int k = 0; k < n && !seen; k++) seen = pk[k] == col;
+      if (!seen) pk[n++] = col;
+    }
+    return n;
+  }
+  
+  return 0;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// DEFAULT of a column as a value. Columns added by ALTER TABLE ADD COLUMN 
+// are missing from older records, which then read as the default. SQLite
+// only accepts constant defaults there: literals are decoded, anything 
+// else reads as NULL
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static sql3db_value default_value(sql3column *column) {
+  sql3db_value value = {.type = SQL3DB_NULL};
+  sql3string expr = sql3column_default_expr(column);
+  if (expr.ptr == NULL || expr.length == 0) {
+    return value;
+  }
+  
+  // string literal, doubled quotes are escaped quotes
+  if (expr.ptr[0] == '\'' && expr.length >= 2 && expr.ptr[expr.length - 1] == '\'') {
+    char *text = R_alloc(expr.length, 1);
+    size_t n = 0;
+    for (size_t i = 1; i < expr.length - 1; i++) {
+      text[n++] = expr.ptr[i];
+      if (expr.ptr[i] == '\'') i++;
+    }
+    value.type   = SQL3DB_TEXT;
+    value.ptr    = text;
+    value.length = n;
+    return value;
+  }
+  
+  if (expr.length == 4 && type_contains(expr, "TRUE")) {
+    value.type = SQL3DB_INTEGER;
+    value.integer = 1;
+    return value;
+  }
+  if (expr.length == 5 && type_contains(expr, "FALSE")) {
+    value.type = SQL3DB_INTEGER;
+    value.integer = 0;
+    return value;
+  }
+  
+  // numeric literal: an integer if it has no fraction or exponent and fits
+  char *num = R_alloc(expr.length + 1, 1);
+  memcpy(num, expr.ptr, expr.length);
+  num[expr.length] = '\0';
+  
+  char *end;
+  errno = 0;
+  long long integer = strtoll(num, &end, 10);
+  if (end != num && *end == '\0' && errno == 0) {
+    value.type = SQL3DB_INTEGER;
+    value.integer = (int64_t)integer;
+    return value;
+  }
+  double real = strtod(num, &end);
+  if (end != num && *end == '\0') {
+    value.type = SQL3DB_FLOAT;
+    value.real = real;
+  }
+  return value;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Map the columns of the table to the values of its records.
+// Rowid tables store every column in declaration order, with NULL in place
+// of an INTEGER PRIMARY KEY which is the rowid itself. WITHOUT ROWID tables
+// store the primary key columns first, then the others
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static void table_plan(sql3table *table, table_column *columns) {
+  int ncols = (int)sql3table_num_columns(table);
+  bool without_rowid = sql3table_is_withoutrowid(table);
+  
+  int *pk = (int *)R_alloc(ncols, sizeof(int));
+  bool desc;
+  int npk = primary_key(table, pk, &desc);
+  
+  for (int i = 0; i < ncols; i++) {
+    sql3column *column = sql3table_get_column(table, i);
+    columns[i].type     = affinity_type(table, column);
+    columns[i].field    = i;
+    columns[i].is_rowid = false;
+    columns[i].missing  = default_value(column);
+    columns[i].nblobs   = 0;
+  }
+  
+  if (!without_rowid) {
+    // a DESC column level primary key is not an alias, a quirk kept by SQLite
+    bool column_pk = npk == 1 && sql3column_is_primarykey(sql3table_get_column(table, pk[0]));
+    if (npk == 1 && !(column_pk && desc) && is_integer_type(sql3table_get_column(table, pk[0]))) {
+      columns[pk[0]].is_rowid = true;
+    }
+    return;
+  }
+  
+  int field = 0;
+  for (int k = 0; k < npk; k++) {
+    columns[pk[k]].field = field++;
+  }
+  for (int i = 0; i < ncols; i++) {
+    bool in_pk = false;
+    for (int k = 0; k < npk && !in_pk; k++) in_pk = pk[k] == i;
+    if (!in_pk) columns[i].field = field++;
+  }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Conversion of record values to R
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP text_chr(table_reader *reader, const sql3db_value *value, sql3db_encoding encoding) {
+  const char *text = value->ptr;
+  size_t length = value->length;
+  
+  if (encoding != SQL3DB_UTF8) {
+    size_t needed = length / 2 * 3 + 1;
+    if (reader->buffer_size < needed) {
+      reader->buffer = R_alloc(needed, 1);
+      reader->buffer_size = needed;
+    }
+    length = sql3db_utf16_to_utf8(text, length, encoding == SQL3DB_UTF16BE, reader->buffer);
+    text = reader->buffer;
+  }
+  
+  // R strings can't hold NUL, text stops at the first one as for sqlite3_column_text()
+  const char *nul = memchr(text, '\0', length);
+  if (nul != NULL) length = (size_t)(nul - text);
+  return mkCharLenCE(text, (int)length, CE_UTF8);
+}
+
+
+static SEXP real_chr(double real) {
+  // as SQLite renders a REAL as text: 15 significant digits, always with a '.' or an exponent
+  if (ISNAN(real)) {
+    return NA_STRING;
+  }
+  char buf[40];
+  snprintf(buf, sizeof(buf), "%.15g", real);
+  if (strpbrk(buf, ".eIn") == NULL) {
+    strcat(buf, ".0");
+  }
+  return mkChar(buf);
+}
+
+
+static SEXP integer_chr(int64_t integer) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%lld", (long long)integer);
+  return mkChar(buf);
+}
+
+
+static SEXP value_chr(table_reader *reader, const sql3db_value *value, sql3db_encoding encoding) {
+  switch (value->type) {
+  case SQL3DB_INTEGER: return integer_chr(value->integer);
+  case SQL3DB_FLOAT  : return real_chr(value->real);
+  case SQL3DB_TEXT   : return text_chr(reader, value, encoding);
+  default            : return NA_STRING;
+  }
+}
+
+
+static SEXP value_sexp(table_reader *reader, const sql3db_value *value, sql3db_encoding encoding) {
+  switch (value->type) {
+  case SQL3DB_INTEGER: 
+    if (value->integer > INT_MAX || value->integer < -INT_MAX) {
+      return ScalarReal((double)value->integer);
+    }
+    return ScalarInteger((int)value->integer);
+  case SQL3DB_FLOAT: 
+    return ScalarReal(value->real);
+  case SQL3DB_TEXT: 
+    return ScalarString(text_chr(reader, value, encoding));
+  case SQL3DB_BLOB: {
+    SEXP raw_ = allocVector(RAWSXP, (R_xlen_t)value->length);
+    if (value->length > 0) memcpy(RAW(raw_), value->ptr, value->length);
+    return raw_;
+  }
+  default: 
+    return R_NilValue;
+  }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Convert the values read so far to a wider type
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static void column_widen(table_reader *reader, int col, SEXPTYPE type) {
+  SEXP old_ = VECTOR_ELT(reader->df_, col);
+  SEXP new_ = PROTECT(allocVector(type, reader->capacity));
+  SEXPTYPE old_type = reader->columns[col].type;
+  
+  for (R_xlen_t i = 0; i < reader->nrows; i++) {
+    if (type == REALSXP) {
+      int v = INTEGER(old_)[i];
+      REAL(new_)[i] = (v == NA_INTEGER) ? NA_REAL : (double)v;
+    } else if (old_type == INTSXP) {
+      int v = INTEGER(old_)[i];
+      SET_STRING_ELT(new_, i, (v == NA_INTEGER) ? NA_STRING : integer_chr(v));
+    } else {
+      SET_STRING_ELT(new_, i, real_chr(REAL(old_)[i]));
+    }
+  }
+  
+  SET_VECTOR_ELT(reader->df_, col, new_);
+  reader->columns[col].type = type;
+  UNPROTECT(1);
+}
+
+
+static void column_set(table_reader *reader, int col, R_xlen_t row, const sql3db_value *value, sql3db_encoding encoding) {
+  table_column *column = &reader->columns[col];
+  
+  if (column->type == INTSXP) {
+    if (value->type == SQL3DB_FLOAT || (value->type == SQL3DB_INTEGER && (value->integer > INT_MAX || value->integer < -INT_MAX))) {
+      column_widen(reader, col, REALSXP);
+    } else if (value->type == SQL3DB_TEXT) {
+      column_widen(reader, col, STRSXP);
+    }
+  }
+  if (column->type == REALSXP && value->type == SQL3DB_TEXT) {
+    column_widen(reader, col, STRSXP);
+  }
+  if (value->type == SQL3DB_BLOB && column->type != VECSXP) {
+    column->nblobs++;
+  }
+  
+  SEXP vec_ = VECTOR_ELT(reader->df_, col);
+  switch (column->type) {
+  case INTSXP:
+    INTEGER(vec_)[row] = (value->type == SQL3DB_INTEGER) ? (int)value->integer : NA_INTEGER;
+    break;
+  case REALSXP:
+    REAL(vec_)[row] = 
+      (value->type == SQL3DB_INTEGER) ? (double)value->integer : 
+      (value->type == SQL3DB_FLOAT  ) ? value->real : NA_REAL;
+    break;
+  case STRSXP:
+    SET_STRING_ELT(vec_, row, value_chr(reader, value, encoding));
+    break;
+  default:
+    SET_VECTOR_ELT(vec_, row, value_sexp(reader, value, encoding));
+  }
+}
+
+
+static bool table_callback(void *xdata, int64_t rowid, const uint8_t *payload, size_t size) {
+  table_reader *reader = (table_reader *)xdata;
+  
+  // more rows than counted: the file changed while it was read
+  if (reader->nrows == reader->capacity) {
+    reader->corrupt = true;
+    return false;
+  }
+  
+  int nvalues = sql3db_record_decode(payload, size, reader->values, reader->ncols);
+  if (nvalues < 0) {
+    reader->corrupt = true;
+    return false;
+  }
+  
+  R_xlen_t row = reader->nrows++;
+  for (int i = 0; i < reader->ncols; i++) {
+    table_column *column = &reader->columns[i];
+    
+    if (column->is_rowid) {
+      sql3db_value value = {.type = SQL3DB_INTEGER, .integer = rowid};
+      column_set(reader, i, row, &value, reader->encoding);
+    } else if (column->field < nvalues) {
+      column_set(reader, i, row, &reader->values[column->field], reader->encoding);
+    } else {
+      column_set(reader, i, row, &column->missing, SQL3DB_UTF8);
+    }
+  }
+  
+  return true;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Read the rows of a table of a SQLite database file
+//
+// The table is looked up in sqlite_schema and its sql parsed for the column
+// names, declared types and primary key. Its b-tree is then walked straight
+// from the pages of the file, cells decoded into vectors allocated up front
+// from a count of the cells (which only touches the b-tree pages)
+//
+// @param path_ path to the database file
+// @param table_ name of the table
+// @return data.frame with one column per column of the table
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP read_table_(SEXP path_, SEXP table_) {
+  
+  unsigned int nprotect = 0;
+  
+  if (!isString(table_) || length(table_) != 1 || STRING_ELT(table_, 0) == NA_STRING) {
+    error("'table' must be a single character string");
+  }
+  const char *name = translateChar(STRING_ELT(table_, 0));
+  
+  SEXP db_ = PROTECT(db_open(path_)); nprotect++;
+  sql3db *db = (sql3db *)R_ExternalPtrAddr(db_);
+  
+  table_lookup lookup = {0};
+  lookup.name.ptr = sql_utf8(STRING_ELT(table_, 0), &lookup.name.length);
+  sql3db_error err = sql3db_read_schema(db, lookup_callback, &lookup);
+  if (err != SQL3DB_OK) {
+    db_finalizer(db_);
+    error("Couldn't read the schema of '%s': %s", translateChar(STRING_ELT(path_, 0)), sql3db_errmsg(err));
+  }
+  if (!lookup.found) {
+    db_finalizer(db_);
+    error("Table '%s' not found", name);
+  }
+  if (lookup.entry.rootpage == 0) {
+    db_finalizer(db_);
+    error("Table '%s' is a virtual table", name);
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Parse the table. It is a view into the R_alloc() copy of the sql
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parser_ = PROTECT(parser_create()); nprotect++;
+  sql3parser *parser = (sql3parser *)R_ExternalPtrAddr(parser_);
+  
+  sql3error_code perr;
+  sql3table *table = sql3parser_parse(parser, lookup.entry.sql.ptr, lookup.entry.sql.length, &perr);
+  if (table == NULL) {
+    parser_release(parser_);
+    db_finalizer(db_);
+    error("Couldn't parse the sql of table '%s': %s", name, CHAR(parse_error_message(NULL, perr)));
+  }
+  
+  table_reader reader = {0};
+  reader.ncols    = (int)sql3table_num_columns(table);
+  reader.columns  = (table_column *)R_alloc(reader.ncols, sizeof(table_column));
+  reader.values   = (sql3db_value *)R_alloc(reader.ncols, sizeof(sql3db_value));
+  reader.encoding = sql3db_text_encoding(db);
+  table_plan(table, reader.columns);
+  
+  bool is_table = !sql3table_is_withoutrowid(table);
+  uint64_t count;
+  err = sql3db_count_cells(db, lookup.entry.rootpage, is_table, &count);
+  if (err != SQL3DB_OK || count > (uint64_t)R_XLEN_T_MAX) {
+    parser_release(parser_);
+    db_finalizer(db_);
+    error("Couldn't read table '%s': %s", name, sql3db_errmsg(err != SQL3DB_OK ? err : SQL3DB_MEMORY));
+  }
+  reader.capacity = (R_xlen_t)count;
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Allocate the columns and walk the b-tree
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  reader.df_ = PROTECT(allocVector(VECSXP, reader.ncols)); nprotect++;
+  SEXP names_ = PROTECT(allocVector(STRSXP, reader.ncols)); nprotect++;
+  for (int i = 0; i < reader.ncols; i++) {
+    SET_VECTOR_ELT(reader.df_, i, allocVector(reader.columns[i].type, reader.capacity));
+    SET_STRING_ELT(names_, i, rchr(sql3column_name(sql3table_get_column(table, i))));
+  }
+  
+  if (is_table) {
+    err = sql3db_walk_table(db, lookup.entry.rootpage, table_callback, &reader);
+  } else {
+    err = sql3db_walk_index(db, lookup.entry.rootpage, table_callback, &reader);
+  }
+  parser_release(parser_);
+  db_finalizer(db_);
+  if (err == SQL3DB_OK && reader.corrupt) {
+    err = SQL3DB_CORRUPT;
+  }
+  if (err != SQL3DB_OK) {
+    error("Couldn't read table '%s': %s", name, sql3db_errmsg(err));
+  }
+  
+  // fewer rows than counted: the file changed while it was read
+  if (reader.nrows < reader.capacity) {
+    for (int i = 0; i < reader.ncols; i++) {
+      SET_VECTOR_ELT(reader.df_, i, xlengthgets(VECTOR_ELT(reader.df_, i), reader.nrows));
+    }
+  }
+  
+  for (int i = 0; i < reader.ncols; i++) {
+    if (reader.columns[i].nblobs > 0) {
+      warning("%.0f blob values of column '%s' were read as NA", (double)reader.columns[i].nblobs, 
+              translateChar(STRING_ELT(names_, i)));
+    }
+  }
+  
+  setAttrib(reader.df_, R_NamesSymbol, names_);
+  list_to_df(reader.df_, (unsigned int)reader.nrows);
+  
+  UNPROTECT(nprotect);
+  return reader.df_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Keys of the automatic indexes of a table, in the order SQLite numbers
+// them ('sqlite_autoindex_<table>_<n>'): column level PRIMARY KEY and UNIQUE
+// constraints in column order, then the table constraints. A key with the
+// same columns and collations as an earlier one shares its index. The
+// primary key of a WITHOUT ROWID table takes a number but is stored as the
+// table itself, after the other keys when it is an INTEGER column. A rowid
+// alias has no index
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  sql3column          *column;      // column level constraint
+  sql3tableconstraint *constraint;  // table level constraint
+  bool                 pk;
+} index_key;
+
+
+static size_t key_num_columns(const index_key *key) {
+  return key->column != NULL ? 1 : sql3table_constraint_num_idxcolumns(key->constraint);
+}
+
+
+static sql3string key_column(sql3table *table, const index_key *key, size_t i, sql3string *collate) {
+  sql3string name;
+  collate->ptr = NULL;
+  if (key->column != NULL) {
+    name = sql3column_name(key->column);
+  } else {
+    sql3idxcolumn *idxcolumn = sql3table_constraint_get_idxcolumn(key->constraint, i);
+    name = sql3idxcolumn_name(idxcolumn);
+    *collate = sql3idxcolumn_collate(idxcolumn);
+  }
+  
+  // without an explicit collation the key uses the one of the column
+  if (collate->ptr == NULL) {
+    int col = column_index(table, name);
+    if (col >= 0) *collate = sql3column_collate_name(sql3table_get_column(table, col));
+  }
+  if (collate->ptr == NULL) {
+    collate->ptr = "BINARY";
+    collate->length = 6;
+  }
+  return name;
+}
+
+
+static bool key_equal(sql3table *table, const index_key *a, const index_key *b) {
+  size_t n = key_num_columns(a);
+  if (n != key_num_columns(b)) {
+    return false;
+  }
+  for (size_t i = 0; i < n; i++) {
+    sql3string collate_a, collate_b;
+    sql3string name_a = key_column(table, a, i, &collate_a);
+    sql3string name_b = key_column(table, b, i, &collate_b);
+    if (!name_equal(name_a, name_b) || !name_equal(collate_a, collate_b)) return false;
+  }
+  return true;
+}
+
+
+static void key_add(sql3table *table, index_key *keys, int *nkeys, index_key key) {
+  for (int i = 0; i < *nkeys; i++) {
+    if (key_equal(table, &keys[i], &key)) {
+      keys[i].pk = keys[i].pk || key.pk;
+      return;
+    }
+  }
+  keys[(*nkeys)++] = key;
+}
+
+
+static int index_keys(sql3table *table, index_key *keys) {
+  int ncols = (int)sql3table_num_columns(table);
+  int ncons = (int)sql3table_num_constraints(table);
+  bool without_rowid = sql3table_is_withoutrowid(table);
+  
+  int *pk = (int *)R_alloc(ncols + 1, sizeof(int));
+  bool desc;
+  int npk = primary_key(table, pk, &desc);
+  bool column_pk = npk == 1 && sql3column_is_primarykey(sql3table_get_column(table, pk[0]));
+  bool integer_pk = npk == 1 && !(column_pk && desc) && is_integer_type(sql3table_get_column(table, pk[0]));
+  
+  int nkeys = 0;
+  index_key integer_key = {0};
+  for (int i = 0; i < ncols; i++) {
+    sql3column *column = sql3table_get_column(table, i);
+    if (sql3column_is_primarykey(column)) {
+      index_key key = {column, NULL, true};
+      if (!integer_pk) key_add(table, keys, &nkeys, key);
+      else integer_key = key;
+    }
+    if (sql3column_is_unique(column)) {
+      key_add(table, keys, &nkeys, (index_key){column, NULL, false});
+    }
+  }
+  for (int i = 0; i < ncons; i++) {
+    sql3tableconstraint *constraint = sql3table_get_constraint(table, i);
+    sql3constraint_type type = sql3table_constraint_type(constraint);
+    if (type == SQL3TABLECONSTRAINT_PRIMARYKEY) {
+      index_key key = {NULL, constraint, true};
+      if (!integer_pk) key_add(table, keys, &nkeys, key);
+      else integer_key = key;
+    } else if (type == SQL3TABLECONSTRAINT_UNIQUE) {
+      key_add(table, keys, &nkeys, (index_key){NULL, constraint, false});
+    }
+  }
+  
+  if (without_rowid && integer_pk) {
+    key_add(table, keys, &nkeys, integer_key);
+  }
+  return nkeys;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Key of the automatic index 'name' of a table, NULL if it can't be matched
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static const index_key *autoindex_key(sql3string name, index_key *keys, int nkeys) {
+  size_t prefix = strlen("sqlite_autoindex_");
+  if (name.ptr == NULL || name.length <= prefix || strncmp(name.ptr, "sqlite_autoindex_", prefix) != 0) {
+    return NULL;
+  }
+  
+  size_t end = name.length, start = end;
+  while (start > prefix && name.ptr[start - 1] >= '0' && name.ptr[start - 1] <= '9') start--;
+  if (start == end || end - start > 6 || name.ptr[start - 1] != '_') {
+    return NULL;
+  }
+  
+  int n = 0;
+  for (size_t i = start; i < end; i++) n = n * 10 + (name.ptr[i] - '0');
+  return (n >= 1 && n <= nkeys) ? &keys[n - 1] : NULL;
+}
+
+
+static int count_constraints(sql3table *table) {
+  int n = (int)sql3table_num_constraints(table);
+  size_t ncols = sql3table_num_columns(table);
+  for (size_t i = 0; i < ncols; i++) {
+    sql3column *column = sql3table_get_column(table, i);
+    n += sql3column_is_primarykey(column) + sql3column_is_notnull(column) + sql3column_is_unique(column);
+    n += sql3column_check_expr(column).ptr != NULL;
+    n += sql3column_foreignkey_clause(column) != NULL;
+  }
+  return n;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Storage used by the tables and indexes of a SQLite database file
+//
+// Every b-tree with a root page in sqlite_schema (and sqlite_schema itself)
+// is walked on a pool of 'threads' workers sharing the open file. The
+// pages of the b-trees are read, overflow pages are only counted. The 
+// statistics are joined with the parsed sql of the tables
+//
+// @param path_ path to the database file
+// @param threads_ number of threads to use
+// @return data.frame with one row per b-tree
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP analyze_storage_(SEXP path_, SEXP threads_) {
+  
+  unsigned int nprotect = 0;
+  
+  int nthreads = asInteger(threads_);
+  if (nthreads == NA_INTEGER || nthreads < 1) {
+    error("'threads' must be a positive integer");
+  }
+  
+  SEXP db_ = PROTECT(db_open(path_)); nprotect++;
+  sql3db *db = (sql3db *)R_ExternalPtrAddr(db_);
+  
+  schema_result res = {0};
+  sql3db_error err = sql3db_read_schema(db, schema_callback, &res);
+  if (err != SQL3DB_OK) {
+    db_finalizer(db_);
+    error("Couldn't read the schema of '%s': %s", translateChar(STRING_ELT(path_, 0)), sql3db_errmsg(err));
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // sqlite_schema first, then every entry with a b-tree (not views, 
+  // triggers or virtual tables). No R API calls are allowed until all 
+  // workers have finished
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  size_t N = 1;
+  for (size_t i = 0; i < res.count; i++) {
+    if (res.entries[i].rootpage != 0) N++;
+  }
+  
+  sql3db_btree_stats *stats   = (sql3db_btree_stats *)R_alloc(N, sizeof(sql3db_btree_stats));
+  int                *entries = (int *)               R_alloc(N, sizeof(int));
+  stats[0].root = 1;
+  entries[0] = -1;
+  for (size_t i = 0, k = 1; i < res.count; i++) {
+    if (res.entries[i].rootpage == 0) continue;
+    stats[k].root = res.entries[i].rootpage;
+    entries[k++] = (int)i;
+  }
+  
+  sql3db_analyze_btrees(db, stats, N, (size_t)nthreads);
+  double page_size = (double)sql3db_page_size(db);
+  db_finalizer(db_);
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Parse the tables. The tables are views into the R_alloc() copies
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parser_ = PROTECT(parser_create()); nprotect++;
+  sql3parser *parser = (sql3parser *)R_ExternalPtrAddr(parser_);
+  
+  sql3table **tables = (sql3table **)R_alloc(res.count + 1, sizeof(sql3table *));
+  for (size_t i = 0; i < res.count; i++) {
+    const sql3db_schema_entry *entry = &res.entries[i];
+    tables[i] = NULL;
+    if (!is_table_entry(entry)) continue;
+    
+    sql3error_code perr;
+    tables[i] = sql3parser_parse(parser, entry->sql.ptr, entry->sql.length, &perr);
+    if (perr == SQL3ERROR_MEMORY) {
+      parser_release(parser_);
+      error("Out of memory while parsing sql");
+    }
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Result
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP df_ = PROTECT(allocVector(VECSXP, 22)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, storage_names_);
+  
+  SEXPTYPE types[22] = {
+    INTSXP, STRSXP, STRSXP, STRSXP, REALSXP, STRSXP, LGLSXP, INTSXP, INTSXP, 
+    REALSXP, INTSXP, REALSXP, REALSXP, REALSXP, REALSXP, REALSXP, REALSXP, 
+    REALSXP, REALSXP, REALSXP, REALSXP, STRSXP
+  };
+  for (int j = 0; j < 22; j++) {
+    SET_VECTOR_ELT(df_, j, allocVector(types[j], (R_xlen_t)N));
+  }
+  
+  sql3db_schema_entry schema_entry = {0};
+  schema_entry.type.ptr     = "table";
+  schema_entry.type.length  = 5;
+  schema_entry.name.ptr     = "sqlite_schema";
+  schema_entry.name.length  = 13;
+  schema_entry.tbl_name     = schema_entry.name;
+  schema_entry.rootpage     = 1;
+  
+  index_key *keys = NULL;
+  int nkeys = 0, keys_of = -1;
+  
+  for (R_xlen_t i = 0; i < (R_xlen_t)N; i++) {
+    const sql3db_btree_stats *st = &stats[i];
+    const sql3db_schema_entry *entry = entries[i] < 0 ? &schema_entry : &res.entries[entries[i]];
+    bool is_index = entry->type.length == 5 && memcmp(entry->type.ptr, "index", 5) == 0;
+    
+    // the table of an index is found by name, the parsed table of any other entry is its own
+    int owner = entries[i];
+    if (is_index) {
+      owner = -1;
+      for (size_t t = 0; t < res.count && owner < 0; t++) {
+        if (tables[t] != NULL && name_equal(res.entries[t].name, entry->tbl_name)) owner = (int)t;
+      }
+    }
+    sql3table *table = owner < 0 ? NULL : tables[owner];
+    
+    const char *origin = NULL;
+    int num_columns = NA_INTEGER, num_constraints = NA_INTEGER;
+    int without_rowid = table == NULL ? NA_LOGICAL : sql3table_is_withoutrowid(table);
+    
+    if (entries[i] < 0) {
+      num_columns = 5;
+      num_constraints = 0;
+      without_rowid = FALSE;
+    } else if (!is_index) {
+      if (table != NULL) {
+        num_columns = (int)sql3table_num_columns(table);
+        num_constraints = count_constraints(table);
+      }
+    } else if (entry->sql.ptr != NULL) {
+      origin = "c";
+    } else if (table != NULL) {
+      if (keys_of != owner) {
+        keys = (index_key *)R_alloc(2 * sql3table_num_columns(table) + sql3table_num_constraints(table) + 1, sizeof(index_key));
+        nkeys = index_keys(table, keys);
+        keys_of = owner;
+      }
+      const index_key *key = autoindex_key(entry->name, keys, nkeys);
+      if (key != NULL) {
+        origin = key->pk ? "pk" : "u";
+        num_columns = (int)key_num_columns(key);
+      }
+    }
+    
+    INTEGER(VECTOR_ELT(df_, 0))[i] = entries[i] < 0 ? NA_INTEGER : entries[i] + 1;
+    SET_STRING_ELT(VECTOR_ELT(df_, 1), i, rchr(entry->type));
+    SET_STRING_ELT(VECTOR_ELT(df_, 2), i, rchr(entry->name));
+    SET_STRING_ELT(VECTOR_ELT(df_, 3), i, rchr(entry->tbl_name));
+    REAL(VECTOR_ELT(df_, 4))[i] = (double)entry->rootpage;
+    SET_STRING_ELT(VECTOR_ELT(df_, 5), i, origin == NULL ? NA_STRING : mkChar(origin));
+    LOGICAL(VECTOR_ELT(df_, 6))[i] = without_rowid;
+    INTEGER(VECTOR_ELT(df_, 7))[i] = num_columns;
+    INTEGER(VECTOR_ELT(df_, 8))[i] = num_constraints;
+    
+    bool ok = st->error == SQL3DB_OK;
+    double total_pages = (double)(st->interior_pages + st->leaf_pages + st->overflow_pages);
+    INTEGER(VECTOR_ELT(df_, 10))[i] = ok ? (int)st->depth : NA_INTEGER;
+    REAL(VECTOR_ELT(df_,  9))[i] = ok ? (double)st->entries          : NA_REAL;
+    REAL(VECTOR_ELT(df_, 11))[i] = ok ? (double)st->interior_pages   : NA_REAL;
+    REAL(VECTOR_ELT(df_, 12))[i] = ok ? (double)st->leaf_pages       : NA_REAL;
+    REAL(VECTOR_ELT(df_, 13))[i] = ok ? (double)st->overflow_pages   : NA_REAL;
+    REAL(VECTOR_ELT(df_, 14))[i] = ok ? total_pages                  : NA_REAL;
+    REAL(VECTOR_ELT(df_, 15))[i] = ok ? (double)st->payload_bytes    : NA_REAL;
+    REAL(VECTOR_ELT(df_, 16))[i] = ok && st->entries > 0 ? (double)st->payload_bytes / (double)st->entries : NA_REAL;
+    REAL(VECTOR_ELT(df_, 17))[i] = ok ? (double)st->max_payload      : NA_REAL;
+    REAL(VECTOR_ELT(df_, 18))[i] = ok ? (double)st->overflow_entries : NA_REAL;
+    REAL(VECTOR_ELT(df_, 19))[i] = ok ? (double)st->unused_bytes     : NA_REAL;
+    REAL(VECTOR_ELT(df_, 20))[i] = ok && total_pages > 0 ? 1 - (double)st->unused_bytes / (total_pages * page_size) : NA_REAL;
+    SET_STRING_ELT(VECTOR_ELT(df_, 21), i, ok ? NA_STRING : mkChar(sql3db_errmsg(st->error)));
+  }
+  
+  list_to_df(df_, (unsigned int)N);
+  
+  parser_release(parser_);
+  UNPROTECT(nprotect);
+  return df_;
+}
@@ -3,11 +3,34 @@
 #include <R.h>
 #include <Rinternals.h>
 
-extern SEXP parse_(SEXP sql_);
+#include "constants.h"
+#include "table-parser.h"
+
+extern SEXP parse_(SEXP sql_, SEXP threads_, SEXP flat_, SEXP lazy_, SEXP fields_);
+extern SEXP parse_script_(SEXP sql_, SEXP flat_, SEXP fields_);
+extern SEXP parse_file_(SEXP path_, SEXP flat_, SEXP fields_);
+extern SEXP stream_create_(SEXP flat_, SEXP fields_);
+extern SEXP stream_feed_(SEXP stream_, SEXP chunk_);
+extern SEXP stream_result_(SEXP stream_, SEXP final_);
+extern SEXP read_schema_(SEXP path_, SEXP flat_, SEXP fields_);
+extern SEXP crawl_schemas_(SEXP paths_, SEXP threads_, SEXP flat_, SEXP fields_);
+extern SEXP read_stamp_(SEXP path_);
+extern SEXP read_table_(SEXP path_, SEXP table_);
+extern SEXP analyze_storage_(SEXP path_, SEXP threads_);
 
 static const R_CallMethodDef CEntries[] = {
   
-  {"parse_", (DL_FUNC) &parse_, 1},
+  {"parse_"         , (DL_FUNC) &parse_         , 5},
+  {"parse_script_"  , (DL_FUNC) &parse_script_  , 3},
+  {"parse_file_"    , (DL_FUNC) &parse_file_    , 3},
+  {"stream_create_" , (DL_FUNC) &stream_create_ , 2},
+  {"stream_feed_"   , (DL_FUNC) &stream_feed_   , 2},
+  {"stream_result_" , (DL_FUNC) &stream_result_ , 2},
+  {"read_schema_"   , (DL_FUNC) &read_schema_   , 3},
+  {"crawl_schemas_" , (DL_FUNC) &crawl_schemas_ , 4},
+  {"read_stamp_"    , (DL_FUNC) &read_stamp_    , 1},
+  {"read_table_"    , (DL_FUNC) &read_table_    , 2},
+  {"analyze_storage_", (DL_FUNC) &analyze_storage_, 2},
   {NULL , NULL, 0}
 };
 
@@ -21,6 +44,9 @@ void R_init_sqlitemeta(DllInfo *info) {
     NULL       // External
   );
   R_useDynamicSymbols(info, FALSE);
+  
+  init_constants();
+  init_lazy_columns(info);
 }
 
 
@@ -0,0 +1,317 @@
+#include <R.h>
+#include <Rinternals.h>
+#include <R_ext/Altrep.h>
+
+#include "sql3parse_table.h"
+#include "table-parser.h"
+#include "constants.h"
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Lazy 'columns' data.frame
+//
+// Every column of the data.frame is an ALTREP vector which reads its
+// elements straight out of the parsed sql3column nodes. Nothing is
+// converted until an element is accessed, and a vector is only materialized
+// as a whole if R asks for its data pointer.
+//
+// data1 of each vector is an external pointer:
+//   addr: the lazy_row array (one row per column of every table)
+//   tag : the field of the sql3column to read
+//   prot: list(keep, rows) where 'keep' holds the inputs and the parsers
+//         whose arenas own the nodes and 'rows' is the RAWSXP holding the
+//         lazy_row array. The parsers are released by their finalizers
+//         once the last vector is garbage collected.
+// data2 is the materialized vector, or NULL
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  sql3column *column;
+  int         stmt_id;
+} lazy_row;
+
+// Fields in the same order as the columns of parse_column_info()
+typedef enum {
+  LAZY_STMT_ID,
+  LAZY_NAME,
+  LAZY_TYPE,
+  LAZY_LENGTH,
+  LAZY_CONSTRAINT_NAME,
+  LAZY_COMMENT,
+  LAZY_PRIMARY_KEY,
+  LAZY_AUTO_INCREMENT,
+  LAZY_NOT_NULL,
+  LAZY_UNIQUE,
+  LAZY_ORDER_PK,
+  LAZY_CONFLICT_PK,
+  LAZY_CONFLICT_NOT_NULL,
+  LAZY_CONFLICT_UNIQUE,
+  LAZY_CHECK_EXPR,
+  LAZY_DEFAULT_EXPR,
+  LAZY_COLLATE_NAME,
+  LAZY_NFIELDS
+} lazy_field;
+
+static R_altrep_class_t lazy_string_class;
+static R_altrep_class_t lazy_integer_class;
+static R_altrep_class_t lazy_logical_class;
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Accessors for the state held in data1
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static lazy_row *lazy_rows(SEXP x) {
+  return (lazy_row *)R_ExternalPtrAddr(R_altrep_data1(x));
+}
+
+static lazy_field lazy_get_field(SEXP x) {
+  return (lazy_field)INTEGER(R_ExternalPtrTag(R_altrep_data1(x)))[0];
+}
+
+static R_xlen_t lazy_length(SEXP x) {
+  SEXP rows_ = VECTOR_ELT(R_ExternalPtrProtected(R_altrep_data1(x)), 1);
+  return XLENGTH(rows_) / (R_xlen_t)sizeof(lazy_row);
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Convert a single element of a field
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP lazy_string_value(lazy_row *row, lazy_field field) {
+  sql3column *col = row->column;
+  switch (field) {
+  case LAZY_NAME           : return rchr(sql3column_name(col));
+  case LAZY_TYPE           : return rchr(sql3column_type(col));
+  case LAZY_LENGTH         : return rchr(sql3column_length(col));
+  case LAZY_CONSTRAINT_NAME: return rchr(sql3column_constraint_name(col));
+  case LAZY_COMMENT        : return rchr(sql3column_comment(col));
+  case LAZY_CHECK_EXPR     : return rchr(sql3column_check_expr(col));
+  case LAZY_DEFAULT_EXPR   : return rchr(sql3column_default_expr(col));
+  case LAZY_COLLATE_NAME   : return rchr(sql3column_collate_name(col));
+  default                  : return NA_STRING;
+  }
+}
+
+static int lazy_int_value(lazy_row *row, lazy_field field) {
+  sql3column *col = row->column;
+  switch (field) {
+  case LAZY_STMT_ID          : return row->stmt_id;
+  case LAZY_PRIMARY_KEY      : return sql3column_is_primarykey(col);
+  case LAZY_AUTO_INCREMENT   : return sql3column_is_autoincrement(col);
+  case LAZY_NOT_NULL         : return sql3column_is_notnull(col);
+  case LAZY_UNIQUE           : return sql3column_is_unique(col);
+  case LAZY_ORDER_PK         : return 1 + sql3column_pk_order(col);
+  case LAZY_CONFLICT_PK      : return 1 + sql3column_pk_conflictclause(col);
+  case LAZY_CONFLICT_NOT_NULL: return 1 + sql3column_notnull_conflictclause(col);
+  case LAZY_CONFLICT_UNIQUE  : return 1 + sql3column_unique_conflictclause(col);
+  default                    : return NA_INTEGER;
+  }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Convert the whole field into a standard vector and keep it in data2.
+// From then on all access goes through data2, so writes through the data
+// pointer are seen by later reads
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP lazy_materialize(SEXP x) {
+  SEXP data2 = R_altrep_data2(x);
+  if (data2 != R_NilValue) {
+    return data2;
+  }
+  
+  R_xlen_t N = lazy_length(x);
+  lazy_row *rows = lazy_rows(x);
+  lazy_field field = lazy_get_field(x);
+  
+  SEXP vec_ = PROTECT(allocVector(TYPEOF(x), N));
+  if (TYPEOF(x) == STRSXP) {
+    for (R_xlen_t i = 0; i < N; i++) {
+      SET_STRING_ELT(vec_, i, lazy_string_value(&rows[i], field));
+    }
+  } else {
+    int *ptr = (TYPEOF(x) == LGLSXP) ? LOGICAL(vec_) : INTEGER(vec_);
+    for (R_xlen_t i = 0; i < N; i++) {
+      ptr[i] = lazy_int_value(&rows[i], field);
+    }
+  }
+  
+  R_set_altrep_data2(x, vec_);
+  UNPROTECT(1);
+  return vec_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// ALTREP methods
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static R_xlen_t lazy_Length(SEXP x) {
+  SEXP data2 = R_altrep_data2(x);
+  return (data2 == R_NilValue) ? lazy_length(x) : XLENGTH(data2);
+}
+
+static Rboolean lazy_Inspect(SEXP x, int pre, int deep, int pvec, void (*inspect_subtree)(SEXP, int, int, int)) {
+  Rprintf("sqlitemeta lazy column (field=%d, materialized=%s)\n",
+          (int)lazy_get_field(x), R_altrep_data2(x) == R_NilValue ? "FALSE" : "TRUE");
+  return TRUE;
+}
+
+static void *lazy_Dataptr(SEXP x, Rboolean writeable) {
+  SEXP vec_ = lazy_materialize(x);
+  switch (TYPEOF(vec_)) {
+  case STRSXP: return (void *)STRING_PTR_RO(vec_);
+  case LGLSXP: return (void *)LOGICAL(vec_);
+  default    : return (void *)INTEGER(vec_);
+  }
+}
+
+static const void *lazy_Dataptr_or_null(SEXP x) {
+  SEXP data2 = R_altrep_data2(x);
+  if (data2 == R_NilValue) {
+    return NULL;
+  }
+  return lazy_Dataptr(x, FALSE);
+}
+
+static SEXP lazy_string_Elt(SEXP x, R_xlen_t i) {
+  SEXP data2 = R_altrep_data2(x);
+  if (data2 != R_NilValue) {
+    return STRING_ELT(data2, i);
+  }
+  return lazy_string_value(&lazy_rows(x)[i], lazy_get_field(x));
+}
+
+static void lazy_string_Set_elt(SEXP x, R_xlen_t i, SEXP value) {
+  SET_STRING_ELT(lazy_materialize(x), i, value);
+}
+
+static int lazy_integer_Elt(SEXP x, R_xlen_t i) {
+  SEXP data2 = R_altrep_data2(x);
+  if (data2 != R_NilValue) {
+    return INTEGER(data2)[i];
+  }
+  return lazy_int_value(&lazy_rows(x)[i], lazy_get_field(x));
+}
+
+static int lazy_logical_Elt(SEXP x, R_xlen_t i) {
+  SEXP data2 = R_altrep_data2(x);
+  if (data2 != R_NilValue) {
+    return LOGICAL(data2)[i];
+  }
+  return lazy_int_value(&lazy_rows(x)[i], lazy_get_field(x));
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Register the ALTREP classes. Called from R_init_sqlitemeta().
+// Serialization is left to R which writes out the materialized values, so
+// a saved result does not depend on the parser
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+void init_lazy_columns(DllInfo *dll) {
+  
+  lazy_string_class  = R_make_altstring_class ("lazy_column_string" , "sqlitemeta", dll);
+  lazy_integer_class = R_make_altinteger_class("lazy_column_integer", "sqlitemeta", dll);
+  lazy_logical_class = R_make_altlogical_class("lazy_column_logical", "sqlitemeta", dll);
+  
+  R_altrep_class_t classes[] = {lazy_string_class, lazy_integer_class, lazy_logical_class};
+  for (int i = 0; i < 3; i++) {
+    R_set_altrep_Length_method         (classes[i], lazy_Length);
+    R_set_altrep_Inspect_method        (classes[i], lazy_Inspect);
+    R_set_altvec_Dataptr_method        (classes[i], lazy_Dataptr);
+    R_set_altvec_Dataptr_or_null_method(classes[i], lazy_Dataptr_or_null);
+  }
+  
+  R_set_altstring_Elt_method    (lazy_string_class , lazy_string_Elt);
+  R_set_altstring_Set_elt_method(lazy_string_class , lazy_string_Set_elt);
+  R_set_altinteger_Elt_method   (lazy_integer_class, lazy_integer_Elt);
+  R_set_altlogical_Elt_method   (lazy_logical_class, lazy_logical_Elt);
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Create one lazy vector
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP lazy_vector(R_altrep_class_t cls, lazy_field field, lazy_row *rows, SEXP state_) {
+  SEXP field_ = PROTECT(ScalarInteger(field));
+  SEXP ptr_   = PROTECT(R_MakeExternalPtr(rows, field_, state_));
+  SEXP vec_   = R_new_altrep(cls, ptr_, R_NilValue);
+  UNPROTECT(2);
+  return vec_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Lazy version of parse_column_info()
+//
+// @param keep_ object holding everything the parsed tables point into
+//        (input strings and parsers). It must stay alive as long as any of
+//        the returned vectors
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_column_info_lazy(sql3table **tables, const int *stmt_ids, R_xlen_t ntables, SEXP keep_) {
+  
+  unsigned int nprotect = 0;
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Flatten the columns of all tables into one row index
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  R_xlen_t N = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    if (tables[t] != NULL) N += sql3table_num_columns(tables[t]);
+  }
+  
+  SEXP rows_ = PROTECT(allocVector(RAWSXP, N * (R_xlen_t)sizeof(lazy_row))); nprotect++;
+  lazy_row *rows = (lazy_row *)RAW(rows_);
+  
+  R_xlen_t col_idx = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    sql3table *table = tables[t];
+    if (table == NULL) continue;
+  
+    size_t ncols = sql3table_num_columns(table);
+    for (size_t j = 0; j < ncols; j++, col_idx++) {
+      rows[col_idx].column  = sql3table_get_column(table, j);
+      rows[col_idx].stmt_id = stmt_ids[t];
+    }
+  }
+  
+  SEXP state_ = PROTECT(list2(keep_, rows_)); nprotect++;
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Same columns, names and factors as parse_column_info()
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP df_ = PROTECT(allocVector(VECSXP, LAZY_NFIELDS)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, columns_names_);
+  
+  for (int field = 0; field < LAZY_NFIELDS; field++) {
+    R_altrep_class_t cls;
+    switch (field) {
+    case LAZY_STMT_ID:
+    case LAZY_ORDER_PK:
+    case LAZY_CONFLICT_PK:
+    case LAZY_CONFLICT_NOT_NULL:
+    case LAZY_CONFLICT_UNIQUE:
+      cls = lazy_integer_class;
+      break;
+    case LAZY_PRIMARY_KEY:
+    case LAZY_AUTO_INCREMENT:
+    case LAZY_NOT_NULL:
+    case LAZY_UNIQUE:
+      cls = lazy_logical_class;
+      break;
+    default:
+      cls = lazy_string_class;
+    }
+    SET_VECTOR_ELT(df_, field, lazy_vector(cls, (lazy_field)field, rows, state_));
+  }
+  
+  setAttrib(VECTOR_ELT(df_, LAZY_ORDER_PK), R_ClassSymbol, factor_class_);
+  setAttrib(VECTOR_ELT(df_, LAZY_ORDER_PK), R_LevelsSymbol, order_levels_);
+  
+  for (int field = LAZY_CONFLICT_PK; field <= LAZY_CONFLICT_UNIQUE; field++) {
+    setAttrib(VECTOR_ELT(df_, field), R_ClassSymbol, factor_class_);
+    setAttrib(VECTOR_ELT(df_, field), R_LevelsSymbol, conflict_levels_);
+  }
+  
+  list_to_df(df_, N);
+  
+  UNPROTECT(nprotect);
+  return df_;
+}
@@ -0,0 +1,147 @@
+#include <R.h>
+#include <Rinternals.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped-file.h"
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// A read-only memory mapping of a whole file.
+// The parser works on (ptr, length) views of its input so the mapped pages
+// are parsed in place and only the strings which end up in the R result
+// are copied. An empty file has a NULL data pointer
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  const char *data;
+  size_t      size;
+} mapped_file;
+
+
+static void mapped_file_unmap(mapped_file *file) {
+  if (file->data != NULL) {
+#ifdef _WIN32
+    UnmapViewOfFile((LPCVOID)file->data);
+#else
+    munmap((void *)file->data, file->size);
+#endif
+  }
+  free(file);
+}
+
+
+static void mapped_file_finalizer(SEXP file_) {
+  mapped_file *file = (mapped_file *)R_ExternalPtrAddr(file_);
+  if (file != NULL) {
+    mapped_file_unmap(file);
+    R_ClearExternalPtr(file_);
+  }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Map the file at 'path' (a single string) into memory.
+// The mapping is owned by an external pointer, so it is released even
+// if the caller is interrupted by an R error
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP mapped_file_open(SEXP path_) {
+  
+  if (!isString(path_) || length(path_) != 1 || STRING_ELT(path_, 0) == NA_STRING) {
+    error("'path' must be a single character string");
+  }
+  const char *path = R_ExpandFileName(translateChar(STRING_ELT(path_, 0)));
+  
+  mapped_file *file = (mapped_file *)calloc(1, sizeof(mapped_file));
+  if (file == NULL) {
+    error("Couldn't allocate the file mapping");
+  }
+  
+#ifdef _WIN32
+  HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    free(file);
+    error("Couldn't open '%s'", path);
+  }
+  
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size) || (uint64_t)size.QuadPart > SIZE_MAX) {
+    CloseHandle(handle);
+    free(file);
+    error("Couldn't map '%s'", path);
+  }
+  file->size = (size_t)size.QuadPart;
+  
+  if (file->size > 0) {
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL) {
+      file->data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(handle);
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    free(file);
+    error("Couldn't open '%s'", path);
+  }
+  
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size > SIZE_MAX) {
+    close(fd);
+    free(file);
+    error("Couldn't map '%s'", path);
+  }
+  file->size = (size_t)st.st_size;
+  
+  if (file->size > 0) {
+    void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      file->data = (const char *)data;
+#ifdef MADV_SEQUENTIAL
+      // read once front to back: aggressive readahead, pages can be dropped early
+      madvise(data, file->size, MADV_SEQUENTIAL);
+#endif
+    }
+  }
+  close(fd);
+#endif
+  
+  if (file->size > 0 && file->data == NULL) {
+    free(file);
+    error("Couldn't map '%s'", path);
+  }
+  
+  SEXP file_ = PROTECT(R_MakeExternalPtr(file, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(file_, mapped_file_finalizer, FALSE);
+  UNPROTECT(1);
+  return file_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Contents of a mapped file
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+const char *mapped_file_data(SEXP file_, size_t *size) {
+  mapped_file *file = (mapped_file *)R_ExternalPtrAddr(file_);
+  *size = file->size;
+  return file->data;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Unmap the file as soon as the R objects have been built rather than
+// waiting for the garbage collector
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+void mapped_file_close(SEXP file_) {
+  mapped_file_finalizer(file_);
+}
@@ -0,0 +1,11 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <R.h>
+#include <Rinternals.h>
+
+SEXP mapped_file_open(SEXP path_);
+const char *mapped_file_data(SEXP file_, size_t *size);
+void mapped_file_close(SEXP file_);
+
+#endif
@@ -0,0 +1,400 @@
+#include <R.h>
+#include <Rinternals.h>
+#include <Rdefines.h>
+
+#include "sql3parse_table.h"
+#include "table-parser.h"
+#include "constants.h"
+#include "mapped-file.h"
+#include "sql3split.h"
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Statements seen while splitting the script.
+// Memory comes from R_alloc() so it is reclaimed at the end of the .Call
+// even if an R error is raised part way through
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  sql3table      *table;   // NULL if the statement was skipped
+  size_t          offset;
+  size_t          length;
+  sql3error_code  error;
+} script_stmt;
+
+typedef struct {
+  script_stmt *stmts;
+  size_t       count;
+  size_t       capacity;
+  size_t       ntables;
+} script_result;
+
+
+static bool script_callback(void *xdata, sql3table *table, size_t offset, size_t length, sql3error_code error) {
+  script_result *res = (script_result *)xdata;
+  
+  if (res->count == res->capacity) {
+    size_t capacity = (res->capacity == 0) ? 64 : res->capacity * 2;
+    res->stmts = (script_stmt *)S_realloc((char *)res->stmts, (long)capacity, (long)res->capacity, sizeof(script_stmt));
+    res->capacity = capacity;
+  }
+  
+  script_stmt *stmt = &res->stmts[res->count++];
+  stmt->table  = table;
+  stmt->offset = offset;
+  stmt->length = length;
+  stmt->error  = error;
+  
+  if (table != NULL) res->ntables++;
+  return true;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Build the R result from the statements seen while splitting a script.
+// Statement ids are the position of the statement within the script, 
+// 'first_id' being the id of stmts[0]
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP script_to_r(const script_stmt *stmts, size_t count, size_t ntables, int first_id, int flat) {
+  
+  unsigned int nprotect = 0;
+  
+  size_t nskipped = count - ntables;
+  
+  sql3table **tables   = (sql3table **)R_alloc(ntables, sizeof(sql3table *));
+  int        *stmt_ids = (int *)       R_alloc(ntables, sizeof(int));
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // 'skipped' data.frame. Byte positions are 1-based and inclusive, and
+  // stored as doubles as scripts read from files can exceed 2GB
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP skipped_ = PROTECT(allocVector(VECSXP, 4)); nprotect++;
+  setAttrib(skipped_, R_NamesSymbol, skipped_names_);
+  
+  SEXP stmt_id_ = PROTECT(allocVector(INTSXP, nskipped)); nprotect++;
+  SEXP start_   = PROTECT(allocVector(REALSXP, nskipped)); nprotect++;
+  SEXP end_     = PROTECT(allocVector(REALSXP, nskipped)); nprotect++;
+  SEXP reason_  = PROTECT(allocVector(STRSXP, nskipped)); nprotect++;
+  SET_VECTOR_ELT(skipped_, 0, stmt_id_);
+  SET_VECTOR_ELT(skipped_, 1, start_);
+  SET_VECTOR_ELT(skipped_, 2, end_);
+  SET_VECTOR_ELT(skipped_, 3, reason_);
+  
+  size_t table_idx = 0, skipped_idx = 0;
+  for (size_t i = 0; i < count; i++) {
+    const script_stmt *stmt = &stmts[i];
+    
+    if (stmt->table != NULL) {
+      tables  [table_idx] = stmt->table;
+      stmt_ids[table_idx] = first_id + (int)i;
+      table_idx++;
+      continue;
+    }
+    
+    INTEGER(stmt_id_)[skipped_idx] = first_id + (int)i;
+    REAL   (start_  )[skipped_idx] = (double)(stmt->offset + 1);
+    REAL   (end_    )[skipped_idx] = (double)(stmt->offset + stmt->length);
+    SET_STRING_ELT(reason_, skipped_idx, STRING_ELT(
+      skip_reasons_, stmt->error == SQL3ERROR_UNSUPPORTEDSQL ? 0 : 1
+    ));
+    skipped_idx++;
+  }
+  
+  list_to_df(skipped_, nskipped);
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Result: the same data.frames as parse_sql() plus
+  // the 'skipped' statements
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parsed_ = PROTECT(parse_result(tables, stmt_ids, NULL, ntables, flat, R_NilValue)); nprotect++;
+  int nparsed = length(parsed_);
+  
+  SEXP res_ = PROTECT(allocVector(VECSXP, nparsed + 1)); nprotect++;
+  setAttrib(res_, R_NamesSymbol, flat ? flat_script_names_ : script_names_);
+  for (int i = 0; i < nparsed; i++) {
+    SET_VECTOR_ELT(res_, i, VECTOR_ELT(parsed_, i));
+  }
+  SET_VECTOR_ELT(res_, nparsed, skipped_);
+  
+  UNPROTECT(nprotect);
+  return res_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Parse the script held in 'sql' (UTF-8 bytes, not NUL terminated).
+// The tables are views into 'sql' so it must stay valid until the R result
+// has been built, only the strings in the result are copied
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static SEXP parse_script_buffer(const char *sql, size_t sql_len, SEXP flat_, SEXP fields_) {
+  
+  unsigned int nprotect = 0;
+  
+  int flat = asLogical(flat_);
+  if (flat == NA_LOGICAL) {
+    error("'flat' must be TRUE or FALSE");
+  }
+  unsigned fields = parse_fields(fields_);
+  
+  SEXP parser_ = PROTECT(parser_create()); nprotect++;
+  sql3parser *parser = (sql3parser *)R_ExternalPtrAddr(parser_);
+  sql3parser_set_fields(parser, fields);
+  
+  // an empty buffer is an empty script: sql3parse_script() would take a 
+  // length of 0 for a NUL terminated string, which 'sql' is not
+  script_result res = {0};
+  if (sql_len > 0 && sql3parse_script(parser, sql, sql_len, script_callback, &res) != SQL3ERROR_NONE) {
+    parser_release(parser_);
+    error("Out of memory while parsing sql script");
+  }
+  
+  SEXP res_ = PROTECT(script_to_r(res.stmts, res.count, res.ntables, 1, flat)); nprotect++;
+  
+  parser_release(parser_);
+  UNPROTECT(nprotect);
+  return res_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Parse a script of SQL statements
+//
+// @param sql_ single string containing any number of ';' separated statements
+//        or a raw vector with the UTF-8 bytes of the script
+// @param flat_ return flat 'idx_cols' and 'fk_cols' tables instead of list columns
+// @param fields_ character vector of the fields to extract
+// @return list with the 'tables', 'columns' and 'constraints' data.frames of
+//         the parsed statements and 'skipped' (byte ranges of the others)
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_script_(SEXP sql_, SEXP flat_, SEXP fields_) {
+  
+  // raw vectors are parsed in place
+  if (TYPEOF(sql_) == RAWSXP) {
+    return parse_script_buffer((const char *)RAW(sql_), (size_t)XLENGTH(sql_), flat_, fields_);
+  }
+  
+  if (!isString(sql_) || length(sql_) != 1 || STRING_ELT(sql_, 0) == NA_STRING) {
+    error("'sql' must be a single character string or a raw vector");
+  }
+  
+  size_t sql_len;
+  const char *sql = sql_utf8(STRING_ELT(sql_, 0), &sql_len);
+  return parse_script_buffer(sql, sql_len, flat_, fields_);
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Parse a file of SQL statements
+//
+// The file is memory mapped and parsed in place, so it is never read into 
+// an R string. Its contents are assumed to be UTF-8
+//
+// @param path_ path to the file
+// @param flat_,fields_ see parse_script_()
+// @return see parse_script_()
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_file_(SEXP path_, SEXP flat_, SEXP fields_) {
+  
+  SEXP file_ = PROTECT(mapped_file_open(path_));
+  
+  size_t sql_len;
+  const char *sql = mapped_file_data(file_, &sql_len);
+  SEXP res_ = PROTECT(parse_script_buffer(sql, sql_len, flat_, fields_));
+  
+  mapped_file_close(file_);
+  UNPROTECT(2);
+  return res_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Streaming parser fed with chunks read from an R connection.
+//
+// The splitter carries partial statements over chunk boundaries and skips
+// everything which is not a table statement without buffering it. Table
+// statements are copied (the tables are views into them) and parsed as 
+// soon as they are complete. Everything is malloc()ed as it must outlive
+// a single .Call, and released by the finalizer of the external pointer
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+typedef struct {
+  sql3stream   *stream;
+  sql3parser   *parser;
+  int           flat;
+  bool          oom;         // set if an allocation failed inside the callback
+  int           first_id;    // statement id of stmts[0]
+  script_stmt  *stmts;       // statements since the last result
+  size_t        count;
+  size_t        capacity;
+  size_t        ntables;
+  char        **texts;       // copies of the parsed statements
+} stream_state;
+
+
+static void stream_clear(stream_state *state) {
+  for (size_t i = 0; i < state->ntables; i++) {
+    free(state->texts[i]);
+  }
+  state->first_id += (int)state->count;
+  state->count   = 0;
+  state->ntables = 0;
+  sql3parser_reset(state->parser);
+}
+
+
+static void stream_finalizer(SEXP stream_) {
+  stream_state *state = (stream_state *)R_ExternalPtrAddr(stream_);
+  if (state != NULL) {
+    if (state->parser != NULL) stream_clear(state);
+    sql3stream_free(state->stream);
+    sql3parser_free(state->parser);
+    free(state->stmts);
+    free(state->texts);
+    free(state);
+    R_ClearExternalPtr(stream_);
+  }
+}
+
+
+static bool stream_callback(void *xdata, const char *sql, const sql3split_statement *split) {
+  stream_state *state = (stream_state *)xdata;
+  
+  if (state->count == state->capacity) {
+    size_t capacity = (state->capacity == 0) ? 64 : state->capacity * 2;
+    script_stmt *stmts = (script_stmt *)realloc(state->stmts, capacity * sizeof(script_stmt));
+    char **texts = (char **)realloc(state->texts, capacity * sizeof(char *));
+    if (stmts != NULL) state->stmts = stmts;
+    if (texts != NULL) state->texts = texts;
+    if (stmts == NULL || texts == NULL) {
+      state->oom = true;
+      return false;
+    }
+    state->capacity = capacity;
+  }
+  
+  script_stmt *stmt = &state->stmts[state->count++];
+  stmt->table  = NULL;
+  stmt->offset = split->offset;
+  stmt->length = split->length;
+  stmt->error  = SQL3ERROR_UNSUPPORTEDSQL;
+  
+  // only statements that start like a table definition are handed to the parser
+  if (sql == NULL || (split->kind != SQL3SPLIT_CREATE_TABLE && split->kind != SQL3SPLIT_ALTER_TABLE)) {
+    return true;
+  }
+  
+  char *text = (char *)malloc(split->length);
+  if (text == NULL) {
+    state->oom = true;
+    return false;
+  }
+  memcpy(text, sql, split->length);
+  
+  stmt->table = sql3parser_parse(state->parser, text, split->length, &stmt->error);
+  if (stmt->error == SQL3ERROR_MEMORY) {
+    free(text);
+    state->oom = true;
+    return false;
+  }
+  if (stmt->table == NULL) {
+    free(text);
+    return true;
+  }
+  
+  state->texts[state->ntables++] = text;
+  return true;
+}
+
+
+static stream_state *stream_get(SEXP stream_) {
+  stream_state *state = (TYPEOF(stream_) == EXTPTRSXP) ? (stream_state *)R_ExternalPtrAddr(stream_) : NULL;
+  if (state == NULL) {
+    error("Invalid sql stream");
+  }
+  return state;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Create a streaming parser
+//
+// @param flat_,fields_ see parse_script_()
+// @return external pointer to the stream
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP stream_create_(SEXP flat_, SEXP fields_) {
+  
+  int flat = asLogical(flat_);
+  if (flat == NA_LOGICAL) {
+    error("'flat' must be TRUE or FALSE");
+  }
+  unsigned fields = parse_fields(fields_);
+  
+  stream_state *state = (stream_state *)calloc(1, sizeof(stream_state));
+  if (state == NULL) {
+    error("Couldn't allocate the sql stream");
+  }
+  state->flat     = flat;
+  state->first_id = 1;
+  
+  SEXP stream_ = PROTECT(R_MakeExternalPtr(state, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(stream_, stream_finalizer, FALSE);
+  
+  state->stream = sql3stream_create();
+  state->parser = sql3parser_create();
+  if (state->stream == NULL || state->parser == NULL) {
+    stream_finalizer(stream_);
+    error("Couldn't allocate the sql stream");
+  }
+  sql3parser_set_fields(state->parser, fields);
+  
+  UNPROTECT(1);
+  return stream_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Feed the next chunk of the script to the stream
+//
+// @param stream_ stream created by stream_create_()
+// @param chunk_ raw vector with the next bytes of the script
+// @return NULL
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP stream_feed_(SEXP stream_, SEXP chunk_) {
+  
+  stream_state *state = stream_get(stream_);
+  if (TYPEOF(chunk_) != RAWSXP) {
+    error("'chunk' must be a raw vector");
+  }
+  
+  sql3stream_feed(state->stream, (const char *)RAW(chunk_), (size_t)XLENGTH(chunk_), stream_callback, state);
+  if (state->oom) {
+    error("Out of memory while parsing sql stream");
+  }
+  
+  return R_NilValue;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Results for the statements completed since the previous call
+//
+// @param stream_ stream created by stream_create_()
+// @param final_ TRUE once the whole script has been fed. An unterminated
+//        last statement is then reported as well
+// @return see parse_script_(). Byte positions are relative to the start
+//         of the stream
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP stream_result_(SEXP stream_, SEXP final_) {
+  
+  stream_state *state = stream_get(stream_);
+  
+  if (asLogical(final_) == TRUE) {
+    sql3stream_finish(state->stream, stream_callback, state);
+    if (state->oom) {
+      error("Out of memory while parsing sql stream");
+    }
+  }
+  
+  SEXP res_ = PROTECT(script_to_r(state->stmts, state->count, state->ntables, state->first_id, state->flat));
+  stream_clear(state);
+  
+  UNPROTECT(1);
+  return res_;
+}
@@ -0,0 +1,1234 @@
+//
+//  sql3db.c
+//
+//  Header, b-tree pages, overflow chains and records of the SQLite file
+//  format (https://www.sqlite.org/fileformat2.html).
+//
+
+#include "sql3db.h"
+#include "sql3pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#define SQL3DB_HEADER_SIZE          100
+#define SQL3DB_STAMP_SIZE           44      // header up to the end of the schema cookie
+#define SQL3DB_MAX_DEPTH            20      // deepest b-tree accepted by sqlite itself
+#define SQL3DB_PAGE_BUFFERS         (SQL3DB_MAX_DEPTH + 2)  // a page per b-tree level and one for overflow pages
+
+#define SQL3DB_PAGE_INDEX_INTERIOR  0x02
+#define SQL3DB_PAGE_TABLE_INTERIOR  0x05
+#define SQL3DB_PAGE_INDEX_LEAF      0x0A
+#define SQL3DB_PAGE_TABLE_LEAF      0x0D
+
+#define SQL3DB_WAL_HEADER_SIZE      32
+#define SQL3DB_WAL_FRAME_HEADER     24
+#define SQL3DB_WAL_MAGIC            0x377f0682  // checksums are big-endian if the lowest bit is set
+#define SQL3DB_WAL_VERSION          3007000
+#define SQL3DB_WAL_BATCH            262144  // bytes of frames read at a time when only the header is needed
+
+#define SQL3DB_CRAWL_CHUNK          4       // files handed to a worker at a time
+#define SQL3DB_ANALYZE_CHUNK        1       // b-trees vary too much in size to be handed out in groups
+#define SQL3DB_TEXT_BLOCK           16384
+
+// Pages are read with positional reads into private buffers rather than mapped: sqlite shrinks the
+// database and the -wal file in place (checkpoints, vacuum, journal_size_limit) and a mapped page past
+// the new end of the file would fault on access. A short read is reported as an error instead.
+#ifdef _WIN32
+typedef HANDLE sql3file;
+#define SQL3DB_NOFILE               INVALID_HANDLE_VALUE
+#else
+typedef int sql3file;
+#define SQL3DB_NOFILE               (-1)
+#endif
+
+struct sql3db {
+	sql3file            file;               // kept open, pages are read on demand
+	size_t              size;               // size of the file when it was opened
+	uint32_t            page_size;
+	uint32_t            usable_size;        // page size minus the bytes reserved at the end of every page
+	uint32_t            npages;
+	sql3db_encoding     encoding;
+	uint32_t            change_counter;
+	uint32_t            schema_cookie;
+
+	uint8_t             *wal;               // committed frames of the -wal file read in memory (NULL without any)
+	uint32_t            *wal_index;         // open addressing hash of (page number, frame + 1) pairs
+	uint32_t            wal_mask;
+};
+
+typedef struct {
+	sql3db              *db;
+	bool                is_table;           // kind of b-tree being walked
+	sql3db_cell_callback callback;
+	void                *xdata;
+	uint8_t             *pages;             // SQL3DB_PAGE_BUFFERS pages read from the database file
+	uint8_t             *buffer;            // payloads reassembled from overflow pages
+	size_t              capacity;
+	uint32_t            budget;             // b-tree pages left to visit, a page linked twice is corrupt
+	bool                stopped;
+} sql3walk;
+
+typedef struct {
+	const uint8_t       *page;
+	const uint8_t       *header;            // b-tree page header (after the database header on page 1)
+	const uint8_t       *pointers;          // cell pointer array
+	uint32_t            ncells;
+	bool                interior;
+} sql3node;
+
+typedef struct {
+	sql3db_schema_callback callback;
+	void                *xdata;
+	sql3db_encoding     encoding;
+	char                *buffer;            // UTF-8 copies of UTF-16 strings
+	size_t              capacity;
+	sql3db_error        error;
+} sql3schema;
+
+// strings are copied to blocks which never move, so entries can point into them while more are added
+typedef struct sql3text {
+	struct sql3text     *next;
+	size_t              used;
+	size_t              size;
+	char                data[];
+} sql3text;
+
+typedef struct {
+	sql3db_schema_file  *file;
+	size_t              capacity;
+	sql3db_error        error;
+} sql3crawl;
+
+typedef struct {
+	const char          **paths;
+	sql3parser          **parsers;
+	sql3db_schema_file  *files;
+} sql3crawlbatch;
+
+typedef struct {
+	sql3db              *db;
+	sql3db_btree_stats  *stats;
+} sql3analyzebatch;
+
+// MARK: - Utils -
+
+static inline uint32_t get2 (const uint8_t *p) {
+	return ((uint32_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t get4 (const uint8_t *p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint32_t get4le (const uint8_t *p) {
+	return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static size_t get_varint (const uint8_t *p, const uint8_t *end, uint64_t *value) {
+	// return the number of bytes read, 0 if the varint runs past end
+	uint64_t v = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		if (p + i >= end) return 0;
+		v = (v << 7) | (p[i] & 0x7F);
+		if ((p[i] & 0x80) == 0) {*value = v; return i + 1;}
+	}
+
+	// the 9th byte contributes all of its 8 bits
+	if (p + 8 >= end) return 0;
+	*value = (v << 8) | p[8];
+	return 9;
+}
+
+static int64_t get_int (const uint8_t *p, size_t n) {
+	// big-endian two's complement integer of n bytes
+	uint64_t v = (p[0] & 0x80) ? ~(uint64_t)0 : 0;
+	for (size_t i = 0; i < n; ++i) v = (v << 8) | p[i];
+	return (int64_t)v;
+}
+
+static size_t utf16_to_utf8 (const uint8_t *src, size_t length, bool big_endian, char *dst) {
+	// dst must hold 3 bytes per UTF-16 code unit, unpaired surrogates become U+FFFD
+	uint8_t *out = (uint8_t *)dst;
+	size_t i = 0;
+
+	#define UTF16_UNIT(k)   (big_endian ? (((uint32_t)src[k] << 8) | src[(k) + 1]) : (((uint32_t)src[(k) + 1] << 8) | src[k]))
+	while (i + 1 < length) {
+		uint32_t c = UTF16_UNIT(i);
+		i += 2;
+
+		if ((c >= 0xD800) && (c <= 0xDBFF) && (i + 1 < length)) {
+			uint32_t c2 = UTF16_UNIT(i);
+			if ((c2 >= 0xDC00) && (c2 <= 0xDFFF)) {
+				c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+				i += 2;
+			}
+		}
+		if ((c >= 0xD800) && (c <= 0xDFFF)) c = 0xFFFD;
+
+		if (c < 0x80) {
+			*out++ = (uint8_t)c;
+		} else if (c < 0x800) {
+			*out++ = (uint8_t)(0xC0 | (c >> 6));
+			*out++ = (uint8_t)(0x80 | (c & 0x3F));
+		} else if (c < 0x10000) {
+			*out++ = (uint8_t)(0xE0 | (c >> 12));
+			*out++ = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+			*out++ = (uint8_t)(0x80 | (c & 0x3F));
+		} else {
+			*out++ = (uint8_t)(0xF0 | (c >> 18));
+			*out++ = (uint8_t)(0x80 | ((c >> 12) & 0x3F));
+			*out++ = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+			*out++ = (uint8_t)(0x80 | (c & 0x3F));
+		}
+	}
+	#undef UTF16_UNIT
+
+	return (size_t)(out - (uint8_t *)dst);
+}
+
+// MARK: - File access -
+
+static sql3file sql3file_open (const char *path, size_t *size) {
+	// open a regular file for reading, SQL3DB_NOFILE on error
+	*size = 0;
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (handle == INVALID_HANDLE_VALUE) return SQL3DB_NOFILE;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(handle, &file_size) || ((uint64_t)file_size.QuadPart > SIZE_MAX)) {
+		CloseHandle(handle);
+		return SQL3DB_NOFILE;
+	}
+	*size = (size_t)file_size.QuadPart;
+	return handle;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return SQL3DB_NOFILE;
+
+	struct stat st;
+	if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || ((uint64_t)st.st_size > SIZE_MAX)) {
+		close(fd);
+		return SQL3DB_NOFILE;
+	}
+	*size = (size_t)st.st_size;
+	return fd;
+#endif
+}
+
+static void sql3file_close (sql3file file) {
+	if (file == SQL3DB_NOFILE) return;
+#ifdef _WIN32
+	CloseHandle(file);
+#else
+	close(file);
+#endif
+}
+
+static size_t sql3file_read (sql3file file, uint64_t offset, uint8_t *buffer, size_t size) {
+	// read size bytes at offset without moving a shared file position (safe from several threads),
+	// returns the number of bytes read which is less than size at the end of the file or on error
+	size_t nread = 0;
+
+	while (nread < size) {
+		size_t chunk = (size - nread < ((size_t)1 << 30)) ? size - nread : ((size_t)1 << 30);
+#ifdef _WIN32
+		OVERLAPPED at = {0};
+		at.Offset = (DWORD)(offset + nread);
+		at.OffsetHigh = (DWORD)((offset + nread) >> 32);
+		DWORD n = 0;
+		if (!ReadFile(file, buffer + nread, (DWORD)chunk, &n, &at) || (n == 0)) break;
+#else
+		ssize_t n = pread(file, buffer + nread, chunk, (off_t)(offset + nread));
+		if ((n < 0) && (errno == EINTR)) continue;
+		if (n <= 0) break;
+#endif
+		nread += (size_t)n;
+	}
+
+	return nread;
+}
+
+static sql3db_error sql3db_read_prefix (const char *path, uint8_t *buffer, size_t size, size_t *nread) {
+	// read the first size bytes of the file (fewer if the file is shorter)
+	size_t file_size;
+	*nread = 0;
+
+	sql3file file = sql3file_open(path, &file_size);
+	if (file == SQL3DB_NOFILE) return SQL3DB_CANTOPEN;
+	*nread = sql3file_read(file, 0, buffer, size);
+	sql3file_close(file);
+
+	return SQL3DB_OK;
+}
+
+static char *sql3db_wal_path (const char *path) {
+	size_t length = strlen(path);
+	char *wal_path = (char *)malloc(length + 5);
+	if (wal_path) {
+		memcpy(wal_path, path, length);
+		memcpy(wal_path + length, "-wal", 5);
+	}
+	return wal_path;
+}
+
+// MARK: - WAL -
+
+static void sql3wal_checksum (const uint8_t *p, size_t size, bool big_endian, uint32_t *s0, uint32_t *s1) {
+	// running checksum of the WAL over size bytes (a multiple of 8)
+	uint32_t a = *s0, b = *s1;
+	if (big_endian) {
+		for (size_t i = 0; i < size; i += 8) {
+			a += get4(p + i) + b;
+			b += get4(p + i + 4) + a;
+		}
+	} else {
+		for (size_t i = 0; i < size; i += 8) {
+			a += get4le(p + i) + b;
+			b += get4le(p + i + 4) + a;
+		}
+	}
+	*s0 = a;
+	*s1 = b;
+}
+
+static inline uint32_t sql3wal_slot (const sql3db *db, uint32_t pgno) {
+	return (pgno * 0x9E3779B1u) & db->wal_mask;
+}
+
+static const uint8_t *sql3wal_page (const sql3db *db, uint32_t pgno) {
+	// latest committed copy of the page in the WAL, NULL if the page is only in the database file
+	if (!db->wal_index) return NULL;
+
+	const uint32_t *index = db->wal_index;
+	for (uint32_t slot = sql3wal_slot(db, pgno); index[2 * slot] != 0; slot = (slot + 1) & db->wal_mask) {
+		if (index[2 * slot] != pgno) continue;
+		size_t frame = index[2 * slot + 1];
+		return db->wal + SQL3DB_WAL_HEADER_SIZE + frame * (SQL3DB_WAL_FRAME_HEADER + db->page_size) + SQL3DB_WAL_FRAME_HEADER;
+	}
+	return NULL;
+}
+
+static uint32_t sql3wal_header (const uint8_t *h, size_t size, uint32_t page_size, uint32_t *s0, uint32_t *s1) {
+	// page size of the WAL if its header is valid and matches the page size of the database (any if 0),
+	// 0 otherwise. s0 and s1 are set to the checksum of the header, which the first frame continues.
+	if (size < SQL3DB_WAL_HEADER_SIZE) return 0;
+
+	uint32_t wal_page_size = get4(h + 8);
+	if (((get4(h) & ~1u) != SQL3DB_WAL_MAGIC) || (get4(h + 4) != SQL3DB_WAL_VERSION)) return 0;
+	if ((wal_page_size < 512) || (wal_page_size > 65536) || ((wal_page_size & (wal_page_size - 1)) != 0)) return 0;
+	if ((page_size != 0) && (wal_page_size != page_size)) return 0;
+
+	*s0 = *s1 = 0;
+	sql3wal_checksum(h, 24, (get4(h) & 1) != 0, s0, s1);
+	if ((*s0 != get4(h + 24)) || (*s1 != get4(h + 28))) return 0;
+	return wal_page_size;
+}
+
+static bool sql3wal_frame (const uint8_t *h, const uint8_t *frame, uint32_t page_size, uint32_t *s0, uint32_t *s1) {
+	// check the salt of the frame and continue the running checksum over it. Like sqlite when it recovers
+	// a WAL, frames are trusted up to the first one that fails (left over from a previous generation or
+	// partially written).
+	if ((get4(frame) == 0) || (memcmp(frame + 8, h + 16, 8) != 0)) return false;
+
+	bool big_endian = (get4(h) & 1) != 0;
+	sql3wal_checksum(frame, 8, big_endian, s0, s1);
+	sql3wal_checksum(frame + SQL3DB_WAL_FRAME_HEADER, page_size, big_endian, s0, s1);
+	return (*s0 == get4(frame + 16)) && (*s1 == get4(frame + 20));
+}
+
+static uint32_t sql3wal_scan (const uint8_t *wal, size_t size, uint32_t page_size, uint32_t s0, uint32_t s1, size_t *ncommitted) {
+	// count the frames up to the last commit frame that can be trusted and return the size of the
+	// database after that commit
+	size_t frame_size = SQL3DB_WAL_FRAME_HEADER + page_size;
+	size_t nframes = (size - SQL3DB_WAL_HEADER_SIZE) / frame_size;
+	uint32_t npages = 0;
+	*ncommitted = 0;
+
+	for (size_t i = 0; i < nframes; ++i) {
+		const uint8_t *frame = wal + SQL3DB_WAL_HEADER_SIZE + i * frame_size;
+		if (!sql3wal_frame(wal, frame, page_size, &s0, &s1)) break;
+
+		// commit frames store the size of the database in pages
+		if (get4(frame + 4) != 0) {
+			npages = get4(frame + 4);
+			*ncommitted = i + 1;
+		}
+	}
+
+	return npages;
+}
+
+static sql3db_error sql3wal_load (sql3db *db, const char *path, uint32_t page_size) {
+	// read the -wal file of the database and index the pages of its committed frames. Nothing is locked
+	// or written: transactions committed after the file is read are not seen. A missing or invalid WAL
+	// is ignored. page_size is 0 if the database file is empty (the WAL then sets it).
+	char *wal_path = sql3db_wal_path(path);
+	if (!wal_path) return SQL3DB_MEMORY;
+
+	size_t size;
+	sql3file file = sql3file_open(wal_path, &size);
+	free(wal_path);
+	if (file == SQL3DB_NOFILE) return SQL3DB_OK;
+	if (size < SQL3DB_WAL_HEADER_SIZE) {
+		sql3file_close(file);
+		return SQL3DB_OK;
+	}
+
+	uint8_t *wal = (uint8_t *)malloc(size);
+	if (!wal) {
+		sql3file_close(file);
+		return SQL3DB_MEMORY;
+	}
+
+	// a WAL truncated since its size was taken is read up to its new end, the checksums of the frames
+	// tell which ones are complete
+	size = sql3file_read(file, 0, wal, size);
+	sql3file_close(file);
+
+	uint32_t s0, s1;
+	uint32_t wal_page_size = sql3wal_header(wal, size, page_size, &s0, &s1);
+
+	size_t ncommitted = 0;
+	uint32_t npages = (wal_page_size != 0) ? sql3wal_scan(wal, size, wal_page_size, s0, s1, &ncommitted) : 0;
+	if ((ncommitted == 0) || (ncommitted > UINT32_MAX / 4)) {
+		free(wal);
+		return SQL3DB_OK;
+	}
+
+	// only the committed frames are kept
+	size_t frame_size = SQL3DB_WAL_FRAME_HEADER + wal_page_size;
+	uint8_t *committed = (uint8_t *)realloc(wal, SQL3DB_WAL_HEADER_SIZE + ncommitted * frame_size);
+	if (committed) wal = committed;
+
+	// at most half full, later frames replace earlier copies of the same page
+	uint32_t capacity = 16;
+	while (capacity < 2 * ncommitted) capacity <<= 1;
+	uint32_t *index = (uint32_t *)calloc(2 * (size_t)capacity, sizeof(uint32_t));
+	if (!index) {
+		free(wal);
+		return SQL3DB_MEMORY;
+	}
+
+	db->wal = wal;
+	db->wal_index = index;
+	db->wal_mask = capacity - 1;
+	db->page_size = wal_page_size;
+	db->npages = npages;
+
+	for (size_t i = 0; i < ncommitted; ++i) {
+		uint32_t pgno = get4(wal + SQL3DB_WAL_HEADER_SIZE + i * frame_size);
+		uint32_t slot = sql3wal_slot(db, pgno);
+		while ((index[2 * slot] != 0) && (index[2 * slot] != pgno)) slot = (slot + 1) & db->wal_mask;
+		index[2 * slot] = pgno;
+		index[2 * slot + 1] = (uint32_t)i;
+	}
+
+	return SQL3DB_OK;
+}
+
+// MARK: - Header -
+
+static uint32_t sql3db_header_page_size (const uint8_t *h) {
+	// power of two between 512 and 65536 (stored as 1), 0 if invalid
+	uint32_t page_size = get2(h + 16);
+	if (page_size == 1) page_size = 65536;
+	if ((page_size < 512) || (page_size > 65536) || ((page_size & (page_size - 1)) != 0)) return 0;
+	return page_size;
+}
+
+static sql3db_error sql3wal_read_stamp (const char *path, uint32_t page_size, uint8_t *stamp, bool *found) {
+	// copy the first SQL3DB_STAMP_SIZE bytes of the last committed copy of page 1 in the -wal file to stamp,
+	// found is false if no committed frame holds page 1. The frames are checked like sql3wal_load does,
+	// but read through a fixed buffer and not kept. page_size is 0 if the database file is empty.
+	*found = false;
+
+	char *wal_path = sql3db_wal_path(path);
+	if (!wal_path) return SQL3DB_MEMORY;
+
+	size_t size;
+	sql3file file = sql3file_open(wal_path, &size);
+	free(wal_path);
+	if (file == SQL3DB_NOFILE) return SQL3DB_OK;
+
+	uint8_t h[SQL3DB_WAL_HEADER_SIZE];
+	uint32_t s0, s1;
+	uint32_t wal_page_size = sql3wal_header(h, sql3file_read(file, 0, h, sizeof(h)), page_size, &s0, &s1);
+	if (wal_page_size == 0) {
+		sql3file_close(file);
+		return SQL3DB_OK;
+	}
+
+	size_t frame_size = SQL3DB_WAL_FRAME_HEADER + wal_page_size;
+	size_t batch = (frame_size < SQL3DB_WAL_BATCH) ? SQL3DB_WAL_BATCH / frame_size : 1;
+	uint8_t *buffer = (uint8_t *)malloc(batch * frame_size);
+	if (!buffer) {
+		sql3file_close(file);
+		return SQL3DB_MEMORY;
+	}
+
+	// page 1 written by a transaction only counts once its commit frame has been checked
+	uint8_t pending[SQL3DB_STAMP_SIZE];
+	bool has_pending = false;
+	bool committed = false;
+	uint64_t offset = SQL3DB_WAL_HEADER_SIZE;
+	size_t nframes = batch;
+
+	while (nframes == batch) {
+		nframes = sql3file_read(file, offset, buffer, batch * frame_size) / frame_size;
+		offset += (uint64_t)nframes * frame_size;
+
+		for (size_t i = 0; i < nframes; ++i) {
+			const uint8_t *frame = buffer + i * frame_size;
+			if (!sql3wal_frame(h, frame, wal_page_size, &s0, &s1)) {
+				nframes = 0;
+				break;
+			}
+
+			if (get4(frame) == 1) {
+				memcpy(pending, frame + SQL3DB_WAL_FRAME_HEADER, SQL3DB_STAMP_SIZE);
+				has_pending = true;
+			}
+			if (get4(frame + 4) != 0) {
+				committed = true;
+				if (has_pending) memcpy(stamp, pending, SQL3DB_STAMP_SIZE);
+				*found = has_pending;
+			}
+		}
+	}
+
+	free(buffer);
+	sql3file_close(file);
+
+	// same checks as sql3db_read_header
+	if (*found && ((memcmp(stamp, "SQLite format 3", 16) != 0) || (sql3db_header_page_size(stamp) != wal_page_size))) return SQL3DB_NOTADB;
+	if (committed && !*found && (page_size == 0)) return SQL3DB_CORRUPT;
+	return SQL3DB_OK;
+}
+
+static sql3db_error sql3db_read_header (sql3db *db, const char *path) {
+	uint8_t header[SQL3DB_HEADER_SIZE];
+	const uint8_t *h = NULL;
+	if (db->size > 0) {
+		if ((db->size < SQL3DB_HEADER_SIZE) || (sql3file_read(db->file, 0, header, SQL3DB_HEADER_SIZE) < SQL3DB_HEADER_SIZE)) return SQL3DB_NOTADB;
+		h = header;
+		if (memcmp(h, "SQLite format 3", 16) != 0) return SQL3DB_NOTADB;
+		if ((db->page_size = sql3db_header_page_size(h)) == 0) return SQL3DB_NOTADB;
+	}
+
+	// in WAL mode (or for a database not checkpointed yet) the latest copy of page 1 may be in the WAL
+	if ((db->size == 0) || (h[18] == 2) || (h[19] == 2)) {
+		sql3db_error error = sql3wal_load(db, path, db->page_size);
+		if (error != SQL3DB_OK) return error;
+
+		const uint8_t *page = sql3wal_page(db, 1);
+		if (page) h = page;
+		else if (db->wal && !h) return SQL3DB_CORRUPT;
+	}
+
+	// an empty file is an empty database
+	if (!h) {
+		db->page_size = db->usable_size = 4096;
+		db->encoding = SQL3DB_UTF8;
+		return SQL3DB_OK;
+	}
+
+	if ((memcmp(h, "SQLite format 3", 16) != 0) || (sql3db_header_page_size(h) != db->page_size)) return SQL3DB_NOTADB;
+
+	// read version 1 (rollback journal) or 2 (WAL), fixed payload fractions
+	if ((h[19] < 1) || (h[19] > 2)) return SQL3DB_NOTADB;
+	if ((h[21] != 64) || (h[22] != 32) || (h[23] != 32)) return SQL3DB_NOTADB;
+
+	uint32_t usable_size = db->page_size - h[20];
+	if (usable_size < 480) return SQL3DB_NOTADB;
+
+	uint32_t encoding = get4(h + 56);
+	if (encoding > SQL3DB_UTF16BE) return SQL3DB_NOTADB;
+
+	db->usable_size = usable_size;
+	db->encoding = (encoding == 0) ? SQL3DB_UTF8 : (sql3db_encoding)encoding;
+	db->change_counter = get4(h + 24);
+	db->schema_cookie = get4(h + 40);
+
+	// with a WAL the size of the database is the one of the last commit. Otherwise the page count in the
+	// header is only valid if written by the same version that last changed the file.
+	if (db->wal) return SQL3DB_OK;
+
+	size_t file_pages = db->size / db->page_size;
+	db->npages = get4(h + 28);
+	if ((db->npages == 0) || (get4(h + 92) != db->change_counter) || (db->npages > file_pages)) {
+		db->npages = (file_pages > UINT32_MAX) ? UINT32_MAX : (uint32_t)file_pages;
+	}
+
+	return SQL3DB_OK;
+}
+
+static const uint8_t *sql3db_page (const sql3db *db, uint32_t pgno, uint8_t *buffer) {
+	// the copy of the page in the WAL or the page read from the database file into buffer, NULL if the
+	// page is not in the database or can't be read in full (the file was truncated after it was opened)
+	if ((pgno == 0) || (pgno > db->npages)) return NULL;
+
+	// pages beyond the end of the database file can only come from the WAL
+	const uint8_t *page = sql3wal_page(db, pgno);
+	if (page) return page;
+	if ((uint64_t)pgno * db->page_size > db->size) return NULL;
+	if (sql3file_read(db->file, (uint64_t)(pgno - 1) * db->page_size, buffer, db->page_size) < db->page_size) return NULL;
+	return buffer;
+}
+
+// MARK: - B-tree -
+
+static uint32_t sql3db_local_size (const sql3db *db, bool is_table, uint64_t size) {
+	// number of payload bytes stored in the cell itself, the rest spills to overflow pages
+	uint32_t u = db->usable_size;
+	uint32_t x = is_table ? (u - 35) : (((u - 12) * 64 / 255) - 23);
+	if (size <= x) return (uint32_t)size;
+
+	uint32_t m = ((u - 12) * 32 / 255) - 23;
+	uint32_t k = m + (uint32_t)((size - m) % (u - 4));
+	return (k <= x) ? k : m;
+}
+
+static sql3db_error sql3walk_payload (sql3walk *walk, const uint8_t *cell, const uint8_t *end, uint64_t size, const uint8_t **payload) {
+	const sql3db *db = walk->db;
+
+	uint32_t local = sql3db_local_size(db, walk->is_table, size);
+	if ((size_t)(end - cell) < (size_t)local) return SQL3DB_CORRUPT;
+	if (local == size) {*payload = cell; return SQL3DB_OK;}
+
+	// the payload can't be larger than the overflow pages the file could hold
+	if (((size_t)(end - cell) < (size_t)local + 4) || (size > (uint64_t)db->npages * db->usable_size)) return SQL3DB_CORRUPT;
+
+	if (walk->capacity < size) {
+		uint8_t *buffer = (uint8_t *)realloc(walk->buffer, (size_t)size);
+		if (!buffer) return SQL3DB_MEMORY;
+		walk->buffer = buffer;
+		walk->capacity = (size_t)size;
+	}
+
+	memcpy(walk->buffer, cell, local);
+	size_t copied = local;
+	uint32_t next = get4(cell + local);
+	uint32_t hops = 0;
+
+	while (copied < size) {
+		const uint8_t *page = sql3db_page(db, next, walk->pages + (size_t)(SQL3DB_PAGE_BUFFERS - 1) * db->page_size);
+		if (!page || (++hops > db->npages)) return SQL3DB_CORRUPT;
+
+		size_t n = (size - copied < db->usable_size - 4) ? (size_t)(size - copied) : db->usable_size - 4;
+		memcpy(walk->buffer + copied, page + 4, n);
+		copied += n;
+		next = get4(page);
+	}
+
+	*payload = walk->buffer;
+	return SQL3DB_OK;
+}
+
+static sql3db_error sql3db_node (const sql3db *db, uint32_t pgno, bool is_table, int depth, uint32_t *budget, uint8_t *pages, sql3node *node) {
+	// read the b-tree page into the buffer of its level in pages and check that its type and cell pointer
+	// array fit the b-tree being walked. A b-tree has at most as many pages as the file, more visits mean
+	// pages are linked more than once.
+	if ((depth > SQL3DB_MAX_DEPTH) || (*budget == 0)) return SQL3DB_CORRUPT;
+	const uint8_t *page = sql3db_page(db, pgno, pages + (size_t)depth * db->page_size);
+	if (!page) return SQL3DB_CORRUPT;
+	--*budget;
+
+	// page 1 starts with the database header
+	const uint8_t *end = page + db->usable_size;
+	const uint8_t *header = page + ((pgno == 1) ? SQL3DB_HEADER_SIZE : 0);
+
+	uint8_t type = header[0];
+	bool table_page = (type == SQL3DB_PAGE_TABLE_INTERIOR) || (type == SQL3DB_PAGE_TABLE_LEAF);
+	bool index_page = (type == SQL3DB_PAGE_INDEX_INTERIOR) || (type == SQL3DB_PAGE_INDEX_LEAF);
+	if ((!table_page && !index_page) || (table_page != is_table)) return SQL3DB_CORRUPT;
+
+	node->page = page;
+	node->header = header;
+	node->interior = (type == SQL3DB_PAGE_TABLE_INTERIOR) || (type == SQL3DB_PAGE_INDEX_INTERIOR);
+	node->ncells = get2(header + 3);
+	node->pointers = header + (node->interior ? 12 : 8);
+	if ((size_t)(end - node->pointers) < 2 * (size_t)node->ncells) return SQL3DB_CORRUPT;
+
+	return SQL3DB_OK;
+}
+
+static sql3db_error sql3walk_page (sql3walk *walk, uint32_t pgno, int depth) {
+	const sql3db *db = walk->db;
+	bool is_table = walk->is_table;
+
+	sql3node node;
+	sql3db_error error = sql3db_node(db, pgno, is_table, depth, &walk->budget, walk->pages, &node);
+	if (error != SQL3DB_OK) return error;
+
+	const uint8_t *page = node.page;
+	const uint8_t *end = page + db->usable_size;
+	bool interior = node.interior;
+
+	for (uint32_t i = 0; i < node.ncells; ++i) {
+		uint32_t offset = get2(node.pointers + 2 * i);
+		if (offset >= db->usable_size) return SQL3DB_CORRUPT;
+		const uint8_t *cell = page + offset;
+
+		// interior cells start with the left child, which holds the smaller keys
+		if (interior) {
+			if (end - cell < 4) return SQL3DB_CORRUPT;
+			if ((error = sql3walk_page(walk, get4(cell), depth + 1)) != SQL3DB_OK) return error;
+			if (walk->stopped) return SQL3DB_OK;
+
+			// table interior cells only hold a rowid key, index interior cells hold a record too
+			if (is_table) continue;
+			cell += 4;
+		}
+
+		uint64_t size, rowid = 0;
+		size_t n = get_varint(cell, end, &size);
+		if (!n) return SQL3DB_CORRUPT;
+		cell += n;
+
+		if (is_table) {
+			if (!(n = get_varint(cell, end, &rowid))) return SQL3DB_CORRUPT;
+			cell += n;
+		}
+
+		const uint8_t *payload;
+		if ((error = sql3walk_payload(walk, cell, end, size, &payload)) != SQL3DB_OK) return error;
+		if (!walk->callback(walk->xdata, (int64_t)rowid, payload, (size_t)size)) {
+			walk->stopped = true;
+			return SQL3DB_OK;
+		}
+	}
+
+	if (interior) return sql3walk_page(walk, get4(node.header + 8), depth + 1);
+	return SQL3DB_OK;
+}
+
+static sql3db_error sql3walk_count (const sql3db *db, uint32_t pgno, bool is_table, int depth, uint32_t *budget, uint8_t *pages, uint64_t *count) {
+	sql3node node;
+	sql3db_error error = sql3db_node(db, pgno, is_table, depth, budget, pages, &node);
+	if (error != SQL3DB_OK) return error;
+
+	// only leaf cells hold rows in table b-trees, every cell holds a key in index b-trees
+	if (!node.interior || !is_table) *count += node.ncells;
+	if (!node.interior) return SQL3DB_OK;
+
+	for (uint32_t i = 0; i < node.ncells; ++i) {
+		uint32_t offset = get2(node.pointers + 2 * i);
+		if (offset > db->usable_size - 4) return SQL3DB_CORRUPT;
+		if ((error = sql3walk_count(db, get4(node.page + offset), is_table, depth + 1, budget, pages, count)) != SQL3DB_OK) return error;
+	}
+	return sql3walk_count(db, get4(node.header + 8), is_table, depth + 1, budget, pages, count);
+}
+
+static sql3db_error sql3db_walk (sql3db *db, uint32_t root, bool is_table, sql3db_cell_callback callback, void *xdata) {
+	// an empty file has no page 1 but is a valid (empty) database
+	if ((db->npages == 0) && (root == 1)) return SQL3DB_OK;
+
+	sql3walk walk = {.db = db, .is_table = is_table, .callback = callback, .xdata = xdata, .budget = db->npages};
+	walk.pages = (uint8_t *)malloc((size_t)SQL3DB_PAGE_BUFFERS * db->page_size);
+	if (!walk.pages) return SQL3DB_MEMORY;
+
+	sql3db_error error = sql3walk_page(&walk, root, 0);
+	free(walk.pages);
+	free(walk.buffer);
+
+	return error;
+}
+
+// MARK: - Records -
+
+int sql3db_record_decode (const uint8_t *payload, size_t size, sql3db_value *values, int nvalues) {
+	const uint8_t *end = payload + size;
+
+	// header: its own size followed by the serial type of every value
+	uint64_t header_size;
+	size_t n = get_varint(payload, end, &header_size);
+	if (!n || (header_size < n) || (header_size > size)) return -1;
+
+	const uint8_t *types = payload + n;
+	const uint8_t *types_end = payload + header_size;
+	const uint8_t *body = types_end;
+	int count = 0;
+
+	while (types < types_end) {
+		uint64_t serial;
+		if (!(n = get_varint(types, types_end, &serial))) return -1;
+		types += n;
+
+		static const uint8_t int_sizes[] = {0, 1, 2, 3, 4, 6, 8};
+		size_t length;
+		if (serial <= 6) length = int_sizes[serial];
+		else if (serial == 7) length = 8;
+		else if (serial <= 9) length = 0;
+		else if (serial <= 11) return -1;
+		else length = (size_t)((serial - 12) / 2);
+		if (length > (size_t)(end - body)) return -1;
+
+		if (count < nvalues) {
+			sql3db_value *value = &values[count];
+			memset(value, 0, sizeof(sql3db_value));
+
+			if (serial == 0) {
+				value->type = SQL3DB_NULL;
+			} else if (serial <= 6) {
+				value->type = SQL3DB_INTEGER;
+				value->integer = get_int(body, length);
+			} else if (serial == 7) {
+				uint64_t bits = ((uint64_t)get4(body) << 32) | get4(body + 4);
+				value->type = SQL3DB_FLOAT;
+				memcpy(&value->real, &bits, sizeof(double));
+			} else if (serial <= 9) {
+				value->type = SQL3DB_INTEGER;
+				value->integer = (int64_t)(serial - 8);
+			} else {
+				value->type = (serial & 1) ? SQL3DB_TEXT : SQL3DB_BLOB;
+				value->ptr = (const char *)body;
+				value->length = length;
+			}
+		}
+
+		body += length;
+		++count;
+	}
+
+	return count;
+}
+
+// MARK: - Schema -
+
+static bool sql3schema_string (sql3schema *schema, const sql3db_value *value, char **out, sql3string *str) {
+	// NULL or text, converted to UTF-8 at *out when the database is UTF-16
+	str->ptr = NULL;
+	str->length = 0;
+	if (value->type == SQL3DB_NULL) return true;
+	if (value->type != SQL3DB_TEXT) return false;
+
+	if (schema->encoding == SQL3DB_UTF8) {
+		str->ptr = value->ptr;
+		str->length = value->length;
+		return true;
+	}
+
+	str->ptr = *out;
+	str->length = utf16_to_utf8((const uint8_t *)value->ptr, value->length, schema->encoding == SQL3DB_UTF16BE, *out);
+	*out += str->length;
+	return true;
+}
+
+static bool sql3schema_cell (void *xdata, int64_t rowid, const uint8_t *payload, size_t size) {
+	sql3schema *schema = (sql3schema *)xdata;
+
+	// type, name, tbl_name, rootpage, sql
+	sql3db_value values[5];
+	if (sql3db_record_decode(payload, size, values, 5) < 5) {
+		schema->error = SQL3DB_CORRUPT;
+		return false;
+	}
+
+	// UTF-16 code units take at most 3 bytes in UTF-8
+	if (schema->encoding != SQL3DB_UTF8) {
+		size_t needed = 3 * (values[0].length + values[1].length + values[2].length + values[4].length) / 2 + 1;
+		if (schema->capacity < needed) {
+			char *buffer = (char *)realloc(schema->buffer, needed);
+			if (!buffer) {
+				schema->error = SQL3DB_MEMORY;
+				return false;
+			}
+			schema->buffer = buffer;
+			schema->capacity = needed;
+		}
+	}
+
+	sql3db_schema_entry entry = {.rowid = rowid};
+	char *out = schema->buffer;
+	bool valid = sql3schema_string(schema, &values[0], &out, &entry.type) &&
+				 sql3schema_string(schema, &values[1], &out, &entry.name) &&
+				 sql3schema_string(schema, &values[2], &out, &entry.tbl_name) &&
+				 sql3schema_string(schema, &values[4], &out, &entry.sql);
+
+	if (values[3].type == SQL3DB_INTEGER) {
+		valid = valid && (values[3].integer >= 0) && (values[3].integer <= UINT32_MAX);
+		entry.rootpage = (uint32_t)values[3].integer;
+	} else {
+		valid = valid && (values[3].type == SQL3DB_NULL);
+	}
+
+	if (!valid) {
+		schema->error = SQL3DB_CORRUPT;
+		return false;
+	}
+
+	return schema->callback(schema->xdata, &entry);
+}
+
+// MARK: - Crawl -
+
+static bool sql3crawl_copy (sql3crawl *crawl, sql3string *str) {
+	if (!str->ptr) return true;
+
+	sql3text *block = (sql3text *)crawl->file->text;
+	if (!block || (block->size - block->used < str->length)) {
+		size_t size = (str->length > SQL3DB_TEXT_BLOCK) ? str->length : SQL3DB_TEXT_BLOCK;
+		sql3text *next = (sql3text *)malloc(sizeof(sql3text) + size);
+		if (!next) return false;
+		next->next = block;
+		next->used = 0;
+		next->size = size;
+		crawl->file->text = block = next;
+	}
+
+	char *ptr = block->data + block->used;
+	memcpy(ptr, str->ptr, str->length);
+	block->used += str->length;
+	str->ptr = ptr;
+	return true;
+}
+
+static bool sql3crawl_entry (void *xdata, const sql3db_schema_entry *entry) {
+	sql3crawl *crawl = (sql3crawl *)xdata;
+	sql3db_schema_file *file = crawl->file;
+
+	if (file->count == crawl->capacity) {
+		size_t capacity = (crawl->capacity == 0) ? 32 : crawl->capacity * 2;
+		sql3db_schema_entry *entries = (sql3db_schema_entry *)realloc(file->entries, capacity * sizeof(sql3db_schema_entry));
+		if (!entries) {crawl->error = SQL3DB_MEMORY; return false;}
+		file->entries = entries;
+		crawl->capacity = capacity;
+	}
+
+	sql3db_schema_entry *copy = &file->entries[file->count];
+	*copy = *entry;
+	if (!sql3crawl_copy(crawl, &copy->type) || !sql3crawl_copy(crawl, &copy->name) ||
+		!sql3crawl_copy(crawl, &copy->tbl_name) || !sql3crawl_copy(crawl, &copy->sql)) {
+		crawl->error = SQL3DB_MEMORY;
+		return false;
+	}
+
+	++file->count;
+	return true;
+}
+
+static sql3db_error sql3crawl_file (const char *path, sql3parser *parser, sql3db_schema_file *file) {
+	sql3db_error error;
+	sql3db *db = sql3db_open(path, &error);
+	if (!db) return error;
+
+	sql3crawl crawl = {.file = file, .error = SQL3DB_OK};
+	error = sql3db_read_schema(db, sql3crawl_entry, &crawl);
+	sql3db_close(db);
+	if (error == SQL3DB_OK) error = crawl.error;
+	if (error != SQL3DB_OK) return error;
+
+	file->tables = (sql3table **)calloc(file->count + 1, sizeof(sql3table *));
+	file->errors = (sql3error_code *)calloc(file->count + 1, sizeof(sql3error_code));
+	if (!file->tables || !file->errors) return SQL3DB_MEMORY;
+
+	for (size_t i = 0; i < file->count; ++i) {
+		const sql3db_schema_entry *entry = &file->entries[i];
+		if (!entry->sql.ptr || (entry->type.length != 5) || (memcmp(entry->type.ptr, "table", 5) != 0)) continue;
+
+		// copies are not NUL terminated and the parser takes a length of 0 for a NUL terminated string
+		if (entry->sql.length == 0) continue;
+
+		file->tables[i] = sql3parser_parse(parser, entry->sql.ptr, entry->sql.length, &file->errors[i]);
+		if (file->errors[i] == SQL3ERROR_MEMORY) return SQL3DB_MEMORY;
+	}
+
+	return SQL3DB_OK;
+}
+
+static void sql3crawl_work (void *xdata, size_t worker, size_t begin, size_t end) {
+	sql3crawlbatch *batch = (sql3crawlbatch *)xdata;
+
+	for (size_t i = begin; i < end; ++i) {
+		sql3db_schema_file *file = &batch->files[i];
+		memset(file, 0, sizeof(sql3db_schema_file));
+
+		// a file is either read entirely or reported as an error without entries
+		file->error = sql3crawl_file(batch->paths[i], batch->parsers[worker], file);
+		if (file->error != SQL3DB_OK) {
+			sql3db_error error = file->error;
+			sql3db_schema_file_clear(file);
+			file->error = error;
+		}
+	}
+}
+
+// MARK: - Analyze -
+
+static sql3db_error sql3analyze_page (const sql3db *db, uint32_t pgno, int depth, uint32_t *budget, uint8_t *pages, sql3db_btree_stats *stats) {
+	bool is_table = stats->is_table;
+
+	sql3node node;
+	sql3db_error error = sql3db_node(db, pgno, is_table, depth, budget, pages, &node);
+	if (error != SQL3DB_OK) return error;
+
+	const uint8_t *page = node.page;
+	const uint8_t *header = node.header;
+	const uint8_t *end = page + db->usable_size;
+	bool interior = node.interior;
+
+	if ((uint32_t)depth >= stats->depth) stats->depth = (uint32_t)depth + 1;
+	if (interior) ++stats->interior_pages;
+	else ++stats->leaf_pages;
+
+	// unused bytes are the gap between the cell pointer array and the cell content area, the fragmented
+	// bytes and the freeblocks, whose chain is kept in increasing order of offset
+	uint32_t content = get2(header + 5);
+	if (content == 0) content = 65536;
+	size_t gap = (size_t)(node.pointers - page) + 2 * (size_t)node.ncells;
+	if ((content < gap) || (content > db->usable_size)) return SQL3DB_CORRUPT;
+	stats->unused_bytes += (content - gap) + header[7];
+
+	for (uint32_t offset = get2(header + 1), previous = 0; offset != 0; offset = get2(page + offset)) {
+		if ((offset <= previous) || (offset > db->usable_size - 4)) return SQL3DB_CORRUPT;
+		stats->unused_bytes += get2(page + offset + 2);
+		previous = offset;
+	}
+
+	for (uint32_t i = 0; i < node.ncells; ++i) {
+		uint32_t offset = get2(node.pointers + 2 * i);
+		if (offset >= db->usable_size) return SQL3DB_CORRUPT;
+		const uint8_t *cell = page + offset;
+
+		if (interior) {
+			if (end - cell < 4) return SQL3DB_CORRUPT;
+			if ((error = sql3analyze_page(db, get4(cell), depth + 1, budget, pages, stats)) != SQL3DB_OK) return error;
+
+			// table interior cells only hold a rowid key, index interior cells hold an entry too
+			if (is_table) continue;
+			cell += 4;
+		}
+
+		uint64_t size, rowid;
+		size_t n = get_varint(cell, end, &size);
+		if (!n) return SQL3DB_CORRUPT;
+		cell += n;
+
+		if (is_table) {
+			if (!(n = get_varint(cell, end, &rowid))) return SQL3DB_CORRUPT;
+			cell += n;
+		}
+
+		++stats->entries;
+		stats->payload_bytes += size;
+		if (size > stats->max_payload) stats->max_payload = size;
+
+		uint32_t local = sql3db_local_size(db, is_table, size);
+		if ((size_t)(end - cell) < (size_t)local) return SQL3DB_CORRUPT;
+		if (local == size) continue;
+
+		// overflow pages are counted from the payload size, only the first page number is checked
+		if (((size_t)(end - cell) < (size_t)local + 4) || (size > (uint64_t)db->npages * db->usable_size)) return SQL3DB_CORRUPT;
+		uint32_t first = get4(cell + local);
+		if ((first == 0) || (first > db->npages)) return SQL3DB_CORRUPT;
+
+		uint64_t spilled = size - local;
+		uint64_t npages = (spilled + db->usable_size - 5) / (db->usable_size - 4);
+		++stats->overflow_entries;
+		stats->overflow_pages += npages;
+		stats->unused_bytes += npages * (db->usable_size - 4) - spilled;
+	}
+
+	if (interior) return sql3analyze_page(db, get4(header + 8), depth + 1, budget, pages, stats);
+	return SQL3DB_OK;
+}
+
+static void sql3analyze_work (void *xdata, size_t worker, size_t begin, size_t end) {
+	sql3analyzebatch *batch = (sql3analyzebatch *)xdata;
+	(void)worker;
+
+	for (size_t i = begin; i < end; ++i) {
+		sql3db_analyze_btree(batch->db, &batch->stats[i]);
+	}
+}
+
+// MARK: - Public -
+
+sql3db *sql3db_open (const char *path, sql3db_error *error) {
+	sql3db_error dummy;
+	if (!error) error = &dummy;
+	*error = SQL3DB_OK;
+
+	sql3db *db = (sql3db *)calloc(1, sizeof(sql3db));
+	if (!db) {
+		*error = SQL3DB_MEMORY;
+		return NULL;
+	}
+
+	db->file = sql3file_open(path, &db->size);
+	*error = (db->file != SQL3DB_NOFILE) ? sql3db_read_header(db, path) : SQL3DB_CANTOPEN;
+	if (*error != SQL3DB_OK) {
+		sql3db_close(db);
+		return NULL;
+	}
+
+	return db;
+}
+
+void sql3db_close (sql3db *db) {
+	if (!db) return;
+	sql3file_close(db->file);
+	free(db->wal);
+	free(db->wal_index);
+	free(db);
+}
+
+uint32_t sql3db_page_size (const sql3db *db) {
+	return db->page_size;
+}
+
+uint32_t sql3db_page_count (const sql3db *db) {
+	return db->npages;
+}
+
+sql3db_encoding sql3db_text_encoding (const sql3db *db) {
+	return db->encoding;
+}
+
+uint32_t sql3db_change_counter (const sql3db *db) {
+	return db->change_counter;
+}
+
+uint32_t sql3db_schema_cookie (const sql3db *db) {
+	return db->schema_cookie;
+}
+
+sql3db_error sql3db_read_stamp (const char *path, uint32_t *change_counter, uint32_t *schema_cookie) {
+	uint8_t h[SQL3DB_STAMP_SIZE];
+	size_t nread;
+	*change_counter = *schema_cookie = 0;
+
+	sql3db_error error = sql3db_read_prefix(path, h, sizeof(h), &nread);
+	if (error != SQL3DB_OK) return error;
+
+	if ((nread > 0) && ((nread < sizeof(h)) || (memcmp(h, "SQLite format 3", 16) != 0))) return SQL3DB_NOTADB;
+	if ((nread > 0) && (h[18] != 2) && (h[19] != 2)) {
+		*change_counter = get4(h + 24);
+		*schema_cookie = get4(h + 40);
+		return SQL3DB_OK;
+	}
+
+	// in WAL mode (or for an empty file) the latest header may be in the WAL, whose frames have to be
+	// checked to know which ones are committed
+	uint32_t page_size = 0;
+	if ((nread > 0) && ((page_size = sql3db_header_page_size(h)) == 0)) return SQL3DB_NOTADB;
+
+	bool found;
+	if ((error = sql3wal_read_stamp(path, page_size, h, &found)) != SQL3DB_OK) return error;
+	if (!found && (nread == 0)) return SQL3DB_OK;
+
+	*change_counter = get4(h + 24);
+	*schema_cookie = get4(h + 40);
+	return SQL3DB_OK;
+}
+
+sql3db_error sql3db_walk_table (sql3db *db, uint32_t root, sql3db_cell_callback callback, void *xdata) {
+	return sql3db_walk(db, root, true, callback, xdata);
+}
+
+sql3db_error sql3db_walk_index (sql3db *db, uint32_t root, sql3db_cell_callback callback, void *xdata) {
+	return sql3db_walk(db, root, false, callback, xdata);
+}
+
+sql3db_error sql3db_count_cells (sql3db *db, uint32_t root, bool is_table, uint64_t *count) {
+	*count = 0;
+	if ((db->npages == 0) && (root == 1)) return SQL3DB_OK;
+
+	uint8_t *pages = (uint8_t *)malloc((size_t)SQL3DB_PAGE_BUFFERS * db->page_size);
+	if (!pages) return SQL3DB_MEMORY;
+
+	uint32_t budget = db->npages;
+	sql3db_error error = sql3walk_count(db, root, is_table, 0, &budget, pages, count);
+	free(pages);
+	return error;
+}
+
+sql3db_error sql3db_analyze_btree (sql3db *db, sql3db_btree_stats *stats) {
+	uint32_t root = stats->root;
+	memset(stats, 0, sizeof(sql3db_btree_stats));
+	stats->root = root;
+	stats->is_table = true;
+	if ((db->npages == 0) && (root == 1)) return SQL3DB_OK;
+
+	// every thread analyzing a b-tree of db reads pages into its own buffers
+	uint8_t *pages = (uint8_t *)malloc((size_t)SQL3DB_PAGE_BUFFERS * db->page_size);
+	sql3db_error error = SQL3DB_MEMORY;
+
+	// the kind of b-tree is taken from its root page, sql3db_node checks every other page against it
+	const uint8_t *page = pages ? sql3db_page(db, root, pages) : NULL;
+	if (page) {
+		uint8_t type = page[(root == 1) ? SQL3DB_HEADER_SIZE : 0];
+		stats->is_table = (type == SQL3DB_PAGE_TABLE_INTERIOR) || (type == SQL3DB_PAGE_TABLE_LEAF);
+	}
+
+	uint32_t budget = db->npages;
+	if (pages) error = sql3analyze_page(db, root, 0, &budget, pages, stats);
+	free(pages);
+	if (error != SQL3DB_OK) {
+		bool is_table = stats->is_table;
+		memset(stats, 0, sizeof(sql3db_btree_stats));
+		stats->root = root;
+		stats->is_table = is_table;
+		stats->error = error;
+	}
+	return error;
+}
+
+size_t sql3db_analyze_btrees (sql3db *db, sql3db_btree_stats *stats, size_t count, size_t nthreads) {
+	sql3analyzebatch batch = {db, stats};
+	return sql3pool_run(nthreads, count, SQL3DB_ANALYZE_CHUNK, sql3analyze_work, &batch);
+}
+
+sql3db_error sql3db_read_schema (sql3db *db, sql3db_schema_callback callback, void *xdata) {
+	sql3schema schema = {.callback = callback, .xdata = xdata, .encoding = db->encoding, .error = SQL3DB_OK};
+
+	sql3db_error error = sql3db_walk(db, 1, true, sql3schema_cell, &schema);
+	free(schema.buffer);
+
+	return (error != SQL3DB_OK) ? error : schema.error;
+}
+
+size_t sql3db_utf16_to_utf8 (const char *src, size_t length, bool big_endian, char *dst) {
+	return utf16_to_utf8((const uint8_t *)src, length, big_endian, dst);
+}
+
+const char *sql3db_errmsg (sql3db_error error) {
+	switch (error) {
+		case SQL3DB_OK: return "not an error";
+		case SQL3DB_CANTOPEN: return "unable to open database file";
+		case SQL3DB_NOTADB: return "file is not a database";
+		case SQL3DB_CORRUPT: return "database disk image is malformed";
+		case SQL3DB_MEMORY: return "out of memory";
+	}
+	return "unknown error";
+}
+
+size_t sql3db_crawl_schemas (const char **paths, size_t count, sql3parser **parsers, size_t nparsers, sql3db_schema_file *files) {
+	sql3crawlbatch batch = {paths, parsers, files};
+	return sql3pool_run(nparsers, count, SQL3DB_CRAWL_CHUNK, sql3crawl_work, &batch);
+}
+
+void sql3db_schema_file_clear (sql3db_schema_file *file) {
+	sql3text *block = (sql3text *)file->text;
+	while (block) {
+		sql3text *next = block->next;
+		free(block);
+		block = next;
+	}
+
+	free(file->entries);
+	free(file->tables);
+	free(file->errors);
+	memset(file, 0, sizeof(sql3db_schema_file));
+}
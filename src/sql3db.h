@@ -0,0 +1,168 @@
+//
+//  sql3db.h
+//
+//  Read-only access to SQLite database files without libsqlite: the 100 byte
+//  header is validated and b-trees are walked page by page, every page read
+//  with a positional read into a buffer of the walk. The file is not mapped:
+//  sqlite truncates it in place (vacuum, auto_vacuum) and a mapped page past
+//  the new end would raise SIGBUS, a short read is reported as corruption.
+//
+//  In WAL mode the committed frames of the -wal file are read in memory when
+//  the database is opened and pages are taken from them when they are there,
+//  as a new reader would. No lock is taken and nothing is written, the WAL is
+//  never checkpointed (a checkpoint that truncates it later isn't noticed).
+//
+//  Cells are handed out as complete record payloads (overflow chains are
+//  reassembled in a buffer owned by the walk) so the callers only need the
+//  record decoder. Text values are in the encoding of the database, the
+//  schema reader converts them to UTF-8.
+//
+
+#ifndef __SQL3DB__
+#define __SQL3DB__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sql3parse_table.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sql3db sql3db;
+
+typedef enum {
+	SQL3DB_OK,
+	SQL3DB_CANTOPEN,                // file can't be opened
+	SQL3DB_NOTADB,                  // missing or invalid header
+	SQL3DB_CORRUPT,                 // malformed page, cell or record
+	SQL3DB_MEMORY
+} sql3db_error;
+
+typedef enum {
+	SQL3DB_UTF8    = 1,
+	SQL3DB_UTF16LE = 2,
+	SQL3DB_UTF16BE = 3
+} sql3db_encoding;
+
+typedef enum {
+	SQL3DB_NULL,
+	SQL3DB_INTEGER,
+	SQL3DB_FLOAT,
+	SQL3DB_TEXT,
+	SQL3DB_BLOB
+} sql3db_type;
+
+// A decoded record value. Text and blobs point into the payload, text is in the database encoding.
+typedef struct {
+	sql3db_type     type;
+	int64_t         integer;
+	double          real;
+	const char      *ptr;
+	size_t          length;
+} sql3db_value;
+
+// A row of sqlite_schema with every string converted to UTF-8 (sql.ptr is NULL for automatic indexes).
+// Strings are only valid for the duration of the callback.
+typedef struct {
+	int64_t         rowid;
+	sql3string      type;           // 'table', 'index', 'view' or 'trigger'
+	sql3string      name;
+	sql3string      tbl_name;
+	uint32_t        rootpage;       // 0 for views and triggers
+	sql3string      sql;
+} sql3db_schema_entry;
+
+// Schema of one file read by sql3db_crawl_schemas. Strings are owned by the result and tables by the parsers.
+typedef struct {
+	sql3db_error        error;          // SQL3DB_OK if the schema could be read (there are no entries otherwise)
+	sql3db_schema_entry *entries;       // rows of sqlite_schema
+	sql3table           **tables;       // table parsed from each entry, NULL for other entries and parse errors
+	sql3error_code      *errors;        // parse error of each entry
+	size_t              count;
+	void                *text;          // storage of the strings
+} sql3db_schema_file;
+
+// Storage used by a b-tree, filled by sql3db_analyze_btree from root. Entries are the rows of a table or
+// the keys of an index, the keys held by the interior pages of an index included. The fill factor of the
+// b-tree is 1 - unused_bytes / ((interior_pages + leaf_pages + overflow_pages) * page size).
+typedef struct {
+	uint32_t        root;               // set by the caller
+	sql3db_error    error;              // every count is 0 unless SQL3DB_OK
+	bool            is_table;           // table or index b-tree, from the type of the root page
+	uint32_t        depth;              // levels of b-tree pages, 1 for a lone leaf
+	uint64_t        entries;
+	uint64_t        interior_pages;
+	uint64_t        leaf_pages;
+	uint64_t        overflow_pages;
+	uint64_t        payload_bytes;      // record bytes of the entries, overflow included
+	uint64_t        max_payload;
+	uint64_t        overflow_entries;   // entries whose payload spills to overflow pages
+	uint64_t        unused_bytes;       // free bytes of the b-tree and overflow pages (reserved bytes excluded)
+} sql3db_btree_stats;
+
+// Return false to stop the walk (the walk then still returns SQL3DB_OK).
+// rowid is 0 for the cells of index b-trees. The payload is only valid for the duration of the callback.
+typedef bool (*sql3db_cell_callback) (void *xdata, int64_t rowid, const uint8_t *payload, size_t size);
+typedef bool (*sql3db_schema_callback) (void *xdata, const sql3db_schema_entry *entry);
+
+// Open the database file at path, NULL on error (the reason is stored in error if not NULL)
+sql3db *sql3db_open (const char *path, sql3db_error *error);
+void sql3db_close (sql3db *db);
+
+// Header fields
+uint32_t sql3db_page_size (const sql3db *db);
+uint32_t sql3db_page_count (const sql3db *db);
+sql3db_encoding sql3db_text_encoding (const sql3db *db);
+uint32_t sql3db_change_counter (const sql3db *db);
+uint32_t sql3db_schema_cookie (const sql3db *db);
+
+// Read the change counter and the schema cookie of the database file at path with a single small read
+// of the header, without opening the database (both are 0 for an empty file). In WAL mode they are read from
+// the last committed copy of page 1, which requires checking the checksums of the WAL frames.
+sql3db_error sql3db_read_stamp (const char *path, uint32_t *change_counter, uint32_t *schema_cookie);
+
+// Visit every cell of the table b-tree rooted at root in rowid order
+sql3db_error sql3db_walk_table (sql3db *db, uint32_t root, sql3db_cell_callback callback, void *xdata);
+
+// Visit every cell of the index b-tree rooted at root in key order. Tables declared WITHOUT ROWID are
+// stored in index b-trees whose keys are complete records (primary key columns first).
+sql3db_error sql3db_walk_index (sql3db *db, uint32_t root, sql3db_cell_callback callback, void *xdata);
+
+// Count the cells of a table (rows) or index (keys) b-tree. Only the b-tree pages are read, not the
+// cells or their overflow pages.
+sql3db_error sql3db_count_cells (sql3db *db, uint32_t root, bool is_table, uint64_t *count);
+
+// Gather the storage statistics of the b-tree rooted at stats->root. Every b-tree page is read, overflow
+// pages are counted from the payload sizes without being read.
+sql3db_error sql3db_analyze_btree (sql3db *db, sql3db_btree_stats *stats);
+
+// Run sql3db_analyze_btree for count b-trees of db on up to nthreads threads sharing the open file.
+// Errors are reported per b-tree. Returns the number of threads actually used.
+size_t sql3db_analyze_btrees (sql3db *db, sql3db_btree_stats *stats, size_t count, size_t nthreads);
+
+// Visit every row of sqlite_schema (the table b-tree rooted at page 1)
+sql3db_error sql3db_read_schema (sql3db *db, sql3db_schema_callback callback, void *xdata);
+
+// Read the schema of count files and parse the sql of every table on up to nparsers threads, one parser
+// per thread. Errors are reported per file. Returns the number of threads actually used.
+size_t sql3db_crawl_schemas (const char **paths, size_t count, sql3parser **parsers, size_t nparsers, sql3db_schema_file *files);
+void sql3db_schema_file_clear (sql3db_schema_file *file);
+
+// Decode up to nvalues values of the record in payload. Returns the number of values in the
+// record (which may be more than nvalues) or -1 if the record is malformed.
+int sql3db_record_decode (const uint8_t *payload, size_t size, sql3db_value *values, int nvalues);
+
+// Convert length bytes of UTF-16 text to UTF-8. dst must hold 3 bytes per UTF-16 code unit, unpaired
+// surrogates become U+FFFD. Returns the number of bytes written.
+size_t sql3db_utf16_to_utf8 (const char *src, size_t length, bool big_endian, char *dst);
+
+// Static description of an error code
+const char *sql3db_errmsg (sql3db_error error);
+
+#ifdef __cplusplus
+}  // end of the 'extern "C"' block
+#endif
+
+#endif
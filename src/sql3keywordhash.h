@@ -0,0 +1,127 @@
+//
+//  sql3keywordhash.h
+//
+//  Generated by tools/mkkeywordhash.c, do not edit by hand.
+//
+
+#define SQL3KEYWORD_WIDTH           16
+#define SQL3KEYWORD_MINLEN          2
+#define SQL3KEYWORD_MAXLEN          13
+#define SQL3KEYWORD_HASH(s,n)       ((((unsigned)(s)[0]*3) + ((unsigned)(s)[1]*10) + ((unsigned)(s)[(n)-1]*37) + ((unsigned)(n)*2)) & 127)
+
+// keywords padded with zeros to SQL3KEYWORD_WIDTH bytes
+static const char sql3keyword_text[49][SQL3KEYWORD_WIDTH] = {
+	"if",
+	"on",
+	"no",
+	"as",
+	"to",
+	"not",
+	"key",
+	"asc",
+	"set",
+	"add",
+	"temp",
+	"desc",
+	"null",
+	"fail",
+	"drop",
+	"table",
+	"rowid",
+	"check",
+	"abort",
+	"match",
+	"alter",
+	"create",
+	"exists",
+	"unique",
+	"ignore",
+	"delete",
+	"update",
+	"action",
+	"strict",
+	"rename",
+	"column",
+	"without",
+	"primary",
+	"default",
+	"collate",
+	"replace",
+	"cascade",
+	"foreign",
+	"conflict",
+	"rollback",
+	"restrict",
+	"deferred",
+	"temporary",
+	"initially",
+	"immediate",
+	"constraint",
+	"references",
+	"deferrable",
+	"autoincrement"
+};
+
+static const sql3token_t sql3keyword_token[49] = {
+	TOK_IF,
+	TOK_ON,
+	TOK_NO,
+	TOK_AS,
+	TOK_TO,
+	TOK_NOT,
+	TOK_KEY,
+	TOK_ASC,
+	TOK_SET,
+	TOK_ADD,
+	TOK_TEMP,
+	TOK_DESC,
+	TOK_NULL,
+	TOK_FAIL,
+	TOK_DROP,
+	TOK_TABLE,
+	TOK_ROWID,
+	TOK_CHECK,
+	TOK_ABORT,
+	TOK_MATCH,
+	TOK_ALTER,
+	TOK_CREATE,
+	TOK_EXISTS,
+	TOK_UNIQUE,
+	TOK_IGNORE,
+	TOK_DELETE,
+	TOK_UPDATE,
+	TOK_ACTION,
+	TOK_STRICT,
+	TOK_RENAME,
+	TOK_COLUMN,
+	TOK_WITHOUT,
+	TOK_PRIMARY,
+	TOK_DEFAULT,
+	TOK_COLLATE,
+	TOK_REPLACE,
+	TOK_CASCADE,
+	TOK_FOREIGN,
+	TOK_CONFLICT,
+	TOK_ROLLBACK,
+	TOK_RESTRICT,
+	TOK_DEFERRED,
+	TOK_TEMP,
+	TOK_INITIALLY,
+	TOK_IMMEDIATE,
+	TOK_CONSTRAINT,
+	TOK_REFERENCES,
+	TOK_DEFERRABLE,
+	TOK_AUTOINCREMENT
+};
+
+// hash slot => 1 + index inside sql3keyword_text (0 means no keyword)
+static const unsigned char sql3keyword_slot[128] = {
+	13, 0, 0, 2, 0, 10, 11, 0, 0, 0, 23, 0, 0, 0, 0, 0,
+	0, 0, 0, 49, 0, 9, 44, 0, 0, 0, 37, 0, 41, 0, 0, 0,
+	14, 0, 42, 20, 0, 0, 35, 0, 45, 0, 17, 0, 0, 0, 0, 3,
+	0, 29, 0, 40, 0, 0, 7, 0, 0, 0, 18, 0, 0, 0, 0, 0,
+	0, 5, 22, 26, 4, 19, 0, 0, 0, 16, 0, 48, 0, 0, 0, 33,
+	24, 32, 0, 39, 0, 0, 0, 46, 15, 0, 0, 0, 0, 43, 0, 21,
+	0, 0, 0, 0, 27, 0, 25, 0, 0, 0, 6, 0, 0, 30, 0, 36,
+	34, 31, 0, 28, 0, 12, 8, 0, 0, 1, 0, 47, 38, 0, 0, 0
+};
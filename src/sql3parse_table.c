@@ -5,6 +5,9 @@
 //
 
 #include "sql3parse_table.h"
+#include "sql3scan.h"
+#include "sql3split.h"
+#include "sql3pool.h"
 
 typedef enum {
 	// internals
@@ -32,108 +35,171 @@ typedef enum {
 	
 } sql3token_t;
 
-struct sql3string {
-	const char		*ptr;			// ptr to first byte of the string
-	size_t			length;			// string length
+#include "sql3keywordhash.h"
+
+// Strings are stored as 32-bit spans of the statement buffer and turned into sql3string views
+// by the accessors. start is 1-based so that a zeroed span is a NULL string
+typedef struct {
+	uint32_t		start;			// offset+1 of the first byte (0 if NULL)
+	uint32_t		length;			// string length
+} sql3span;
+
+typedef struct sql3chunk {
+	struct sql3chunk	*next;			// next chunk in the arena
+	size_t				size;			// usable bytes in this chunk
+	size_t				used;			// bytes already handed out
+} sql3chunk;
+
+typedef struct {
+	sql3chunk		*head;			    // first chunk
+	sql3chunk		*current;		    // chunk used for the next allocation
+} sql3arena;
+
+struct sql3parser {
+	sql3arena		arena;			    // chunks are kept across calls and reused after sql3parser_reset
+	unsigned		fields;			    // SQL3FIELD_* flags of the fields to extract
 };
 
 struct sql3foreignkey {
-	sql3string		table;			// foreign key table
-	size_t			num_columns;
-	sql3string		*column_name;
-	sql3fk_action   on_delete;
-	sql3fk_action   on_update;
-	sql3string		match;
-	sql3fk_deftype  deferrable;
+	const char		*sql;			// statement the spans refer to
+	sql3span		*column_name;	// referenced columns
+	uint32_t		num_columns;
+	sql3span		table;			// foreign key table
+	sql3span		match;
+	uint8_t			on_delete;		// sql3fk_action
+	uint8_t			on_update;		// sql3fk_action
+	uint8_t			deferrable;		// sql3fk_deftype
 };
 
-struct sql3column {
-	sql3string		name;			                // column name
-	sql3string		type;			                // column type (can be NULL)
-	sql3string		length;			                // column length (can be NULL)
-	sql3string		constraint_name;                // constraint name (can be NULL)
-    sql3string      comment;                        // column comment (can be NULL)
-	bool			is_primarykey;                  // primary key flag
-	bool			is_autoincrement;               // autoincrement flag (only if is_primarykey is true)
-	bool			is_notnull;		                // not null flag
-	bool			is_unique;		                // is unique flag
-	sql3order_clause	pk_order;                   // primary key order
-	sql3conflict_clause	pk_conflictclause;          // primary key conflit clause
-	sql3conflict_clause notnull_conflictclause;     // not null conflit clause
-	sql3conflict_clause	unique_conflictclause;      // unique conflit clause
-	sql3string		check_expr;                     // check expression (can be NULL)
-	sql3string		default_expr;                   // default expression (can be NULL)
-	sql3string		collate_name;                   // collate name (can be NULL)
+// Column constraints are only allocated for the columns that have any of them
+typedef struct {
+	sql3span		constraint_name;                // constraint name (can be NULL)
+	sql3span		check_expr;                     // check expression (can be NULL)
+	sql3span		default_expr;                   // default expression (can be NULL)
+	sql3span		collate_name;                   // collate name (can be NULL)
 	sql3foreignkey  *foreignkey_clause;             // foreign key clause (can be NULL)
+} sql3columnextra;
+
+#define SQL3COLUMN_PRIMARYKEY           0x01    // primary key flag
+#define SQL3COLUMN_AUTOINCREMENT        0x02    // autoincrement flag (only if primary key)
+#define SQL3COLUMN_NOTNULL              0x04    // not null flag
+#define SQL3COLUMN_UNIQUE               0x08    // is unique flag
+
+struct sql3column {
+	const char		*sql;			                // statement the spans refer to
+	sql3span		name;			                // column name
+	sql3span		type;			                // column type (can be NULL)
+	sql3span		length;			                // column length (can be NULL)
+	sql3span		comment;                        // column comment (can be NULL)
+	sql3columnextra	*extra;			                // column constraints (NULL if there are none)
+	uint8_t			flags;			                // SQL3COLUMN_* flags
+	uint8_t			pk_order;                       // primary key order (sql3order_clause)
+	uint8_t			pk_conflictclause;              // primary key conflit clause (sql3conflict_clause)
+	uint8_t			notnull_conflictclause;         // not null conflit clause
+	uint8_t			unique_conflictclause;          // unique conflit clause
 };
 
 struct sql3tableconstraint {
-	sql3constraint_type	type;			            // table constraint type
-	sql3string          name;                       // constraint name (can be NULL)
+	const char		*sql;			            // statement the spans refer to
+	sql3span		name;                       // constraint name (can be NULL)
+	uint8_t			type;			            // table constraint type (sql3constraint_type)
+	uint8_t			conflict_clause;            // conflict clause of a PRIMARY KEY or UNIQUE constraint
+	uint32_t		num_columns;                // number of indexed columns or of columns in the foreign key
 	union {
         // if type SQL3TABLECONSTRAINT_PRIMARYKEY or SQL3TABLECONSTRAINT_UNIQUE
-        struct {
-            size_t			    num_indexed;        // number of indexed columns
-            sql3idxcolumn		*indexed_columns;	// array fo indexed columns
-            sql3conflict_clause	conflict_clause;    // conflict clause
-        };
+        sql3idxcolumn	*indexed_columns;	    // array fo indexed columns
         
         // if type SQL3TABLECONSTRAINT_CHECK
-        sql3string          check_expr;             // check expression (always NULL in this version)
+        sql3span		check_expr;             // check expression (always NULL in this version)
         
         // if type SQL3TABLECONSTRAINT_FOREIGNKEY
-        struct {
-            size_t			foreignkey_num;		    // number of columns defined in foreign key
-            sql3string		*foreignkey_name;	    // column names in the foreign key
-            sql3foreignkey  *foreignkey_clause;	    // foreign key clause (can be NULL)
-        };
+        sql3span		*foreignkey_name;	    // column names in the foreign key
 	};
+	sql3foreignkey  *foreignkey_clause;	        // foreign key clause (can be NULL)
 };
 
+#define SQL3TABLE_TEMPORARY             0x01    // table is temporary
+#define SQL3TABLE_IFNOTEXISTS           0x02    // table is created with a IF NOT EXISTS clause
+#define SQL3TABLE_WITHOUTROWID          0x04    // table is created with a WITHOUT ROWID clause
+#define SQL3TABLE_STRICT                0x08    // table is created with a STRICT clause
+#define SQL3TABLE_OWNSARENA             0x10    // sql3table_free must release the arena (not set if owned by a sql3parser)
+
 struct sql3table {
-	sql3string		name;			    // table name
-	sql3string		schema;			    // schema name (can be NULL)
-    sql3string      comment;            // table comment (can be NULL)
-	bool			is_temporary;		// flag set if table is temporary
-	bool			is_ifnotexists;		// flag set if table is created with a IF NOT EXISTS clause
-	bool			is_withoutrowid;	// flag set if table is created with a WITHOUT ROWID clause
-    bool            is_strict;          // flag set if table is created with a STRICT clause
-	size_t			num_columns;		// number of columns defined in the table
-	sql3column		**columns;		    // array of columns defined in the table
-	size_t			num_constraint;		// number of table constraint
-	sql3tableconstraint	**constraints;  // array of table constraints
-    sql3statement_type  type;           // statement type
-    sql3string      current_name;       // used in ALTER TABLE statement
-    sql3string      new_name;           // used in ALTER TABLE statement
+	const char		*sql;			    // statement the spans refer to
+	sql3span		name;			    // table name
+	sql3span		schema;			    // schema name (can be NULL)
+	sql3span		comment;            // table comment (can be NULL)
+	sql3span		current_name;       // used in ALTER TABLE statement
+	sql3span		new_name;           // used in ALTER TABLE statement
+	sql3column		*columns;		    // columns defined in the table (stored contiguously)
+	sql3tableconstraint	*constraints;   // table constraints (stored contiguously)
+	uint32_t		num_columns;		// number of columns defined in the table
+	uint32_t		num_constraint;		// number of table constraint
+	uint8_t			type;               // statement type (sql3statement_type)
+	uint8_t			flags;              // SQL3TABLE_* flags
+	sql3arena		*arena;             // arena that contains the whole table (NULL if allocated with malloc)
 };
 
 struct sql3idxcolumn {
-	sql3string		    name;           // column name
-	sql3string		    collate_name;   // collate name (can be NULL)
-	sql3order_clause	order;			// order
+	const char		    *sql;           // statement the spans refer to
+	sql3span		    name;           // column name
+	sql3span		    collate_name;   // collate name (can be NULL)
+	uint8_t				order;			// order (sql3order_clause)
 };
 
+typedef struct {
+	sql3token_t		type;			    // token type
+	size_t			offset;			    // offset of the first byte of the token
+	size_t			length;			    // token length (including quotes of an escaped identifier)
+} sql3token;
+
+typedef struct {
+	const sql3events	*callbacks;		// user callbacks
+	void				*xdata;			// user data passed to the callbacks
+	sql3column			column;			// column waiting for its trailing comment before being reported
+	bool				pending;		// flag set if column has not been reported yet
+	bool				started;		// flag set once table_start has been invoked
+	bool				stopped;		// flag set if a callback stopped the parsing
+} sql3eventstate;
+
 typedef struct {
 	const char		*buffer;		    // original sql
 	size_t			size;			    // size of the input buffer
 	size_t			offset;			    // offset inside the input buffer
-	sql3string		identifier;		    // latest identifier found by the lexer
-    sql3string      *comment;           // ptr to comment struct contained in sql3table or sql3column
+	size_t			start;			    // offset of the first byte of the token being lexed
+	sql3token		token;			    // latest token consumed by the parser
+	sql3token		lookahead;		    // token already lexed by sql3lexer_peek but not yet consumed
+	bool			has_lookahead;	    // flag set if lookahead is valid
+	sql3span		identifier;		    // latest identifier consumed by the parser
+    sql3span        *comment;           // ptr to comment span contained in sql3table or sql3column
 	sql3table		*table;			    // table definition
+	sql3arena		*arena;			    // if not NULL every allocation is served by the arena
+	unsigned		fields;			    // SQL3FIELD_* flags of the fields to extract
+	sql3eventstate	*events;		    // if not NULL nodes are reported to callbacks instead of added to table
 } sql3state;
 
-static sql3string temp_identifier = {.ptr = "temp", .length = 4};
+// temp is a keyword, when used as schema name it is reported as "temp" whatever its case
+#define SQL3SPAN_TEMP                   UINT32_MAX
+#define SQL3SPAN_MAXSIZE                (UINT32_MAX - 1)    // statements must be shorter than this
+static const sql3span temp_identifier = {.start = SQL3SPAN_TEMP, .length = 4};
 
 // MARK: - Macros -
 
 #define IS_EOF				            (state->offset == state->size)
-#define PEEK				            (state->buffer[state->offset])
-#define PEEK2				            (state->buffer[state->offset+1])
-#define NEXT				            (state->buffer[state->offset++])
+#define PEEK				            ((uint8_t)state->buffer[state->offset])
+#define PEEK2				            ((state->offset+1 < state->size) ? (uint8_t)state->buffer[state->offset+1] : 0)
+#define NEXT				            ((uint8_t)state->buffer[state->offset++])
 #define SKIP_ONE			            ++state->offset;
-#define CHECK_STR(s)			        if (!s.ptr) return NULL
+#define BUFFER_PTR			            (&state->buffer[state->offset])
+#define BUFFER_END			            (&state->buffer[state->size])
+#define SEEK(p)				            (state->offset = (size_t)((p) - state->buffer))
 #define CHECK_IDX(idx1,idx2)            if (idx1>=idx2) return NULL
 
+#define SQL3ARENA_CHUNK_SIZE            4096
+#define SQL3ARENA_ALIGN(size)           (((size) + 15) & ~(size_t)15)
+#define SQL3ARRAY_MIN_CAPACITY          4
+#define SQL3EVENTS_SCRATCH_SIZE         2048
+
 // MARK: - Public String Functions -
 
 const char *sql3string_ptr (sql3string *s, size_t *length) {
@@ -154,48 +220,74 @@ const char *sql3string_cstring (sql3string *s) {
 
 // MARK: - Internal Utils -
 
-static int str_nocasencmp(const char *s1, const char *s2, size_t n) {
-	while(n > 0 && tolower((unsigned char)*s1) == tolower((unsigned char)*s2)) {
-		if(*s1 == '\0') return 0;
-		s1++;
-		s2++;
-		n--;
-	}
-	
-	if(n == 0) return 0;
-	return tolower((unsigned char)*s1) - tolower((unsigned char)*s2);
-}
+// Byte classes used by the lexer. The table is indexed by the unsigned value of each
+// input byte so classification never depends on the C locale. As in SQLite, every byte
+// >= 0x80 is an identifier character so UTF-8 encoded identifiers are accepted as is.
+#define SQL3CLASS_SPACE                 0x01    // ' ' '\t' '\v' '\f'
+#define SQL3CLASS_NEWLINE               0x02    // '\n' '\r'
+#define SQL3CLASS_ALPHA                 0x04    // first byte of an identifier
+#define SQL3CLASS_IDENTIFIER            0x08    // any other byte of an identifier
+#define SQL3CLASS_PUNCTUATION           0x10    // '.' ',' '(' ')' ';'
+#define SQL3CLASS_ESCAPE                0x20    // '`' '\'' '"' '['
+#define SQL3CLASS_COMMENT               0x40    // '-' '/' (a comment only if followed by the same '-' or by '*')
+#define SQL3CLASS_TOSKIP                (SQL3CLASS_SPACE | SQL3CLASS_NEWLINE)
+
+#define __                              0
+#define SP                              SQL3CLASS_SPACE
+#define NL                              SQL3CLASS_NEWLINE
+#define ID                              SQL3CLASS_IDENTIFIER
+#define AI                              (SQL3CLASS_ALPHA | SQL3CLASS_IDENTIFIER)
+#define PU                              SQL3CLASS_PUNCTUATION
+#define ES                              SQL3CLASS_ESCAPE
+#define CO                              SQL3CLASS_COMMENT
+
+static const uint8_t sql3charclass[256] = {
+	__, __, __, __, __, __, __, __, __, SP, NL, SP, SP, NL, __, __,    // 0x00
+	__, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,    // 0x10
+	SP, __, ES, __, ID, __, __, ES, PU, PU, __, __, PU, CO, PU, CO,    // 0x20
+	ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, __, PU, __, __, __, __,    // 0x30
+	__, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0x40
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, ES, __, __, __, AI,    // 0x50
+	ES, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0x60
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, __, __, __, __, __,    // 0x70
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0x80
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0x90
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0xA0
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0xB0
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0xC0
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0xD0
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI,    // 0xE0
+	AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI, AI     // 0xF0
+};
 
-static bool symbol_is_space (sql3char c) {
-	return ((c == ' ') || (c == '\t') || (c == '\v') || (c == '\f'));
-}
+#undef __
+#undef SP
+#undef NL
+#undef ID
+#undef AI
+#undef PU
+#undef ES
+#undef CO
+
+#define SYMBOL_CLASS(c)                 (sql3charclass[(uint8_t)(c)])
 
-static bool symbol_is_newline (sql3char c) {
-	return ((c == '\n') || (c == '\r'));
+static inline bool symbol_is_newline (sql3char c) {
+	return (SYMBOL_CLASS(c) & SQL3CLASS_NEWLINE);
 }
 
-static bool symbol_is_toskip (sql3char c) {
+static inline bool symbol_is_toskip (sql3char c) {
 	// skip whitespaces and newlines
-	return (symbol_is_space(c) || symbol_is_newline(c));
+	return (SYMBOL_CLASS(c) & SQL3CLASS_TOSKIP);
 }
 
-static bool symbol_is_comment (sql3char c, sql3state *state) {
+static inline bool symbol_is_comment (sql3char c, sql3state *state) {
+	if (!(SYMBOL_CLASS(c) & SQL3CLASS_COMMENT)) return false;
 	if ((c == '-') && (PEEK2 == '-')) return true;
 	if ((c == '/') && (PEEK2 == '*')) return true;
 	return false;
 }
 
-static bool symbol_is_alpha (sql3char c) {
-	if (c == '_') return true;
-	return isalpha((int)c);
-}
-
-static bool symbol_is_identifier (sql3char c) {
-	// when called I am already sure first character is alpha so next valid characters are alpha, digit and _
-	return ((isalpha(c)) || (isdigit(c)) || (c == '_'));
-}
-
-static bool symbol_is_escape (sql3char c) {
+static inline bool symbol_is_escape (sql3char c) {
 	// From Dr. Hipp
 	// An effort is made to use labels in single-quotes as string literals
 	// first, as that is the SQL standard.  But if if the token does not make
@@ -203,11 +295,7 @@ static bool symbol_is_escape (sql3char c) {
 	// is an ugly hack.  I originally put in the fall-back logic for
 	// compatibility with MySQL and I now see that was a mistake.  But it is
 	// used a lot in legacy code, so I cannot take it out.
-	return ((c == '`') || (c == '\'') || (c == '"') || (c == '['));
-}
-
-static bool symbol_is_punctuation (sql3char c) {
-	return ((c == '.') || (c == ',') || (c == '(') || (c == ')') || (c == ';'));
+	return (SYMBOL_CLASS(c) & SQL3CLASS_ESCAPE);
 }
 
 static bool token_is_column_constraint (sql3token_t t) {
@@ -220,94 +308,146 @@ static bool token_is_table_constraint (sql3token_t t) {
 			(t == TOK_CHECK) || (t == TOK_FOREIGN));
 }
 
+static inline sql3span sql3span_make (sql3state *state, const char *ptr, size_t length) {
+	return (sql3span){(uint32_t)(ptr - state->buffer) + 1, (uint32_t)length};
+}
+
+static inline sql3string sql3span_string (const char *sql, sql3span span) {
+	if (span.start == 0) return (sql3string){NULL, 0};
+	if (span.start == SQL3SPAN_TEMP) return (sql3string){"temp", 4};
+	return (sql3string){sql + span.start - 1, span.length};
+}
+
+static inline void sql3state_setcomment (sql3state *state, sql3span *comment) {
+	// comments are only captured if requested, otherwise the lexer just skips them
+	state->comment = (state->fields & SQL3FIELD_COMMENTS) ? comment : NULL;
+}
+
+// MARK: - Memory -
+
+// Tables can be allocated in two ways:
+// - malloc mode: each node is a separate SQL3MALLOC0 and sql3table_free walks the tree
+// - arena mode: nodes are bump allocated from chunks owned by the arena so sql3table_free
+//   just releases the chunks (chunk sizes double so there are only a handful of them)
+// In both modes arrays grow geometrically: the capacity of an array with count elements is
+// max(SQL3ARRAY_MIN_CAPACITY, next power of two) so it does not need to be stored anywhere.
+
+static sql3chunk *sql3chunk_create (size_t size) {
+	sql3chunk *chunk = (sql3chunk *)SQL3MALLOC(SQL3ARENA_ALIGN(sizeof(sql3chunk)) + size);
+	if (!chunk) return NULL;
+	
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+static void *sql3chunk_bump (sql3chunk *chunk, size_t size) {
+	if (chunk->size - chunk->used < size) return NULL;
+	
+	void *ptr = (char *)chunk + SQL3ARENA_ALIGN(sizeof(sql3chunk)) + chunk->used;
+	chunk->used += size;
+	return ptr;
+}
+
+static bool sql3arena_init (sql3arena *arena) {
+	arena->head = sql3chunk_create(SQL3ARENA_CHUNK_SIZE);
+	arena->current = arena->head;
+	return (arena->head != NULL);
+}
+
+static sql3arena *sql3arena_create (void) {
+	sql3chunk *chunk = sql3chunk_create(SQL3ARENA_CHUNK_SIZE);
+	if (!chunk) return NULL;
+	
+	// the arena descriptor of a standalone table lives inside its own first chunk
+	sql3arena *arena = (sql3arena *)sql3chunk_bump(chunk, SQL3ARENA_ALIGN(sizeof(sql3arena)));
+	arena->head = chunk;
+	arena->current = chunk;
+	return arena;
+}
+
+static void *sql3arena_alloc (sql3arena *arena, size_t size) {
+	size = SQL3ARENA_ALIGN(size);
+	
+	void *ptr = sql3chunk_bump(arena->current, size);
+	while (!ptr) {
+		// reuse chunks kept by a previous sql3arena_reset before allocating new ones
+		sql3chunk *next = arena->current->next;
+		if (!next) {
+			// chunks double in size so the number of chunks grows with the log of the table size
+			size_t chunk_size = arena->current->size * 2;
+			if (chunk_size < size) chunk_size = size;
+			
+			next = sql3chunk_create(chunk_size);
+			if (!next) return NULL;
+			arena->current->next = next;
+		}
+		arena->current = next;
+		ptr = sql3chunk_bump(next, size);
+	}
+	
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+static void sql3arena_reset (sql3arena *arena) {
+	// keep every chunk so that a steady state workload does not touch the allocator anymore
+	for (sql3chunk *chunk = arena->head; chunk; chunk = chunk->next) chunk->used = 0;
+	arena->current = arena->head;
+}
+
+static void sql3arena_free (sql3arena *arena) {
+	// arena can be stored inside the head chunk so read the list before releasing it
+	sql3chunk *chunk = arena->head;
+	while (chunk) {
+		sql3chunk *next = chunk->next;
+		SQL3FREE(chunk);
+		chunk = next;
+	}
+}
+
+static void *sql3alloc (sql3state *state, size_t size) {
+	// zeroed allocation
+	if (state->arena) return sql3arena_alloc(state->arena, size);
+	return SQL3MALLOC0(size);
+}
+
+static void sql3release (sql3state *state, void *ptr) {
+	// arena memory is released all at once with the table
+	if (ptr && !state->arena) SQL3FREE(ptr);
+}
+
+static void *sql3grow (sql3state *state, void *array, size_t count, size_t size) {
+	// make room for element number count+1 in an array that already contains count elements
+	if ((count != 0) && ((count < SQL3ARRAY_MIN_CAPACITY) || (count & (count - 1)))) return array;
+	
+	size_t capacity = (count == 0) ? SQL3ARRAY_MIN_CAPACITY : count * 2;
+	if (!state->arena) return SQL3REALLOC(array, capacity * size);
+	
+	void *ptr = sql3arena_alloc(state->arena, capacity * size);
+	if (ptr && count) memcpy(ptr, array, count * size);
+	return ptr;
+}
+
 // MARK: - Internal Lexer -
 
 static sql3token_t sql3lexer_keyword (const char *ptr, size_t length) {
+	// keywords are recognized through the perfect hash generated by tools/mkkeywordhash.c
+	if ((length < SQL3KEYWORD_MINLEN) || (length > SQL3KEYWORD_MAXLEN)) return TOK_IDENTIFIER;
 	
-	// check if ptr is a reserved keyword
-	switch (length) {
-		case 2:
-		if (str_nocasencmp(ptr, "if", length) == 0) return TOK_IF;
-		if (str_nocasencmp(ptr, "on", length) == 0) return TOK_ON;
-		if (str_nocasencmp(ptr, "no", length) == 0) return TOK_NO;
-        if (str_nocasencmp(ptr, "as", length) == 0) return TOK_AS;
-        if (str_nocasencmp(ptr, "to", length) == 0) return TOK_TO;
-		break;
-			
-		case 3:
-		if (str_nocasencmp(ptr, "not", length) == 0) return TOK_NOT;
-		if (str_nocasencmp(ptr, "key", length) == 0) return TOK_KEY;
-		if (str_nocasencmp(ptr, "asc", length) == 0) return TOK_ASC;
-		if (str_nocasencmp(ptr, "set", length) == 0) return TOK_SET;
-        if (str_nocasencmp(ptr, "add", length) == 0) return TOK_ADD;
-		break;
-			
-		case 4:
-		if (str_nocasencmp(ptr, "temp", length) == 0) return TOK_TEMP;
-		if (str_nocasencmp(ptr, "desc", length) == 0) return TOK_DESC;
-		if (str_nocasencmp(ptr, "null", length) == 0) return TOK_NULL;
-		if (str_nocasencmp(ptr, "fail", length) == 0) return TOK_FAIL;
-        if (str_nocasencmp(ptr, "drop", length) == 0) return TOK_DROP;
-		break;
-			
-		case 5:
-		if (str_nocasencmp(ptr, "table", length) == 0) return TOK_TABLE;
-		if (str_nocasencmp(ptr, "rowid", length) == 0) return TOK_ROWID;
-		if (str_nocasencmp(ptr, "check", length) == 0) return TOK_CHECK;
-		if (str_nocasencmp(ptr, "abort", length) == 0) return TOK_ABORT;
-		if (str_nocasencmp(ptr, "match", length) == 0) return TOK_MATCH;
-        if (str_nocasencmp(ptr, "alter", length) == 0) return TOK_ALTER;
-		break;
-			
-		case 6:
-		if (str_nocasencmp(ptr, "create", length) == 0) return TOK_CREATE;
-		if (str_nocasencmp(ptr, "exists", length) == 0) return TOK_EXISTS;
-		if (str_nocasencmp(ptr, "unique", length) == 0) return TOK_UNIQUE;
-		if (str_nocasencmp(ptr, "ignore", length) == 0) return TOK_IGNORE;
-		if (str_nocasencmp(ptr, "delete", length) == 0) return TOK_DELETE;
-		if (str_nocasencmp(ptr, "update", length) == 0) return TOK_UPDATE;
-		if (str_nocasencmp(ptr, "action", length) == 0) return TOK_ACTION;
-        if (str_nocasencmp(ptr, "strict", length) == 0) return TOK_STRICT;
-        if (str_nocasencmp(ptr, "rename", length) == 0) return TOK_RENAME;
-        if (str_nocasencmp(ptr, "column", length) == 0) return TOK_COLUMN;
-		break;
-		
-		case 7:
-		if (str_nocasencmp(ptr, "without", length) == 0) return TOK_WITHOUT;
-		if (str_nocasencmp(ptr, "primary", length) == 0) return TOK_PRIMARY;
-		if (str_nocasencmp(ptr, "default", length) == 0) return TOK_DEFAULT;
-		if (str_nocasencmp(ptr, "collate", length) == 0) return TOK_COLLATE;
-		if (str_nocasencmp(ptr, "replace", length) == 0) return TOK_REPLACE;
-		if (str_nocasencmp(ptr, "cascade", length) == 0) return TOK_CASCADE;
-		if (str_nocasencmp(ptr, "foreign", length) == 0) return TOK_FOREIGN;
-		break;
-			
-		case 8:
-		if (str_nocasencmp(ptr, "conflict", length) == 0) return TOK_CONFLICT;
-		if (str_nocasencmp(ptr, "rollback", length) == 0) return TOK_ROLLBACK;
-		if (str_nocasencmp(ptr, "restrict", length) == 0) return TOK_RESTRICT;
-		if (str_nocasencmp(ptr, "deferred", length) == 0) return TOK_DEFERRED;
-		break;
-			
-		case 9:
-		if (str_nocasencmp(ptr, "temporary", length) == 0) return TOK_TEMP;
-		if (str_nocasencmp(ptr, "initially", length) == 0) return TOK_INITIALLY;
-		if (str_nocasencmp(ptr, "immediate", length) == 0) return TOK_IMMEDIATE;
-		break;
-			
-		case 10:
-		if (str_nocasencmp(ptr, "constraint", length) == 0) return TOK_CONSTRAINT;
-		if (str_nocasencmp(ptr, "references", length) == 0) return TOK_REFERENCES;
-		if (str_nocasencmp(ptr, "deferrable", length) == 0) return TOK_DEFERRABLE;
-		break;
-			
-		case 13:
-		if (str_nocasencmp(ptr, "autoincrement", length) == 0) return TOK_AUTOINCREMENT;
-		break;
+	// case-fold into a zero padded buffer so that the final check is a single fixed-width compare
+	char folded[SQL3KEYWORD_WIDTH] = {0};
+	for (size_t i=0; i<length; ++i) {
+		unsigned char c = (unsigned char)ptr[i];
+		folded[i] = (char)(((c >= 'A') && (c <= 'Z')) ? (c | 0x20) : c);
 	}
 	
-	// no reserved keyword found
-	return TOK_IDENTIFIER;
+	unsigned char slot = sql3keyword_slot[SQL3KEYWORD_HASH((unsigned char *)folded, length)];
+	if (slot == 0) return TOK_IDENTIFIER;
+	if (memcmp(folded, sql3keyword_text[slot-1], SQL3KEYWORD_WIDTH) != 0) return TOK_IDENTIFIER;
+	
+	return sql3keyword_token[slot-1];
 }
 
 sql3token_t sql3lexer_comment (sql3state *state) {
@@ -315,38 +455,31 @@ sql3token_t sql3lexer_comment (sql3state *state) {
     sql3char c2_start = NEXT;
     bool is_c_comment = ((c1_start == '/') && (c2_start == '*'));
     
-    size_t offset = state->offset;
-    const char *ptr = &state->buffer[offset];
+    const char *ptr = BUFFER_PTR;
+    const char *end = BUFFER_END;
+    const char *p = ptr;
+    size_t length;
     
-    while (1) {
-        sql3char c1 = NEXT;
-        
-        // EOF case
-        if (c1 == 0) {
-            // SQL or C-style comments can be terminated by EOF
-            break;
-        }
-        
-        // check for end-of-comment condition
-        if (is_c_comment) {
-            // c-style comments need two characters to check
-            sql3char c2 = PEEK;
-            if ((c1 == '*') && (c2 == '/')) {
-                NEXT; // consume c2
-                break;
-            }
-        } else {
-            // -- comments are closed by newline
-            if (symbol_is_newline(c1)) break;
+    // SQL or C-style comments can be terminated by EOF
+    if (is_c_comment) {
+        // c-style comments need two characters to check so jump from '/' to '/'
+        // ('*' is too common in comment banners to be a good anchor)
+        while (1) {
+            p = sql3scan_find3(p, end, '/', 0, 0);
+            if ((p == end) || (*p == 0)) {length = p - ptr; SEEK(p); break;}
+            if ((p > ptr) && (p[-1] == '*')) {length = (p - 1) - ptr; SEEK(p+1); break;}
+            ++p;
         }
+    } else {
+        // -- comments are closed by newline (consumed with the comment)
+        p = sql3scan_find3(p, end, '\n', '\r', 0);
+        length = p - ptr;
+        SEEK(((p < end) && (*p != 0)) ? p+1 : p);
     }
     
     // setup current comment
     if (state->comment) {
-        size_t length = state->offset - offset;
-        length -= (is_c_comment) ? 2 : 1; // remove */ or newline
-        state->comment->ptr = ptr;
-        state->comment->length = length;
+        *state->comment = sql3span_make(state, ptr, length);
         //printf("Parsed comment: %.*s\n", (int)length, ptr);
     }
     
@@ -370,42 +503,26 @@ sql3token_t sql3lexer_punctuation (sql3state *state) {
 sql3token_t sql3lexer_alpha (sql3state *state) {
 	size_t offset = state->offset;
 	
-	while (symbol_is_identifier(PEEK)) {
+	while (!IS_EOF && (SYMBOL_CLASS(PEEK) & SQL3CLASS_IDENTIFIER)) {
 		SKIP_ONE;
 	}
 	
 	const char *ptr = &state->buffer[offset];
 	size_t length = state->offset - offset;
 	
-	sql3token_t t = sql3lexer_keyword(ptr, length);
-	if (t != TOK_IDENTIFIER) return t;
-	
-	// setup internal identifier
-	state->identifier.ptr = ptr;
-	state->identifier.length = length;
-	
-	return TOK_IDENTIFIER;
+	return sql3lexer_keyword(ptr, length);
 }
 
 sql3token_t sql3lexer_escape (sql3state *state) {
-	sql3char c, escaped = NEXT; // consume escaped char
+	sql3char escaped = NEXT; // consume escaped char
 	if (escaped == '[') escaped = ']'; // mysql compatibility mode
 	
 	// read until EOF or closing escape character
-	size_t offset = state->offset;
-	do {
-		c = NEXT;
-	} while ((c != 0) && (c != escaped));
-	
-	const char *ptr = &state->buffer[offset];
-	size_t length = state->offset - (offset + 1);
+	const char *p = sql3scan_find3(BUFFER_PTR, BUFFER_END, escaped, escaped, 0);
 	
 	// sanity check on closing escaped character
-	if (c != escaped) return TOK_ERROR;
-	
-	// setup internal identifier
-	state->identifier.ptr = ptr;
-	state->identifier.length = length;
+	if ((p == BUFFER_END) || ((uint8_t)*p != escaped)) {SEEK(p); return TOK_ERROR;}
+	SEEK(p+1);
 	
 	return TOK_IDENTIFIER;
 }
@@ -413,6 +530,8 @@ sql3token_t sql3lexer_escape (sql3state *state) {
 static bool sql3lexer_checkskip (sql3state *state) {
     sql3char c;
 loop:
+    SEEK(sql3scan_skipblank(BUFFER_PTR, BUFFER_END));
+    if (IS_EOF) return true;
     c = PEEK;
     if (symbol_is_toskip(c)) {SKIP_ONE; goto loop;}
     if (symbol_is_comment(c, state)) {if (sql3lexer_comment(state) != TOK_COMMENT) return false; goto loop;}
@@ -420,33 +539,142 @@ loop:
     return true;
 }
 
-static sql3token_t sql3lexer_next (sql3state *state) {
+static sql3token_t sql3lexer_scan (sql3state *state) {
 loop:
+	// whitespaces and comments restart the loop so start always ends up on the first byte of the token
+	state->start = state->offset;
 	if (IS_EOF) return TOK_EOF;
 	sql3char c = PEEK;
-	if (c == 0) return TOK_EOF;
+	uint8_t class = SYMBOL_CLASS(c);
 	
-	if (symbol_is_toskip(c)) {SKIP_ONE; goto loop;}
-	if (symbol_is_comment(c, state)) {if (sql3lexer_comment(state) != TOK_COMMENT) return TOK_ERROR; goto loop;}
-	if (symbol_is_punctuation(c)) return sql3lexer_punctuation(state);
-	if (symbol_is_alpha(c)) return sql3lexer_alpha(state);
-	if (symbol_is_escape(c)) return sql3lexer_escape(state);
+	if (class & SQL3CLASS_TOSKIP) {
+		// skip a whole run of blanks at once ('\v' and '\f' are rare enough to be skipped one by one)
+		const char *p = sql3scan_skipblank(BUFFER_PTR, BUFFER_END);
+		SEEK((p == BUFFER_PTR) ? p+1 : p);
+		goto loop;
+	}
+	if ((class & SQL3CLASS_COMMENT) && symbol_is_comment(c, state)) {if (sql3lexer_comment(state) != TOK_COMMENT) return TOK_ERROR; goto loop;}
+	if (class & SQL3CLASS_PUNCTUATION) return sql3lexer_punctuation(state);
+	if (class & SQL3CLASS_ALPHA) return sql3lexer_alpha(state);
+	if (class & SQL3CLASS_ESCAPE) return sql3lexer_escape(state);
 	
-	return TOK_ERROR;
+	return (c == 0) ? TOK_EOF : TOK_ERROR;
+}
+
+static void sql3lexer_token (sql3state *state, sql3token *token) {
+	// lex exactly one token and record where it lives inside the buffer
+	token->type = sql3lexer_scan(state);
+	token->offset = state->start;
+	token->length = state->offset - state->start;
+}
+
+static sql3token_t sql3lexer_next (sql3state *state) {
+	// consume the lookahead token if sql3lexer_peek already lexed it, otherwise lex a new one
+	if (state->has_lookahead) {
+		state->token = state->lookahead;
+		state->has_lookahead = false;
+	} else {
+		sql3lexer_token(state, &state->token);
+	}
+	
+	// setup internal identifier (escaped identifiers are reported without their quotes)
+	sql3token *token = &state->token;
+	if (token->type == TOK_IDENTIFIER) {
+		const char *ptr = &state->buffer[token->offset];
+		size_t length = token->length;
+		if (symbol_is_escape(*ptr)) {++ptr; length -= 2;}
+		state->identifier = sql3span_make(state, ptr, length);
+	}
+	
+	return token->type;
 }
 
 static sql3token_t sql3lexer_peek (sql3state *state) {
-	// peek calls sql3lexer_next and reset its state after the call
-	size_t saved = state->offset;
-	sql3token_t token = sql3lexer_next(state);
-	state->offset = saved;
-    
-	return token;
+	// each token is lexed only once: the result is kept as lookahead until sql3lexer_next consumes it
+	if (!state->has_lookahead) {
+		sql3lexer_token(state, &state->lookahead);
+		state->has_lookahead = true;
+	}
+	
+	return state->lookahead.type;
+}
+
+static void sql3lexer_rewind (sql3state *state) {
+	// raw scanners (literals and expressions) read bytes directly from the buffer
+	// so move back to the beginning of a pending lookahead token and discard it
+	if (!state->has_lookahead) return;
+	state->offset = state->lookahead.offset;
+	state->has_lookahead = false;
+}
+
+// MARK: - Events -
+
+// In events mode each node is parsed into a transient slot and reported instead of being added to
+// the table. Whatever the node allocates comes from a scratch arena which is rewound once it has
+// been reported. A callback returning false sets stopped and the helpers return an error so that
+// the parser unwinds, sql3parse_table_events then reports SQL3ERROR_NONE.
+
+static sql3error_code sql3events_result (sql3state *state, bool keep) {
+	if (keep) return SQL3ERROR_NONE;
+	state->events->stopped = true;
+	return SQL3ERROR_UNSUPPORTEDSQL;
+}
+
+static sql3error_code sql3events_begin (sql3state *state) {
+	// table_start is delayed until the first node so that the whole table header is known
+	sql3eventstate *events = state->events;
+	if (events->started) return SQL3ERROR_NONE;
+	events->started = true;
+	
+	if (!events->callbacks->table_start) return SQL3ERROR_NONE;
+	return sql3events_result(state, events->callbacks->table_start(events->xdata, state->table));
+}
+
+static sql3error_code sql3events_flush (sql3state *state) {
+	// report the pending column, its trailing comment has been lexed by the time the next node starts
+	sql3eventstate *events = state->events;
+	sql3error_code err = sql3events_begin(state);
+	if ((err != SQL3ERROR_NONE) || !events->pending) return err;
+	events->pending = false;
+	
+	bool keep = (events->callbacks->column) ? events->callbacks->column(events->xdata, &events->column) : true;
+	sql3arena_reset(state->arena);
+	return sql3events_result(state, keep);
+}
+
+static sql3error_code sql3events_column_constraint (sql3state *state, sql3column *column, sql3token_t token) {
+	sql3eventstate *events = state->events;
+	if (!events->callbacks->column_constraint) return SQL3ERROR_NONE;
+	
+	sql3column_constraint_type type;
+	switch (token) {
+		case TOK_PRIMARY: type = SQL3COLUMNCONSTRAINT_PRIMARYKEY; break;
+		case TOK_NOT: type = SQL3COLUMNCONSTRAINT_NOTNULL; break;
+		case TOK_UNIQUE: type = SQL3COLUMNCONSTRAINT_UNIQUE; break;
+		case TOK_CHECK: type = SQL3COLUMNCONSTRAINT_CHECK; break;
+		case TOK_DEFAULT: type = SQL3COLUMNCONSTRAINT_DEFAULT; break;
+		case TOK_COLLATE: type = SQL3COLUMNCONSTRAINT_COLLATE; break;
+		default: type = SQL3COLUMNCONSTRAINT_REFERENCES; break;
+	}
+	return sql3events_result(state, events->callbacks->column_constraint(events->xdata, column, type));
+}
+
+static sql3error_code sql3events_foreignkey (sql3state *state, sql3foreignkey *fk) {
+	sql3eventstate *events = state->events;
+	if (!events->callbacks->foreignkey) return SQL3ERROR_NONE;
+	return sql3events_result(state, events->callbacks->foreignkey(events->xdata, fk));
+}
+
+static sql3error_code sql3events_table_constraint (sql3state *state, sql3tableconstraint *constraint) {
+	sql3eventstate *events = state->events;
+	bool keep = (events->callbacks->table_constraint) ? events->callbacks->table_constraint(events->xdata, constraint) : true;
+	sql3arena_reset(state->arena);
+	return sql3events_result(state, keep);
 }
 
 // MARK: - Internal Parser -
 
-static sql3error_code sql3parse_optionalorder (sql3state *state, sql3order_clause *clause) {
+static sql3error_code sql3parse_optionalorder (sql3state *state, uint8_t *clause) {
 	sql3token_t token = sql3lexer_peek(state);
 	*clause = SQL3ORDER_NONE;
 	
@@ -459,7 +687,7 @@ static sql3error_code sql3parse_optionalorder (sql3state *state, sql3order_claus
 	return SQL3ERROR_NONE;
 }
 
-static sql3error_code sql3parse_optionalconflitclause (sql3state *state, sql3conflict_clause *conflict) {
+static sql3error_code sql3parse_optionalconflitclause (sql3state *state, uint8_t *conflict) {
 	sql3token_t token = sql3lexer_peek(state);
 	*conflict = SQL3CONFLICT_NONE;
 	
@@ -481,10 +709,7 @@ static sql3error_code sql3parse_optionalconflitclause (sql3state *state, sql3con
 	return SQL3ERROR_NONE;
 }
 
-static sql3foreignkey *sql3parse_foreignkey_clause (sql3state *state) {
-	sql3foreignkey *fk = SQL3MALLOC0(sizeof(sql3foreignkey));
-	if (!fk) return NULL;
-	
+static sql3error_code sql3parse_foreignkey_body (sql3state *state, sql3foreignkey *fk, bool keep_columns) {
 	// parse foreign table name
 	sql3token_t token = sql3lexer_next(state);
 	if (token != TOK_IDENTIFIER) goto error;
@@ -500,11 +725,14 @@ static sql3foreignkey *sql3parse_foreignkey_clause (sql3state *state) {
 			token = sql3lexer_next(state);
 			if (token != TOK_IDENTIFIER) goto error;
 			
-			// add column name
+			// add column name (only counted if the clause is not kept)
+			if (keep_columns) {
+				sql3span *names = sql3grow(state, fk->column_name, fk->num_columns, sizeof(sql3span));
+				if (!names) return SQL3ERROR_MEMORY;
+				fk->column_name = names;
+				fk->column_name[fk->num_columns] = state->identifier;
+			}
 			++fk->num_columns;
-			fk->column_name = SQL3REALLOC(fk->column_name, sizeof(sql3string) * fk->num_columns);
-			if (!fk->column_name) goto error;
-			fk->column_name[fk->num_columns-1] = state->identifier;
 			
 			token = sql3lexer_peek(state);
 			if (token == TOK_COMMA) sql3lexer_next(state); // consume TOK_COMMA
@@ -581,11 +809,87 @@ fk_loop:
 		goto error;
 	}
 	
-	return fk;
+	return SQL3ERROR_NONE;
 	
 error:
-	if (fk) SQL3FREE(fk);
-	return NULL;
+	return SQL3ERROR_SYNTAX;
+}
+
+static sql3error_code sql3parse_foreignkey_clause (sql3state *state, sql3foreignkey **clause) {
+	sql3foreignkey *fk = sql3alloc(state, sizeof(sql3foreignkey));
+	if (!fk) return SQL3ERROR_MEMORY;
+	fk->sql = state->buffer;
+	
+	sql3error_code err = sql3parse_foreignkey_body(state, fk, true);
+	if ((err == SQL3ERROR_NONE) && state->events) err = sql3events_foreignkey(state, fk);
+	if (err == SQL3ERROR_NONE) {
+		*clause = fk;
+		return SQL3ERROR_NONE;
+	}
+	
+	sql3release(state, fk->column_name);
+	sql3release(state, fk);
+	return err;
+}
+
+static sql3error_code sql3parse_foreignkey_skip (sql3state *state) {
+	// foreign keys not requested: the clause is consumed without allocating anything
+	sql3foreignkey fk = {0};
+	return sql3parse_foreignkey_body(state, &fk, false);
+}
+
+static void sql3parse_skip_definition (sql3state *state) {
+	// jump over the rest of a column definition or table constraint without lexing it and stop on
+	// the ',' or ')' that closes it (not consumed) or on EOF. Nested parenthesis, literals, escaped
+	// identifiers and comments are honoured so their content never ends the definition. Comments
+	// are captured as sql3lexer_comment would, so skipping doesn't lose a trailing column comment
+	sql3lexer_rewind(state);
+	
+	const char *p = BUFFER_PTR;
+	const char *end = BUFFER_END;
+	const char *slash = NULL;   // next '/' (the set is full so it is tracked separately)
+	uint32_t depth = 0;
+	
+	while (p < end) {
+		const char *q = sql3scan_findset(p, end, "(),'\"`[-");
+		if (!slash || (slash < p)) slash = sql3scan_find3(p, end, '/', '/', '/');
+		p = (slash < q) ? slash : q;
+		if (p == end) break;
+		
+		uint8_t c = (uint8_t)*p++;
+		if (c == '(') {++depth; continue;}
+		if ((c == ')') || (c == ',')) {
+			if (depth == 0) {--p; break;}
+			if (c == ')') --depth;
+			continue;
+		}
+		if (c == '-') {
+			// -- comment closed by newline
+			if ((p < end) && (*p == '-')) {
+				const char *start = ++p;
+				p = sql3scan_find3(p, end, '\n', '\r', '\n');
+				if (state->comment) *state->comment = sql3span_make(state, start, p - start);
+			}
+			continue;
+		}
+		if (c == '/') {
+			// /* comment */ (EOF closes an unterminated comment)
+			if ((p < end) && (*p == '*')) {
+				const char *start = ++p;
+				for (; ((p = sql3scan_find3(p, end, '/', '/', '/')) < end) && ((p == start) || (p[-1] != '*')); ++p);
+				if (state->comment) *state->comment = sql3span_make(state, start, ((p < end) ? p-1 : p) - start);
+				if (p < end) ++p;
+			}
+			continue;
+		}
+		
+		// quoted literal or escaped identifier (a doubled quote simply reopens it)
+		uint8_t closing = (c == '[') ? ']' : c;
+		p = sql3scan_find3(p, end, closing, closing, closing);
+		if (p < end) ++p;
+	}
+	
+	SEEK(p);
 }
 
 static sql3error_code sql3parse_table_options (sql3state *state) {
@@ -602,7 +906,7 @@ static sql3error_code sql3parse_table_options (sql3state *state) {
             if (sql3lexer_next(state) != TOK_ROWID) return SQL3ERROR_SYNTAX;
             
             // set without rowid flag
-            state->table->is_withoutrowid = true;
+            state->table->flags |= SQL3TABLE_WITHOUTROWID;
         } else if (token == TOK_STRICT) {
             // STRICT table option
             
@@ -610,7 +914,7 @@ static sql3error_code sql3parse_table_options (sql3state *state) {
             sql3lexer_next(state);
             
             // set without rowid flag
-            state->table->is_strict = true;
+            state->table->flags |= SQL3TABLE_STRICT;
         } else {
             return SQL3ERROR_NONE;
         }
@@ -628,10 +932,11 @@ static sql3error_code sql3parse_table_options (sql3state *state) {
     return SQL3ERROR_NONE;
 }
 
-static sql3tableconstraint *sql3parse_table_constraint (sql3state *state) {
+static sql3error_code sql3parse_table_constraint (sql3state *state, sql3tableconstraint *constraint) {
+	// constraint is the zeroed slot at the end of the table constraints array
+	sql3error_code err = SQL3ERROR_SYNTAX;
 	sql3token_t token = sql3lexer_peek(state);
-	sql3tableconstraint *constraint = (sql3tableconstraint *)SQL3MALLOC0(sizeof(sql3tableconstraint));
-	if (!constraint) return NULL;
+	constraint->sql = state->buffer;
 	
 	// optional constraint name
 	if (token == TOK_CONSTRAINT) {
@@ -667,7 +972,7 @@ static sql3tableconstraint *sql3parse_table_constraint (sql3state *state) {
 		
 		// get indexed column
 		do {
-			sql3idxcolumn column = {0};
+			sql3idxcolumn column = {.sql = state->buffer};
 			
 			// parse column-name
 			token = sql3lexer_next(state);
@@ -687,10 +992,10 @@ static sql3tableconstraint *sql3parse_table_constraint (sql3state *state) {
 			if (sql3parse_optionalorder(state, &column.order) != SQL3ERROR_NONE) goto error;
 			
 			// add indexed column
-			++constraint->num_indexed;
-			constraint->indexed_columns = SQL3REALLOC(constraint->indexed_columns, sizeof(sql3idxcolumn) * constraint->num_indexed);
-			if (!constraint->indexed_columns) goto error;
-			constraint->indexed_columns[constraint->num_indexed-1] = column;
+			sql3idxcolumn *columns = sql3grow(state, constraint->indexed_columns, constraint->num_columns, sizeof(sql3idxcolumn));
+			if (!columns) {err = SQL3ERROR_MEMORY; goto error;}
+			constraint->indexed_columns = columns;
+			constraint->indexed_columns[constraint->num_columns++] = column;
 			
 			token = sql3lexer_peek(state);
 			if (token == TOK_COMMA) sql3lexer_next(state); // consume TOK_COMMA
@@ -715,10 +1020,10 @@ static sql3tableconstraint *sql3parse_table_constraint (sql3state *state) {
 			if (token != TOK_IDENTIFIER) goto error;
 			
 			// add column name
-			++constraint->foreignkey_num;
-			constraint->foreignkey_name = SQL3REALLOC(constraint->foreignkey_name, sizeof(sql3string) * constraint->foreignkey_num);
-			if (!constraint->foreignkey_name) goto error;
-			constraint->foreignkey_name[constraint->foreignkey_num-1] = state->identifier;
+			sql3span *names = sql3grow(state, constraint->foreignkey_name, constraint->num_columns, sizeof(sql3span));
+			if (!names) {err = SQL3ERROR_MEMORY; goto error;}
+			constraint->foreignkey_name = names;
+			constraint->foreignkey_name[constraint->num_columns++] = state->identifier;
 			
 			token = sql3lexer_peek(state);
 			if (token == TOK_COMMA) sql3lexer_next(state); // consume TOK_COMMA
@@ -728,20 +1033,21 @@ static sql3tableconstraint *sql3parse_table_constraint (sql3state *state) {
 		if (sql3lexer_next(state) != TOK_CLOSED_PARENTHESIS) goto error;
 		if (sql3lexer_next(state) != TOK_REFERENCES) goto error;
 		
-		// parse foreign key clause
-		sql3foreignkey *fk = sql3parse_foreignkey_clause(state);
-		if (!fk) goto error;
-		constraint->foreignkey_clause = fk;
+		// parse foreign key clause (foreignkey_clause stays NULL if foreign keys are not requested)
+		if (state->fields & SQL3FIELD_FOREIGNKEYS) {
+			if ((err = sql3parse_foreignkey_clause(state, &constraint->foreignkey_clause)) != SQL3ERROR_NONE) goto error;
+		} else if (sql3parse_foreignkey_skip(state) != SQL3ERROR_NONE) goto error;
 	}
 		
-	return constraint;
+	return SQL3ERROR_NONE;
 	
 error:
-	if (constraint) SQL3FREE(constraint);
-	return NULL;
+	if (constraint->type == SQL3TABLECONSTRAINT_FOREIGNKEY) sql3release(state, constraint->foreignkey_name);
+	else if (constraint->type != SQL3TABLECONSTRAINT_CHECK) sql3release(state, constraint->indexed_columns);
+	return err;
 }
 
-static sql3string sql3parse_literal (sql3state *state) {
+static sql3span sql3parse_literal (sql3state *state) {
     // signed-number (+/-) => numeric-literal
     // literal-value
     //      numeric-literal
@@ -754,59 +1060,62 @@ static sql3string sql3parse_literal (sql3state *state) {
     //      CURRENT_DATE
     //      CURRENT_TIMESTAMP
     
+    sql3lexer_rewind(state);
     sql3lexer_checkskip(state);
     
     size_t offset = state->offset;
+    if (IS_EOF) return (sql3span){0, 0};
     sql3char c = NEXT;
+    const char *p = BUFFER_PTR;
+    const char *end = BUFFER_END;
     if (c == '\'' || c == '"') {
-        // parse string literal
+        // parse string literal (a doubled quote is an escaped quote, EOF closes an unterminated literal)
         sql3char escaped = c;
         while (true) {
-            c = NEXT;
-            if (c == escaped) {
-                sql3char c2 = PEEK;
-                if (c2 != escaped) break;
-                NEXT;
-            }
+            p = sql3scan_find3(p, end, escaped, escaped, escaped);
+            if (p == end) break;
+            if ((p+1 < end) && ((uint8_t)p[1] == escaped)) {p += 2; continue;}
+            ++p;
+            break;
         }
     } else {
         // parse everything else up until a space
-        while (true) {
-            c = PEEK;
-            if (c == ' ' || c == ',' || c == ')') break;
-            c = NEXT;
-        }
+        p = sql3scan_find3(p, end, ' ', ',', ')');
     }
+    SEEK(p);
     
     const char *ptr = &state->buffer[offset];
     size_t length = state->offset - offset;
     
-    sql3string result = {ptr, length};
-    return result;
+    return sql3span_make(state, ptr, length);
 }
 
-static sql3string sql3parse_expression (sql3state *state) {
+static sql3span sql3parse_expression (sql3state *state) {
     // '(' expression ')'
     
+    sql3lexer_rewind(state);
     sql3lexer_checkskip(state);
     
     size_t offset = state->offset;
-    sql3char c = NEXT;      // '('
+    if (IS_EOF) return (sql3span){0, 0};
+    SKIP_ONE;               // '('
     uint32_t count = 1;     // count number of '('
     
+    // jump from parenthesis to parenthesis (EOF closes an unbalanced expression)
+    const char *p = BUFFER_PTR;
+    const char *end = BUFFER_END;
     while (true) {
-        c = NEXT;
-        if (c == '(') ++count;
-        else if (c == ')') {
-            if (--count == 0) break;
-        }
+        p = sql3scan_find3(p, end, '(', ')', ')');
+        if (p == end) break;
+        if (*p++ == '(') ++count;
+        else if (--count == 0) break;
     }
+    SEEK(p);
     
     const char *ptr = &state->buffer[offset];
     size_t length = state->offset - offset;
     
-    sql3string result = {ptr, length};
-    return result;
+    return sql3span_make(state, ptr, length);
 }
 
 static sql3error_code sql3parse_column_type (sql3state *state, sql3column *column) {
@@ -817,14 +1126,14 @@ static sql3error_code sql3parse_column_type (sql3state *state, sql3column *colum
 		sql3lexer_next(state);
 		
 		// mark the beginning of the first identifier
-		if (offset == 0) offset = state->offset - state->identifier.length;
+		if (offset == 0) offset = state->token.offset;
 	}
+	// type ends with the last consumed identifier (the lookahead token is not part of it)
 	const char *ptr = &state->buffer[offset];
-	size_t length = state->offset - offset;
+	size_t length = (state->token.offset + state->token.length) - offset;
 	
 	// setup internal identifier
-	column->type.ptr = ptr;
-	column->type.length = length;
+	column->type = sql3span_make(state, ptr, length);
 	
 	// check for optional lenght
 	if (sql3lexer_peek(state) == TOK_OPEN_PARENTHESIS) {
@@ -832,64 +1141,76 @@ static sql3error_code sql3parse_column_type (sql3state *state, sql3column *colum
 		
 		// mark start of string
 		offset = state->offset;
-		sql3char c;
-		do {
-			c = NEXT;
-		} while ((c != 0) && (c != ')'));
+		const char *p = sql3scan_find3(BUFFER_PTR, BUFFER_END, ')', ')', 0);
 		
-		// sanity check on closing escaped character
-		if (c != ')') return SQL3ERROR_SYNTAX;
+		// sanity check on closing escaped character (statement can be a slice of a larger script)
+		if ((p == BUFFER_END) || (*p != ')')) return SQL3ERROR_SYNTAX;
+		SEEK(p+1);
 		
 		// don't include ')' in column lenght
 		ptr = &state->buffer[offset];
 		length = state->offset - (offset + 1);
 		
-		column->length.ptr = ptr;
-		column->length.length = length;
+		column->length = sql3span_make(state, ptr, length);
 	}
 	
 	return SQL3ERROR_NONE;
 }
 
+static sql3columnextra *sql3column_extra (sql3state *state, sql3column *column) {
+	// allocated by the first constraint stored in it
+	if (!column->extra) column->extra = sql3alloc(state, sizeof(sql3columnextra));
+	return column->extra;
+}
+
 static sql3error_code sql3parse_column_constraints (sql3state *state, sql3column *column) {
 	while (token_is_column_constraint(sql3lexer_peek(state))) {
 		sql3token_t token = sql3lexer_next(state);
+		sql3columnextra *extra = NULL;
+		
+		// constraints stored outside of the column
+		if ((token == TOK_CONSTRAINT) || (token == TOK_CHECK) || (token == TOK_DEFAULT) || (token == TOK_COLLATE) ||
+			((token == TOK_REFERENCES) && (state->fields & SQL3FIELD_FOREIGNKEYS))) {
+			extra = sql3column_extra(state, column);
+			if (!extra) return SQL3ERROR_MEMORY;
+		}
 		
 		// optional constraint name
 		if (token == TOK_CONSTRAINT) {
 			token = sql3lexer_next(state);
 			if (token != TOK_IDENTIFIER) return SQL3ERROR_SYNTAX;
-			column->constraint_name = state->identifier;
+			extra->constraint_name = state->identifier;
 			token = sql3lexer_next(state);
 		}
 		
+		sql3token_t type = token;
 		switch (token) {
 			case TOK_PRIMARY:
 				token = sql3lexer_next(state);
 				if (token != TOK_KEY) return SQL3ERROR_SYNTAX;
-				column->is_primarykey = true;
+				column->flags |= SQL3COLUMN_PRIMARYKEY;
 				if (sql3parse_optionalorder(state, &column->pk_order) != SQL3ERROR_NONE) return SQL3ERROR_SYNTAX;
 				if (sql3parse_optionalconflitclause(state, &column->pk_conflictclause) != SQL3ERROR_NONE) return SQL3ERROR_SYNTAX;
 				if (sql3lexer_peek(state) == TOK_AUTOINCREMENT) {
 					sql3lexer_next(state);	// consume TOK_AUTOINCREMENT
-					column->is_autoincrement = true;
+					column->flags |= SQL3COLUMN_AUTOINCREMENT;
 				}
 				break;
 				
 			case TOK_NOT:
 				token = sql3lexer_next(state);
 				if (token != TOK_NULL) return SQL3ERROR_SYNTAX;
-				column->is_notnull = true;
+				column->flags |= SQL3COLUMN_NOTNULL;
 				if (sql3parse_optionalconflitclause(state, &column->notnull_conflictclause) != SQL3ERROR_NONE) return SQL3ERROR_SYNTAX;
 				break;
 				
 			case TOK_UNIQUE:
-				column->is_unique = true;
+				column->flags |= SQL3COLUMN_UNIQUE;
 				if (sql3parse_optionalconflitclause(state, &column->unique_conflictclause) != SQL3ERROR_NONE) return SQL3ERROR_SYNTAX;
 				break;
 				
 			case TOK_CHECK:
-                column->check_expr = sql3parse_expression(state);
+                extra->check_expr = sql3parse_expression(state);
 				break;
 				
 			case TOK_DEFAULT:
@@ -907,36 +1228,46 @@ static sql3error_code sql3parse_column_constraints (sql3state *state, sql3column
                 // '(' expression ')'
                 
 				// expressions are not supported in this version
-				if (sql3lexer_peek(state) == TOK_OPEN_PARENTHESIS) column->default_expr = sql3parse_expression(state);
-				else column->default_expr = sql3parse_literal(state);
+				if (sql3lexer_peek(state) == TOK_OPEN_PARENTHESIS) extra->default_expr = sql3parse_expression(state);
+				else extra->default_expr = sql3parse_literal(state);
 				break;
 				
 			case TOK_COLLATE:
 				token = sql3lexer_next(state);
 				if (token != TOK_IDENTIFIER) return SQL3ERROR_SYNTAX;
-				column->collate_name = state->identifier;
+				extra->collate_name = state->identifier;
 				break;
 				
 			case TOK_REFERENCES: {
-				sql3foreignkey *fk = sql3parse_foreignkey_clause(state);
-				if (!fk) return SQL3ERROR_SYNTAX;
-				column->foreignkey_clause = fk;
+				if (!(state->fields & SQL3FIELD_FOREIGNKEYS)) {
+					if (sql3parse_foreignkey_skip(state) != SQL3ERROR_NONE) return SQL3ERROR_SYNTAX;
+					break;
+				}
+				sql3error_code err = sql3parse_foreignkey_clause(state, &extra->foreignkey_clause);
+				if (err != SQL3ERROR_NONE) return err;
 			} break;
 				
 			default:
                 return SQL3ERROR_SYNTAX;
 		}
+		
+		// report the constraint as soon as it has been parsed
+		if (state->events) {
+			sql3error_code err = sql3events_column_constraint(state, column, type);
+			if (err != SQL3ERROR_NONE) return err;
+		}
 	}
 	
 	return SQL3ERROR_NONE;
 }
 
-static sql3column *sql3parse_column (sql3state *state) {
-	sql3column *column = SQL3MALLOC0(sizeof(sql3column));
-	if (!column) return NULL;
+static sql3error_code sql3parse_column (sql3state *state, sql3column *column) {
+	// column is the zeroed slot at the end of the table columns array
+	sql3error_code err = SQL3ERROR_SYNTAX;
+	column->sql = state->buffer;
     
     // set column comment reference inside state context
-    state->comment = &column->comment;
+    sql3state_setcomment(state, &column->comment);
 	
 	// column name is mandatory
 	sql3token_t token = sql3lexer_next(state);
@@ -945,21 +1276,95 @@ static sql3column *sql3parse_column (sql3state *state) {
 	// copy column name
 	column->name = state->identifier;
 	
-	// parse optional column type
+	// only the name requested: jump to the end of the column definition
+	if (!(state->fields & (SQL3FIELD_TYPES | SQL3FIELD_COLUMN_CONSTRAINTS))) {
+		sql3parse_skip_definition(state);
+		return SQL3ERROR_NONE;
+	}
+	
+	// parse optional column type (always consumed to reach the constraints)
 	if (sql3lexer_peek(state) == TOK_IDENTIFIER) {
-		if (sql3parse_column_type(state, column) != SQL3ERROR_NONE) goto error;
+		if ((err = sql3parse_column_type(state, column)) != SQL3ERROR_NONE) goto error;
+		if (!(state->fields & SQL3FIELD_TYPES)) column->type = column->length = (sql3span){0, 0};
+	}
+	
+	// constraints not requested: jump to the end of the column definition
+	if (!(state->fields & SQL3FIELD_COLUMN_CONSTRAINTS)) {
+		sql3parse_skip_definition(state);
+		return SQL3ERROR_NONE;
 	}
 	
 	// check optional column constraints path
 	if (token_is_column_constraint(sql3lexer_peek(state))) {
-		if (sql3parse_column_constraints(state, column) != SQL3ERROR_NONE) goto error;
+		if ((err = sql3parse_column_constraints(state, column)) != SQL3ERROR_NONE) goto error;
 	}
     
-	return column;
+	return SQL3ERROR_NONE;
 	
 error:
-	if (column) SQL3FREE(column);
-	return NULL;
+	if (column->extra) {
+		if (column->extra->foreignkey_clause) sql3release(state, column->extra->foreignkey_clause->column_name);
+		sql3release(state, column->extra->foreignkey_clause);
+		sql3release(state, column->extra);
+	}
+	return err;
+}
+
+static sql3error_code sql3parse_table_addcolumn (sql3state *state) {
+	// events mode: a single slot, reported when the next node starts or at the end of the statement
+	if (state->events) {
+		sql3error_code err = sql3events_flush(state);
+		if (err != SQL3ERROR_NONE) return err;
+		
+		sql3column *column = &state->events->column;
+		memset(column, 0, sizeof(sql3column));
+		err = sql3parse_column(state, column);
+		if (err != SQL3ERROR_NONE) return err;
+		
+		state->events->pending = true;
+		return SQL3ERROR_NONE;
+	}
+	
+	// columns are stored contiguously and parsed in place
+	sql3table *table = state->table;
+	sql3column *columns = sql3grow(state, table->columns, table->num_columns, sizeof(sql3column));
+	if (!columns) return SQL3ERROR_MEMORY;
+	table->columns = columns;
+	
+	sql3column *column = &table->columns[table->num_columns];
+	memset(column, 0, sizeof(sql3column));
+	sql3error_code err = sql3parse_column(state, column);
+	if (err != SQL3ERROR_NONE) return err;
+	
+	++table->num_columns;
+	return SQL3ERROR_NONE;
+}
+
+static sql3error_code sql3parse_table_addconstraint (sql3state *state) {
+	// events mode: parsed on the stack and reported right away
+	if (state->events) {
+		sql3error_code err = sql3events_flush(state);
+		if (err != SQL3ERROR_NONE) return err;
+		
+		sql3tableconstraint constraint = {0};
+		err = sql3parse_table_constraint(state, &constraint);
+		if (err != SQL3ERROR_NONE) return err;
+		return sql3events_table_constraint(state, &constraint);
+	}
+	
+	// constraints are stored contiguously and parsed in place
+	sql3table *table = state->table;
+	sql3tableconstraint *constraints = sql3grow(state, table->constraints, table->num_constraint, sizeof(sql3tableconstraint));
+	if (!constraints) return SQL3ERROR_MEMORY;
+	table->constraints = constraints;
+	
+	sql3tableconstraint *constraint = &table->constraints[table->num_constraint];
+	memset(constraint, 0, sizeof(sql3tableconstraint));
+	sql3error_code err = sql3parse_table_constraint(state, constraint);
+	if (err != SQL3ERROR_NONE) return err;
+	
+	++table->num_constraint;
+	return SQL3ERROR_NONE;
 }
 
 // MARK: -
@@ -974,8 +1379,8 @@ static sql3error_code sql3parse_schema_identifier (sql3state *state) {
     // temp is a keyword but it is perfectly legal as a schema name
     if (token != TOK_IDENTIFIER && token != TOK_TEMP) return SQL3ERROR_SYNTAX;
     
-    const char *identifier = (token == TOK_IDENTIFIER) ? sql3string_ptr(&state->identifier, NULL) : temp_identifier.ptr;
-    if (!identifier) return SQL3ERROR_SYNTAX;
+    sql3span identifier = (token == TOK_IDENTIFIER) ? state->identifier : temp_identifier;
+    if (!identifier.start) return SQL3ERROR_SYNTAX;
     
     // check for optional DOT (if any then identifier is a schema name)
     if (sql3lexer_peek(state) == TOK_DOT) {
@@ -983,12 +1388,10 @@ static sql3error_code sql3parse_schema_identifier (sql3state *state) {
         sql3lexer_next(state);
         
         // set schema name
-        table->schema = (token == TOK_IDENTIFIER) ? state->identifier : temp_identifier;
+        table->schema = identifier;
         
         // parse table name
         if (sql3lexer_next(state) != TOK_IDENTIFIER) return SQL3ERROR_SYNTAX;
-        identifier = sql3string_ptr(&state->identifier, NULL);
-        if (!identifier) return SQL3ERROR_SYNTAX;
     }
     
     // set table name
@@ -1062,15 +1465,16 @@ static sql3error_code sql3parse_alter (sql3state *state) {
             token = sql3lexer_peek(state);
             if (token != TOK_IDENTIFIER) return SQL3ERROR_SYNTAX;
             
-            // parse column definition
-            sql3column *column = sql3parse_column(state);
-            if (!column) return SQL3ERROR_SYNTAX;
+            // columns not requested (neither are the comments attached to them)
+            if (!(state->fields & SQL3FIELD_COLUMNS)) {
+                state->comment = NULL;
+                sql3parse_skip_definition(state);
+                break;
+            }
             
-            // add column to columns array
-            ++table->num_columns;
-            table->columns = SQL3REALLOC(table->columns, sizeof(sql3column**) * table->num_columns);
-            if (!table->columns) return SQL3ERROR_MEMORY;
-            table->columns[table->num_columns-1] = column;
+            // parse column definition
+            err = sql3parse_table_addcolumn(state);
+            if (err != SQL3ERROR_NONE) return err;
             
             break;
             
@@ -1110,7 +1514,7 @@ static sql3error_code sql3parse_create (sql3state *state) {
     // next statement after a CREATE can be TEMP or a TABLE
     sql3token_t token = sql3lexer_next(state);
     if (token == TOK_TEMP) {
-        table->is_temporary = true;
+        table->flags |= SQL3TABLE_TEMPORARY;
         
         // parse next token (must be TABLE token)
         token = sql3lexer_next(state);
@@ -1131,7 +1535,7 @@ static sql3error_code sql3parse_create (sql3state *state) {
         if (sql3lexer_next(state) != TOK_EXISTS) return SQL3ERROR_SYNTAX;
         
         // safely set the flag here
-        table->is_ifnotexists = true;
+        table->flags |= SQL3TABLE_IFNOTEXISTS;
     }
     
     // parse [schema.]name
@@ -1152,15 +1556,15 @@ static sql3error_code sql3parse_create (sql3state *state) {
         // column name is mandatory here
         if (token != TOK_IDENTIFIER) return SQL3ERROR_SYNTAX;
         
-        // parse column definition
-        sql3column *column = sql3parse_column(state);
-        if (!column) return SQL3ERROR_SYNTAX;
-        
-        // add column to columns array
-        ++table->num_columns;
-        table->columns = SQL3REALLOC(table->columns, sizeof(sql3column**) * table->num_columns);
-        if (!table->columns) return SQL3ERROR_MEMORY;
-        table->columns[table->num_columns-1] = column;
+        if (state->fields & SQL3FIELD_COLUMNS) {
+            // parse column definition
+            err = sql3parse_table_addcolumn(state);
+            if (err != SQL3ERROR_NONE) return err;
+        } else {
+            // columns not requested (neither are the comments attached to them)
+            state->comment = NULL;
+            sql3parse_skip_definition(state);
+        }
         
         // check for optional comma
         token = sql3lexer_peek(state);
@@ -1185,16 +1589,16 @@ static sql3error_code sql3parse_create (sql3state *state) {
     
     // parse optional table-constraint
     while (token_is_table_constraint(token)) {
-        state->comment = &table->comment;
-        
-        sql3tableconstraint *constraint = sql3parse_table_constraint(state);
-        if (!constraint) return SQL3ERROR_SYNTAX;
+        sql3state_setcomment(state, &table->comment);
         
-        // add column to columns array
-        ++table->num_constraint;
-        table->constraints = SQL3REALLOC(table->constraints, sizeof(sql3tableconstraint**) * table->num_constraint);
-        if (!table->constraints) return SQL3ERROR_MEMORY;
-        table->constraints[table->num_constraint-1] = constraint;
+        if (state->fields & SQL3FIELD_TABLE_CONSTRAINTS) {
+            // parse table constraint
+            err = sql3parse_table_addconstraint(state);
+            if (err != SQL3ERROR_NONE) return err;
+        } else {
+            // constraints not requested
+            sql3parse_skip_definition(state);
+        }
         
         // check for optional comma
         if (sql3lexer_peek(state) == TOK_COMMA) {
@@ -1214,7 +1618,7 @@ static sql3error_code sql3parse_create (sql3state *state) {
     if (token != TOK_CLOSED_PARENTHESIS) return SQL3ERROR_SYNTAX;
     
     // set table comment reference inside state context
-    state->comment = &table->comment;
+    sql3state_setcomment(state, &table->comment);
     
     // check for optional TABLE options (WITHOUT ROWID and/or STRICT)
     if (sql3parse_table_options(state) != SQL3ERROR_NONE) return SQL3ERROR_SYNTAX;
@@ -1238,45 +1642,40 @@ static sql3error_code sql3parse (sql3state *state) {
 
 #pragma mark - Public Table Functions -
 
-sql3string *sql3table_schema (sql3table *table) {
-	CHECK_STR(table->schema);
-	return &table->schema;
+sql3string sql3table_schema (sql3table *table) {
+	return sql3span_string(table->sql, table->schema);
 }
 
-sql3string *sql3table_name (sql3table *table) {
-	CHECK_STR(table->name);
-	return &table->name;
+sql3string sql3table_name (sql3table *table) {
+	return sql3span_string(table->sql, table->name);
 }
 
-sql3string *sql3table_comment (sql3table *table) {
-    CHECK_STR(table->comment);
-    return &table->comment;
+sql3string sql3table_comment (sql3table *table) {
+    return sql3span_string(table->sql, table->comment);
 }
 
-sql3string *sql3table_current_name (sql3table *table) {
-    CHECK_STR(table->current_name);
-    return &table->current_name;
+sql3string sql3table_current_name (sql3table *table) {
+    return sql3span_string(table->sql, table->current_name);
 }
 
-sql3string *sql3table_new_name (sql3table *table) {
-    CHECK_STR(table->new_name);
-    return &table->new_name;
+sql3string sql3table_new_name (sql3table *table) {
+    return sql3span_string(table->sql, table->new_name);
 }
 
 bool sql3table_is_temporary (sql3table *table) {
-	return table->is_temporary;
+	return (table->flags & SQL3TABLE_TEMPORARY);
 }
 
 bool sql3table_is_ifnotexists (sql3table *table) {
-	return table->is_ifnotexists;
+	return (table->flags & SQL3TABLE_IFNOTEXISTS);
 }
 
 bool sql3table_is_withoutrowid (sql3table *table) {
-	return table->is_withoutrowid;
+	return (table->flags & SQL3TABLE_WITHOUTROWID);
 }
 
 bool sql3table_is_strict (sql3table *table) {
-    return table->is_strict;
+    return (table->flags & SQL3TABLE_STRICT);
 }
 
 size_t sql3table_num_columns (sql3table *table) {
@@ -1285,7 +1684,7 @@ size_t sql3table_num_columns (sql3table *table) {
 
 sql3column *sql3table_get_column (sql3table *table, size_t index) {
 	CHECK_IDX(index, table->num_columns);
-	return table->columns[index];
+	return &table->columns[index];
 }
 
 size_t sql3table_num_constraints (sql3table *table) {
@@ -1294,40 +1693,47 @@ size_t sql3table_num_constraints (sql3table *table) {
 
 sql3tableconstraint *sql3table_get_constraint (sql3table *table, size_t index) {
 	CHECK_IDX(index, table->num_constraint);
-	return table->constraints[index];
+	return &table->constraints[index];
 }
 
 sql3statement_type sql3table_type (sql3table *table) {
-    return table->type;
+    return (sql3statement_type)table->type;
+}
+
+static void sql3foreignkey_free (sql3foreignkey *fk) {
+	if (!fk) return;
+	if (fk->column_name) SQL3FREE(fk->column_name);
+	SQL3FREE(fk);
 }
 
 void sql3table_free (sql3table *table) {
 	if (!table) return;
 	
+	// arena mode: the whole tree is released at once (or later by its sql3parser)
+	if (table->arena) {
+		if (table->flags & SQL3TABLE_OWNSARENA) sql3arena_free(table->arena);
+		return;
+	}
+	
 	// free columns
 	for (size_t i=0; i<table->num_columns; ++i) {
-		sql3column *column = table->columns[i];
-		if (column->foreignkey_clause) {
-			if (column->foreignkey_clause->column_name) SQL3FREE(column->foreignkey_clause->column_name);
-			SQL3FREE(column->foreignkey_clause);
+		sql3columnextra *extra = table->columns[i].extra;
+		if (extra) {
+			sql3foreignkey_free(extra->foreignkey_clause);
+			SQL3FREE(extra);
 		}
-		SQL3FREE(column);
 	}
 	if (table->columns) SQL3FREE(table->columns);
 	
 	// free table constraints
 	for (size_t i=0; i<table->num_constraint; ++i) {
-		sql3tableconstraint *constraint = table->constraints[i];
+		sql3tableconstraint *constraint = &table->constraints[i];
 		if ((constraint->type == SQL3TABLECONSTRAINT_PRIMARYKEY) || (constraint->type == SQL3TABLECONSTRAINT_UNIQUE)) {
 			if (constraint->indexed_columns) SQL3FREE(constraint->indexed_columns);
 		} else if (constraint->type == SQL3TABLECONSTRAINT_FOREIGNKEY) {
 			if (constraint->foreignkey_name) SQL3FREE(constraint->foreignkey_name);
-			if (constraint->foreignkey_clause) {
-				if (constraint->foreignkey_clause->column_name) SQL3FREE(constraint->foreignkey_clause->column_name);
-				SQL3FREE(constraint->foreignkey_clause);
-			}
+			sql3foreignkey_free(constraint->foreignkey_clause);
 		}
-		SQL3FREE(constraint);
 	}
 	if (table->constraints) SQL3FREE(table->constraints);
 	
@@ -1336,47 +1742,43 @@ void sql3table_free (sql3table *table) {
 
 // MARK: - Public Table Constraint Functions -
 
-sql3string *sql3table_constraint_name (sql3tableconstraint *tconstraint) {
-	CHECK_STR(tconstraint->name);
-	return &tconstraint->name;
+sql3string sql3table_constraint_name (sql3tableconstraint *tconstraint) {
+	return sql3span_string(tconstraint->sql, tconstraint->name);
 }
 
 sql3constraint_type sql3table_constraint_type (sql3tableconstraint *tconstraint) {
-	return tconstraint->type;
+	return (sql3constraint_type)tconstraint->type;
 }
 
 size_t sql3table_constraint_num_idxcolumns (sql3tableconstraint *tconstraint) {
 	if ((tconstraint->type != SQL3TABLECONSTRAINT_PRIMARYKEY) && (tconstraint->type != SQL3TABLECONSTRAINT_UNIQUE)) return 0;
-	return tconstraint->num_indexed;
+	return tconstraint->num_columns;
 }
 
 sql3idxcolumn *sql3table_constraint_get_idxcolumn (sql3tableconstraint *tconstraint, size_t index) {
 	if ((tconstraint->type != SQL3TABLECONSTRAINT_PRIMARYKEY) && (tconstraint->type != SQL3TABLECONSTRAINT_UNIQUE)) return NULL;
-	CHECK_IDX(index, tconstraint->num_indexed);
+	CHECK_IDX(index, tconstraint->num_columns);
 	return &tconstraint->indexed_columns[index];
 }
 
 sql3conflict_clause sql3table_constraint_conflict_clause (sql3tableconstraint *tconstraint) {
 	if ((tconstraint->type != SQL3TABLECONSTRAINT_PRIMARYKEY) && (tconstraint->type != SQL3TABLECONSTRAINT_UNIQUE)) return SQL3CONFLICT_NONE;
-	return tconstraint->conflict_clause;
+	return (sql3conflict_clause)tconstraint->conflict_clause;
 }
 
-sql3string *sql3table_constraint_check_expr (sql3tableconstraint *tconstraint) {
-	if (tconstraint->type != SQL3TABLECONSTRAINT_CHECK) return NULL;
-	CHECK_STR(tconstraint->check_expr);
-	return &tconstraint->check_expr;
+sql3string sql3table_constraint_check_expr (sql3tableconstraint *tconstraint) {
+	if (tconstraint->type != SQL3TABLECONSTRAINT_CHECK) return (sql3string){NULL, 0};
+	return sql3span_string(tconstraint->sql, tconstraint->check_expr);
 }
 
 size_t sql3table_constraint_num_fkcolumns (sql3tableconstraint *tconstraint) {
 	if (tconstraint->type != SQL3TABLECONSTRAINT_FOREIGNKEY) return 0;
-	return tconstraint->foreignkey_num;
+	return tconstraint->num_columns;
 }
 
-sql3string *sql3table_constraint_get_fkcolumn (sql3tableconstraint *tconstraint, size_t index) {
-	if (tconstraint->type != SQL3TABLECONSTRAINT_FOREIGNKEY) return NULL;
-	CHECK_IDX(index, tconstraint->foreignkey_num);
-	CHECK_STR(tconstraint->foreignkey_name[index]);
-	return &(tconstraint->foreignkey_name[index]);
+sql3string sql3table_constraint_get_fkcolumn (sql3tableconstraint *tconstraint, size_t index) {
+	if ((tconstraint->type != SQL3TABLECONSTRAINT_FOREIGNKEY) || (index >= tconstraint->num_columns)) return (sql3string){NULL, 0};
+	return sql3span_string(tconstraint->sql, tconstraint->foreignkey_name[index]);
 }
 
 sql3foreignkey *sql3table_constraint_foreignkey_clause (sql3tableconstraint *tconstraint) {
@@ -1386,152 +1788,159 @@ sql3foreignkey *sql3table_constraint_foreignkey_clause (sql3tableconstraint *tco
 
 // MARK: - Public Column Functions -
 
-sql3string *sql3column_name (sql3column *column) {
-	CHECK_STR(column->name);
-	return &column->name;
+// missing column constraints are read from this zeroed record
+static const sql3columnextra empty_extra = {0};
+#define COLUMN_EXTRA(column)            ((column)->extra ? (column)->extra : &empty_extra)
+
+sql3string sql3column_name (sql3column *column) {
+	return sql3span_string(column->sql, column->name);
 }
 
-sql3string *sql3column_type (sql3column *column) {
-	CHECK_STR(column->type);
-	return &column->type;
+sql3string sql3column_type (sql3column *column) {
+	return sql3span_string(column->sql, column->type);
 }
 
-sql3string *sql3column_length (sql3column *column) {
-	CHECK_STR(column->length);
-	return &column->length;
+sql3string sql3column_length (sql3column *column) {
+	return sql3span_string(column->sql, column->length);
 }
 
-sql3string *sql3column_constraint_name (sql3column *column) {
-	CHECK_STR(column->constraint_name);
-	return &column->constraint_name;
+sql3string sql3column_constraint_name (sql3column *column) {
+	return sql3span_string(column->sql, COLUMN_EXTRA(column)->constraint_name);
 }
 
-sql3string *sql3column_comment (sql3column *column) {
-    CHECK_STR(column->comment);
-    return &column->comment;
+sql3string sql3column_comment (sql3column *column) {
+    return sql3span_string(column->sql, column->comment);
 }
 
 bool sql3column_is_primarykey (sql3column *column) {
-	return column->is_primarykey;
+	return (column->flags & SQL3COLUMN_PRIMARYKEY);
 }
 
 bool sql3column_is_autoincrement (sql3column *column) {
-	return column->is_autoincrement;
+	return (column->flags & SQL3COLUMN_AUTOINCREMENT);
 }
 
 bool sql3column_is_notnull (sql3column *column) {
-	return column->is_notnull;
+	return (column->flags & SQL3COLUMN_NOTNULL);
 }
 
 bool sql3column_is_unique (sql3column *column) {
-	return column->is_unique;
+	return (column->flags & SQL3COLUMN_UNIQUE);
 }
 
 sql3order_clause sql3column_pk_order (sql3column *column) {
-	return column->pk_order;
+	return (sql3order_clause)column->pk_order;
 }
 
 sql3conflict_clause sql3column_pk_conflictclause (sql3column *column) {
-	return column->pk_conflictclause;
+	return (sql3conflict_clause)column->pk_conflictclause;
 }
 
 sql3conflict_clause sql3column_notnull_conflictclause (sql3column *column) {
-	return column->notnull_conflictclause;
+	return (sql3conflict_clause)column->notnull_conflictclause;
 }
 
 sql3conflict_clause sql3column_unique_conflictclause (sql3column *column) {
-	return column->unique_conflictclause;
+	return (sql3conflict_clause)column->unique_conflictclause;
 }
 
-sql3string *sql3column_check_expr (sql3column *column) {
-	CHECK_STR(column->check_expr);
-	return &column->check_expr;
+sql3string sql3column_check_expr (sql3column *column) {
+	return sql3span_string(column->sql, COLUMN_EXTRA(column)->check_expr);
 }
 
-sql3string *sql3column_default_expr (sql3column *column) {
-	CHECK_STR(column->default_expr);
-	return &column->default_expr;
+sql3string sql3column_default_expr (sql3column *column) {
+	return sql3span_string(column->sql, COLUMN_EXTRA(column)->default_expr);
 }
 
-sql3string *sql3column_collate_name (sql3column *column) {
-	CHECK_STR(column->collate_name);
-	return &column->collate_name;
+sql3string sql3column_collate_name (sql3column *column) {
+	return sql3span_string(column->sql, COLUMN_EXTRA(column)->collate_name);
 }
 
 sql3foreignkey *sql3column_foreignkey_clause (sql3column *column) {
-	return column->foreignkey_clause;
+	return COLUMN_EXTRA(column)->foreignkey_clause;
 }
 
 // MARK: - Public Foreign Key Functions -
 
-sql3string *sql3foreignkey_table (sql3foreignkey *fk) {
-	CHECK_STR(fk->table);
-	return &fk->table;
+sql3string sql3foreignkey_table (sql3foreignkey *fk) {
+	return sql3span_string(fk->sql, fk->table);
 }
 
 size_t sql3foreignkey_num_columns (sql3foreignkey *fk) {
 	return fk->num_columns;
 }
 
-sql3string *sql3foreignkey_get_column (sql3foreignkey *fk, size_t index) {
-	if (index >= fk->num_columns) return NULL;
-	CHECK_STR(fk->column_name[index]);
-	
-	return &fk->column_name[index];
+sql3string sql3foreignkey_get_column (sql3foreignkey *fk, size_t index) {
+	if (index >= fk->num_columns) return (sql3string){NULL, 0};
+	return sql3span_string(fk->sql, fk->column_name[index]);
 }
 
 sql3fk_action sql3foreignkey_ondelete_action (sql3foreignkey *fk) {
-	return fk->on_delete;
+	return (sql3fk_action)fk->on_delete;
 }
 
 sql3fk_action sql3foreignkey_onupdate_action (sql3foreignkey *fk) {
-	return fk->on_update;
+	return (sql3fk_action)fk->on_update;
 }
 
-sql3string *sql3foreignkey_match (sql3foreignkey *fk) {
-	CHECK_STR(fk->match);
-	return &fk->match;
+sql3string sql3foreignkey_match (sql3foreignkey *fk) {
+	return sql3span_string(fk->sql, fk->match);
 }
 
 sql3fk_deftype sql3foreignkey_deferrable (sql3foreignkey *fk) {
-	return fk->deferrable;
+	return (sql3fk_deftype)fk->deferrable;
 }
 
 // MARK: - Public Index Column Functions -
 
-sql3string *sql3idxcolumn_name (sql3idxcolumn *idxcolumn) {
-	CHECK_STR(idxcolumn->name);
-	return &idxcolumn->name;
+sql3string sql3idxcolumn_name (sql3idxcolumn *idxcolumn) {
+	return sql3span_string(idxcolumn->sql, idxcolumn->name);
 }
 
-sql3string *sql3idxcolumn_collate (sql3idxcolumn *idxcolumn) {
-	CHECK_STR(idxcolumn->collate_name);
-	return &idxcolumn->collate_name;
+sql3string sql3idxcolumn_collate (sql3idxcolumn *idxcolumn) {
+	return sql3span_string(idxcolumn->sql, idxcolumn->collate_name);
 }
 
 sql3order_clause sql3idxcolumn_order (sql3idxcolumn *idxcolumn) {
-	return idxcolumn->order;
+	return (sql3order_clause)idxcolumn->order;
 }
 
 // MARK: - Main Entrypoint -
 
-sql3table *sql3parse_table (const char *sql, size_t length, sql3error_code *error) {
+static unsigned sql3fields_normalize (unsigned fields) {
+	// column details are only reachable through columns and foreign keys through the constraints
+	if (!(fields & SQL3FIELD_COLUMNS)) fields &= ~(SQL3FIELD_TYPES | SQL3FIELD_COLUMN_CONSTRAINTS);
+	if (!(fields & (SQL3FIELD_COLUMN_CONSTRAINTS | SQL3FIELD_TABLE_CONSTRAINTS))) fields &= ~SQL3FIELD_FOREIGNKEYS;
+	return fields & SQL3FIELD_ALL;
+}
+
+static sql3table *sql3parse_table_internal (const char *sql, size_t length, sql3arena *arena, unsigned fields, sql3error_code *error) {
 	// initial sanity check
 	if (sql == NULL) return NULL;
 	if (length == 0) length = strlen(sql);
 	if (error) *error = SQL3ERROR_NONE;
 	if (length == 0) return NULL;
 	
-	// allocate table
-	sql3table *table = SQL3MALLOC0(sizeof(sql3table));
+	// strings are stored as 32-bit spans of the statement
+	if (length > SQL3SPAN_MAXSIZE) {
+		if (error) *error = SQL3ERROR_UNSUPPORTEDSQL;
+		return NULL;
+	}
+	
+	// allocate table (inside the arena if any)
+	sql3table *table = (arena) ? sql3arena_alloc(arena, sizeof(sql3table)) : SQL3MALLOC0(sizeof(sql3table));
 	if (!table) goto error_memory;
+	table->arena = arena;
+	table->sql = sql;
 	
 	// setup state
 	sql3state state = {0};
 	state.buffer = sql;
 	state.size = length;
 	state.table = table;
-    state.comment = &table->comment;
+	state.arena = arena;
+	state.fields = sql3fields_normalize(fields);
+    sql3state_setcomment(&state, &table->comment);
 	
 	// begin parsing
 	sql3error_code err = sql3parse(&state);
@@ -1541,13 +1950,173 @@ sql3table *sql3parse_table (const char *sql, size_t length, sql3error_code *erro
 	if (err == SQL3ERROR_NONE) return table;
 	
 	// an error occurred
-	SQL3FREE(table);
+	sql3table_free(table);
 	return NULL;
 	
 error_memory:
-	if (table) SQL3FREE(table);
 	if (error) *error = SQL3ERROR_MEMORY;
 	return NULL;
 }
 
+sql3table *sql3parse_table (const char *sql, size_t length, sql3error_code *error) {
+	return sql3parse_table_internal(sql, length, NULL, SQL3FIELD_ALL, error);
+}
+
+sql3table *sql3parse_table_arena (const char *sql, size_t length, sql3error_code *error) {
+	sql3arena *arena = sql3arena_create();
+	if (!arena) {
+		if (error) *error = SQL3ERROR_MEMORY;
+		return NULL;
+	}
+	
+	sql3table *table = sql3parse_table_internal(sql, length, arena, SQL3FIELD_ALL, error);
+	if (!table) {
+		sql3arena_free(arena);
+		return NULL;
+	}
+	
+	table->flags |= SQL3TABLE_OWNSARENA;
+	return table;
+}
+
+sql3error_code sql3parse_table_events (const char *sql, size_t length, const sql3events *events, void *xdata) {
+	// initial sanity check
+	if ((sql == NULL) || (events == NULL)) return SQL3ERROR_NONE;
+	if (length == 0) length = strlen(sql);
+	if (length == 0) return SQL3ERROR_NONE;
+	if (length > SQL3SPAN_MAXSIZE) return SQL3ERROR_UNSUPPORTEDSQL;
+	
+	// scratch arena on the stack, only nodes with very long lists spill into heap chunks
+	union {
+		sql3chunk	chunk;
+		char		bytes[SQL3EVENTS_SCRATCH_SIZE];
+	} scratch;
+	scratch.chunk.next = NULL;
+	scratch.chunk.size = sizeof(scratch) - SQL3ARENA_ALIGN(sizeof(sql3chunk));
+	scratch.chunk.used = 0;
+	sql3arena arena = {.head = &scratch.chunk, .current = &scratch.chunk};
+	
+	// the table only holds the statement level details
+	sql3table table = {0};
+	table.sql = sql;
+	
+	sql3eventstate evstate = {0};
+	evstate.callbacks = events;
+	evstate.xdata = xdata;
+	
+	// setup state
+	sql3state state = {0};
+	state.buffer = sql;
+	state.size = length;
+	state.table = &table;
+	state.arena = &arena;
+	state.fields = sql3fields_normalize((events->fields) ? events->fields : SQL3FIELD_ALL);
+	state.events = &evstate;
+	sql3state_setcomment(&state, &table.comment);
+	
+	// begin parsing, then report the last column and the end of the table
+	sql3error_code err = sql3parse(&state);
+	if (err == SQL3ERROR_NONE) err = sql3events_flush(&state);
+	if ((err == SQL3ERROR_NONE) && events->table_end) err = sql3events_result(&state, events->table_end(xdata, &table));
+	if (evstate.stopped) err = SQL3ERROR_NONE;
+	
+	// release the chunks allocated past the scratch buffer
+	sql3chunk *chunk = scratch.chunk.next;
+	while (chunk) {
+		sql3chunk *next = chunk->next;
+		SQL3FREE(chunk);
+		chunk = next;
+	}
+	
+	return err;
+}
+
+// MARK: - Reusable Parser -
 
+sql3parser *sql3parser_create (void) {
+	sql3parser *parser = (sql3parser *)SQL3MALLOC0(sizeof(sql3parser));
+	if (!parser) return NULL;
+	
+	if (!sql3arena_init(&parser->arena)) {
+		SQL3FREE(parser);
+		return NULL;
+	}
+	
+	parser->fields = SQL3FIELD_ALL;
+	return parser;
+}
+
+sql3table *sql3parser_parse (sql3parser *parser, const char *sql, size_t length, sql3error_code *error) {
+	return sql3parse_table_internal(sql, length, &parser->arena, parser->fields, error);
+}
+
+void sql3parser_set_fields (sql3parser *parser, unsigned fields) {
+	parser->fields = fields & SQL3FIELD_ALL;
+}
+
+void sql3parser_reset (sql3parser *parser) {
+	sql3arena_reset(&parser->arena);
+}
+
+void sql3parser_free (sql3parser *parser) {
+	if (!parser) return;
+	
+	sql3arena_free(&parser->arena);
+	SQL3FREE(parser);
+}
+
+// MARK: - Script -
+
+sql3error_code sql3parse_script (sql3parser *parser, const char *sql, size_t length, sql3script_callback callback, void *xdata) {
+	if (sql == NULL) return SQL3ERROR_NONE;
+	if (length == 0) length = strlen(sql);
+	
+	sql3split split;
+	sql3split_init(&split, sql, length);
+	
+	sql3split_statement stmt;
+	while (sql3split_next(&split, &stmt)) {
+		sql3table *table = NULL;
+		sql3error_code err = SQL3ERROR_UNSUPPORTEDSQL;
+		
+		// only statements that start like a table definition are handed to the parser
+		if ((stmt.kind == SQL3SPLIT_CREATE_TABLE) || (stmt.kind == SQL3SPLIT_ALTER_TABLE)) {
+			table = sql3parser_parse(parser, sql + stmt.offset, stmt.length, &err);
+			if (err == SQL3ERROR_MEMORY) return err;
+		}
+		
+		if (!callback(xdata, table, stmt.offset, stmt.length, err)) break;
+	}
+	
+	return SQL3ERROR_NONE;
+}
+
+// MARK: - Batch -
+
+#define SQL3BATCH_CHUNK                 64
+
+typedef struct {
+	sql3parser          **parsers;
+	const char          **sql;
+	const size_t        *length;
+	sql3table           **tables;
+	sql3error_code      *errors;
+} sql3batch;
+
+static void sql3batch_work (void *xdata, size_t worker, size_t begin, size_t end) {
+	sql3batch *batch = (sql3batch *)xdata;
+	sql3parser *parser = batch->parsers[worker];
+	
+	for (size_t i = begin; i < end; ++i) {
+		batch->tables[i] = NULL;
+		batch->errors[i] = SQL3ERROR_NONE;
+		if (batch->sql[i] == NULL) continue;
+		
+		batch->tables[i] = sql3parser_parse(parser, batch->sql[i], (batch->length) ? batch->length[i] : 0, &batch->errors[i]);
+	}
+}
+
+size_t sql3parse_batch (sql3parser **parsers, size_t nparsers, const char **sql, const size_t *length, size_t count, sql3table **tables, sql3error_code *errors) {
+	sql3batch batch = {parsers, sql, length, tables, errors};
+	return sql3pool_run(nparsers, count, SQL3BATCH_CHUNK, sql3batch_work, &batch);
+}
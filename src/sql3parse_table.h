@@ -4,11 +4,12 @@
 //  Created by Marco Bambini on 14/02/16.
 //
 
-// Memory requirements on 64bit system:
-// number of columns WITHOUT a foreign key constraints => N1
-// number of columns WITH a foreign key constraints => N2
-// if table has a foreign key constraint then add 64 + (40 for each idx column)
-// Total memory = 144 + (N1 * 144) + (N2 * 208) + table_constraint_size
+// Memory requirements on 64bit system (strings are stored as 8 bytes offset/length pairs):
+// columns are stored contiguously, 56 bytes each
+// a column with a constraint name, CHECK, DEFAULT, COLLATE or REFERENCES clause adds 40
+// a foreign key clause takes 40 + (8 for each referenced column)
+// a table constraint takes 40 + (32 for each idx column or 8 for each foreign key column)
+// Total memory = 88 + columns + column constraints + table_constraint_size
 
 #ifndef __SQL3PARSE_TABLE__
 #define __SQL3PARSE_TABLE__
@@ -18,6 +19,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Make sure we can call this stuff from C++
 #ifdef __cplusplus
@@ -37,7 +39,15 @@ typedef struct sql3idxcolumn        sql3idxcolumn;
 typedef struct sql3foreignkey       sql3foreignkey;
 typedef struct sql3tableconstraint  sql3tableconstraint;
 typedef struct sql3string           sql3string;
+typedef struct sql3parser           sql3parser;
 typedef uint16_t                    sql3char;
+
+// Strings are returned by value as views of the parsed sql (ptr is NULL if the field is missing).
+// They are not NUL terminated and are valid as long as the sql buffer is.
+struct sql3string {
+	const char		*ptr;			// ptr to first byte of the string
+	size_t			length;			// string length
+};
 	
 typedef enum {
 	SQL3ERROR_NONE,
@@ -99,10 +109,86 @@ typedef enum {
 // Main http://www.sqlite.org/lang_createtable.html
 sql3table *sql3parse_table (const char *sql, size_t length, sql3error_code *error);
 
+// Same as sql3parse_table but the whole table is bump allocated from a chunked arena
+// (fewer allocations, sql3table_free releases the chunks without walking the tree)
+sql3table *sql3parse_table_arena (const char *sql, size_t length, sql3error_code *error);
+
+// Field projection: a parser only extracts the SQL3FIELD_* flags set with sql3parser_set_fields
+// (SQL3FIELD_ALL by default). Column definitions and table constraints which are not requested are
+// jumped over with a quote and parenthesis aware scan, foreign key clauses are consumed without
+// allocations and comments are not captured. Fields not extracted are NULL/0. Types and column
+// constraints need columns, foreign keys need column or table constraints.
+typedef enum {
+	SQL3FIELD_COLUMNS               = 0x01,     // column names
+	SQL3FIELD_TYPES                 = 0x02,     // column type and length
+	SQL3FIELD_COLUMN_CONSTRAINTS    = 0x04,     // column constraints, defaults, checks and collations
+	SQL3FIELD_TABLE_CONSTRAINTS     = 0x08,     // table constraints
+	SQL3FIELD_FOREIGNKEYS           = 0x10,     // foreign key clauses
+	SQL3FIELD_COMMENTS              = 0x20,     // table and column comments
+	SQL3FIELD_ALL                   = 0x3F
+} sql3field;
+
+// Reusable parser: tables are allocated from an arena owned by the parser and stay valid until
+// the next sql3parser_reset or sql3parser_free (sql3table_free does nothing on them).
+// Reset keeps the arena chunks so parsing many statements reaches a steady state with no allocations.
+sql3parser  *sql3parser_create (void);
+sql3table   *sql3parser_parse (sql3parser *parser, const char *sql, size_t length, sql3error_code *error);
+void        sql3parser_set_fields (sql3parser *parser, unsigned fields);
+void        sql3parser_reset (sql3parser *parser);
+void        sql3parser_free (sql3parser *parser);
+
+// Script parsing: sql is split into statements and callback is invoked for each of them in order.
+// CREATE TABLE and ALTER TABLE statements are parsed with parser (table is NULL and error is set if
+// parsing fails), any other statement is reported with a NULL table and SQL3ERROR_UNSUPPORTEDSQL.
+// offset and length locate the statement inside sql, callback returns false to stop the iteration.
+// A length of 0 means that sql is NUL terminated (its strlen is used), so empty buffers which are not
+// must not be passed.
+// Returns SQL3ERROR_MEMORY if the parser runs out of memory, SQL3ERROR_NONE otherwise.
+typedef bool (*sql3script_callback) (void *xdata, sql3table *table, size_t offset, size_t length, sql3error_code error);
+sql3error_code sql3parse_script (sql3parser *parser, const char *sql, size_t length, sql3script_callback callback, void *xdata);
+
+// Event parsing: no tree is built, the statement is reported through the callbacks of events
+// (any of them can be NULL) with nodes that are only valid during the callback. table_start is
+// invoked before the first column or table constraint with what precedes the column definitions
+// (the table never contains columns nor constraints), table_end once the whole statement has been
+// parsed (WITHOUT ROWID, STRICT and the table comment are only known then). A column is reported
+// once complete, comment included, after a column_constraint event for each of its constraints.
+// A foreign key clause is reported right before the column or table constraint that contains it.
+// Nodes are parsed into a scratch buffer on the stack which is reused from one node to the next.
+// A callback returns false to stop the parsing. Returns the parsing error (callbacks may have been
+// invoked for the part of the statement before it) or SQL3ERROR_NONE.
+typedef enum {
+	SQL3COLUMNCONSTRAINT_PRIMARYKEY,
+	SQL3COLUMNCONSTRAINT_NOTNULL,
+	SQL3COLUMNCONSTRAINT_UNIQUE,
+	SQL3COLUMNCONSTRAINT_CHECK,
+	SQL3COLUMNCONSTRAINT_DEFAULT,
+	SQL3COLUMNCONSTRAINT_COLLATE,
+	SQL3COLUMNCONSTRAINT_REFERENCES
+} sql3column_constraint_type;
+
+typedef struct {
+	unsigned	fields;			// SQL3FIELD_* flags of the fields to extract (0 means SQL3FIELD_ALL)
+	bool		(*table_start) (void *xdata, sql3table *table);
+	bool		(*column) (void *xdata, sql3column *column);
+	bool		(*column_constraint) (void *xdata, sql3column *column, sql3column_constraint_type type);
+	bool		(*table_constraint) (void *xdata, sql3tableconstraint *constraint);
+	bool		(*foreignkey) (void *xdata, sql3foreignkey *fk);
+	bool		(*table_end) (void *xdata, sql3table *table);
+} sql3events;
+
+sql3error_code sql3parse_table_events (const char *sql, size_t length, const sql3events *events, void *xdata);
+
+// Batch parsing: parse count statements on up to nparsers threads, one parser per thread.
+// Statement i is sql[i] of length[i] bytes (length can be NULL for NUL terminated statements,
+// a NULL sql[i] is skipped), its table and error code are stored in tables[i] and errors[i].
+// Each table belongs to the parser of the thread that parsed it. Returns the number of threads used.
+size_t sql3parse_batch (sql3parser **parsers, size_t nparsers, const char **sql, const size_t *length, size_t count, sql3table **tables, sql3error_code *errors);
+
 // Table Information
-sql3string  *sql3table_schema (sql3table *table);
-sql3string  *sql3table_name (sql3table *table);
-sql3string  *sql3table_comment (sql3table *table);
+sql3string  sql3table_schema (sql3table *table);
+sql3string  sql3table_name (sql3table *table);
+sql3string  sql3table_comment (sql3table *table);
 bool        sql3table_is_temporary (sql3table *table);
 bool        sql3table_is_ifnotexists (sql3table *table);
 bool        sql3table_is_withoutrowid (sql3table *table);
@@ -113,26 +199,26 @@ size_t      sql3table_num_constraints (sql3table *table);
 sql3tableconstraint *sql3table_get_constraint (sql3table *table, size_t index);
 void        sql3table_free (sql3table *table);
 sql3statement_type sql3table_type (sql3table *table);
-sql3string  *sql3table_current_name (sql3table *table);
-sql3string  *sql3table_new_name (sql3table *table);
+sql3string  sql3table_current_name (sql3table *table);
+sql3string  sql3table_new_name (sql3table *table);
 	
 // Table Constraint
-sql3string *sql3table_constraint_name (sql3tableconstraint *tconstraint);
+sql3string sql3table_constraint_name (sql3tableconstraint *tconstraint);
 sql3constraint_type sql3table_constraint_type (sql3tableconstraint *tconstraint);
 size_t sql3table_constraint_num_idxcolumns (sql3tableconstraint *tconstraint);
 sql3idxcolumn *sql3table_constraint_get_idxcolumn (sql3tableconstraint *tconstraint, size_t index);
 sql3conflict_clause sql3table_constraint_conflict_clause (sql3tableconstraint *tconstraint);
-sql3string *sql3table_constraint_check_expr (sql3tableconstraint *tconstraint);
+sql3string sql3table_constraint_check_expr (sql3tableconstraint *tconstraint);
 size_t sql3table_constraint_num_fkcolumns (sql3tableconstraint *tconstraint);
-sql3string *sql3table_constraint_get_fkcolumn (sql3tableconstraint *tconstraint, size_t index);
+sql3string sql3table_constraint_get_fkcolumn (sql3tableconstraint *tconstraint, size_t index);
 sql3foreignkey *sql3table_constraint_foreignkey_clause (sql3tableconstraint *tconstraint);
 
 // Column Constraint
-sql3string *sql3column_name (sql3column *column);
-sql3string *sql3column_type (sql3column *column);
-sql3string *sql3column_length (sql3column *column);
-sql3string *sql3column_constraint_name (sql3column *column);
-sql3string *sql3column_comment (sql3column *column);
+sql3string sql3column_name (sql3column *column);
+sql3string sql3column_type (sql3column *column);
+sql3string sql3column_length (sql3column *column);
+sql3string sql3column_constraint_name (sql3column *column);
+sql3string sql3column_comment (sql3column *column);
 bool sql3column_is_primarykey (sql3column *column);
 bool sql3column_is_autoincrement (sql3column *column);
 bool sql3column_is_notnull (sql3column *column);
@@ -141,23 +227,23 @@ sql3order_clause sql3column_pk_order (sql3column *column);
 sql3conflict_clause sql3column_pk_conflictclause (sql3column *column);
 sql3conflict_clause sql3column_notnull_conflictclause (sql3column *column);
 sql3conflict_clause sql3column_unique_conflictclause (sql3column *column);
-sql3string *sql3column_check_expr (sql3column *column);
-sql3string *sql3column_default_expr (sql3column *column);
-sql3string *sql3column_collate_name (sql3column *column);
+sql3string sql3column_check_expr (sql3column *column);
+sql3string sql3column_default_expr (sql3column *column);
+sql3string sql3column_collate_name (sql3column *column);
 sql3foreignkey *sql3column_foreignkey_clause (sql3column *column);
 	
 // Foreign Key
-sql3string *sql3foreignkey_table (sql3foreignkey *fk);
+sql3string sql3foreignkey_table (sql3foreignkey *fk);
 size_t sql3foreignkey_num_columns (sql3foreignkey *fk);
-sql3string *sql3foreignkey_get_column (sql3foreignkey *fk, size_t index);
+sql3string sql3foreignkey_get_column (sql3foreignkey *fk, size_t index);
 sql3fk_action sql3foreignkey_ondelete_action (sql3foreignkey *fk);
 sql3fk_action sql3foreignkey_onupdate_action (sql3foreignkey *fk);
-sql3string *sql3foreignkey_match (sql3foreignkey *fk);
+sql3string sql3foreignkey_match (sql3foreignkey *fk);
 sql3fk_deftype sql3foreignkey_deferrable (sql3foreignkey *fk);
 
 // Indexed Column
-sql3string *sql3idxcolumn_name (sql3idxcolumn *idxcolumn);
-sql3string *sql3idxcolumn_collate (sql3idxcolumn *idxcolumn);
+sql3string sql3idxcolumn_name (sql3idxcolumn *idxcolumn);
+sql3string sql3idxcolumn_collate (sql3idxcolumn *idxcolumn);
 sql3order_clause sql3idxcolumn_order (sql3idxcolumn *idxcolumn);
 	
 // String Utils
@@ -0,0 +1,165 @@
+//
+//  sql3pool.c
+//
+//  Work-stealing over per worker index ranges.
+//
+
+#include "sql3pool.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define SQL3POOL_CACHE_LINE     64
+
+typedef struct {
+	pthread_mutex_t     lock;
+	size_t              next;               // next item to process
+	size_t              end;                // end of the range owned by the worker
+} sql3range;
+
+// keep every range on its own cache line so workers do not slow each other down
+typedef union {
+	sql3range           range;
+	char                padding[((sizeof(sql3range) / SQL3POOL_CACHE_LINE) + 1) * SQL3POOL_CACHE_LINE];
+} sql3slot;
+
+typedef struct {
+	sql3slot            *slots;
+	size_t              nworkers;
+	size_t              chunk;
+	sql3pool_work       work;
+	void                *xdata;
+} sql3pool;
+
+typedef struct {
+	sql3pool            *pool;
+	size_t              worker;
+} sql3worker;
+
+// MARK: - Ranges -
+
+static bool sql3pool_take (sql3pool *pool, size_t worker, size_t *begin, size_t *end) {
+	sql3range *range = &pool->slots[worker].range;
+	bool found = false;
+
+	pthread_mutex_lock(&range->lock);
+	if (range->next < range->end) {
+		*begin = range->next;
+		*end = (range->end - range->next > pool->chunk) ? range->next + pool->chunk : range->end;
+		range->next = *end;
+		found = true;
+	}
+	pthread_mutex_unlock(&range->lock);
+
+	return found;
+}
+
+static bool sql3pool_steal (sql3pool *pool, size_t worker) {
+	// visit the other workers starting from the next one so thieves spread over victims
+	for (size_t i = 1; i < pool->nworkers; ++i) {
+		sql3range *victim = &pool->slots[(worker + i) % pool->nworkers].range;
+		size_t begin = 0, end = 0;
+
+		pthread_mutex_lock(&victim->lock);
+		size_t remaining = victim->end - victim->next;
+		if (remaining > 0) {
+			// take the back half, a single remaining item is taken as a whole
+			begin = victim->end - (remaining + 1) / 2;
+			end = victim->end;
+			victim->end = begin;
+		}
+		pthread_mutex_unlock(&victim->lock);
+
+		if (begin == end) continue;
+
+		// the stolen items are owned by this worker from now on (and can be stolen back)
+		sql3range *range = &pool->slots[worker].range;
+		pthread_mutex_lock(&range->lock);
+		range->next = begin;
+		range->end = end;
+		pthread_mutex_unlock(&range->lock);
+		return true;
+	}
+
+	// work in transit between two workers is always processed by the thief
+	return false;
+}
+
+// MARK: - Workers -
+
+static void sql3pool_loop (sql3pool *pool, size_t worker) {
+	size_t begin, end;
+	while (1) {
+		if (sql3pool_take(pool, worker, &begin, &end)) {
+			pool->work(pool->xdata, worker, begin, end);
+			continue;
+		}
+		if (!sql3pool_steal(pool, worker)) break;
+	}
+}
+
+static void *sql3pool_thread (void *arg) {
+	sql3worker *worker = (sql3worker *)arg;
+	sql3pool_loop(worker->pool, worker->worker);
+	return NULL;
+}
+
+// MARK: - Public Functions -
+
+size_t sql3pool_run (size_t nworkers, size_t count, size_t chunk, sql3pool_work work, void *xdata) {
+	if (count == 0) return 0;
+	if (chunk == 0) chunk = 1;
+
+	// more workers than chunks would only spin on empty ranges
+	size_t nchunks = (count + chunk - 1) / chunk;
+	if (nworkers > nchunks) nworkers = nchunks;
+	if (nworkers < 1) nworkers = 1;
+
+	sql3slot *slots = (nworkers > 1) ? (sql3slot *)calloc(nworkers, sizeof(sql3slot)) : NULL;
+	pthread_t *threads = (nworkers > 1) ? (pthread_t *)calloc(nworkers, sizeof(pthread_t)) : NULL;
+	sql3worker *workers = (nworkers > 1) ? (sql3worker *)calloc(nworkers, sizeof(sql3worker)) : NULL;
+
+	if (!slots || !threads || !workers) {
+		// single worker (or no memory for the pool): run everything on the calling thread
+		free(slots); free(threads); free(workers);
+		for (size_t begin = 0; begin < count; begin += chunk) {
+			work(xdata, 0, begin, (count - begin > chunk) ? begin + chunk : count);
+		}
+		return 1;
+	}
+
+	sql3pool pool = {slots, nworkers, chunk, work, xdata};
+
+	// split the items evenly, stealing takes care of any imbalance
+	for (size_t i = 0; i < nworkers; ++i) {
+		pthread_mutex_init(&slots[i].range.lock, NULL);
+		slots[i].range.next = (count * i) / nworkers;
+		slots[i].range.end = (count * (i + 1)) / nworkers;
+	}
+
+	// worker 0 is the calling thread, a worker whose thread cannot be created leaves
+	// its range to be stolen by the others
+	size_t nstarted = 1;
+	for (size_t i = 1; i < nworkers; ++i) {
+		workers[i].pool = &pool;
+		workers[i].worker = i;
+		if (pthread_create(&threads[i], NULL, sql3pool_thread, &workers[i]) == 0) {
+			++nstarted;
+		} else {
+			workers[i].pool = NULL;
+		}
+	}
+
+	sql3pool_loop(&pool, 0);
+
+	for (size_t i = 1; i < nworkers; ++i) {
+		if (workers[i].pool) pthread_join(threads[i], NULL);
+	}
+
+	for (size_t i = 0; i < nworkers; ++i) pthread_mutex_destroy(&slots[i].range.lock);
+	free(slots);
+	free(threads);
+	free(workers);
+
+	return nstarted;
+}
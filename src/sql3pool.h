@@ -0,0 +1,34 @@
+//
+//  sql3pool.h
+//
+//  Minimal pthread worker pool used to run batch jobs over an index range.
+//
+//  The range [0, count) is split evenly between the workers up front, each
+//  worker then consumes its own range one chunk at a time and, once it runs
+//  dry, steals the back half of the range of another worker. The calling
+//  thread is always worker 0 so a pool of one worker never creates threads.
+//
+
+#ifndef __SQL3POOL__
+#define __SQL3POOL__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process items [begin, end) on behalf of worker (0 <= worker < nworkers).
+// Each worker is only ever run by one thread so per worker state needs no locking.
+typedef void (*sql3pool_work) (void *xdata, size_t worker, size_t begin, size_t end);
+
+// Run work over [0, count) in chunks of at most chunk items using up to nworkers threads and
+// return once every item has been processed. Returns the number of workers actually used
+// (fewer than requested if there is not enough work or if threads cannot be created).
+size_t sql3pool_run (size_t nworkers, size_t count, size_t chunk, sql3pool_work work, void *xdata);
+
+#ifdef __cplusplus
+}  // end of the 'extern "C"' block
+#endif
+
+#endif
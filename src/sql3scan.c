@@ -0,0 +1,393 @@
+//
+//  sql3scan.c
+//
+//  SSE2 and AVX2 kernels with a portable scalar fallback. Other targets
+//  use the inline scalar loops of sql3scan.h.
+//
+
+#include "sql3scan.h"
+
+#if SQL3SCAN_X86
+
+#include <immintrin.h>
+
+// mingw-w64 GCC doesn't align the stack to 32 bytes for AVX locals (GCC bug 54412) and their aligned
+// spills fault, so the AVX2 kernels are not built for Windows where dispatch stops at SSE2
+#if !defined(_WIN32)
+#define SQL3SCAN_X86_AVX2       1
+#else
+#define SQL3SCAN_X86_AVX2       0
+#endif
+
+typedef const char *(*sql3scan_find3_fn) (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3);
+typedef const char *(*sql3scan_skipblank_fn) (const char *ptr, const char *end);
+typedef const char *(*sql3scan_findset_fn) (const char *ptr, const char *end, const char *set);
+typedef const char *(*sql3scan_skipliterals_fn) (const char *ptr, const char *end, bool *quoted);
+
+// MARK: - Scalar -
+
+static inline int symbol_is_blank (uint8_t c) {
+	return ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r'));
+}
+
+static const char *find3_scalar (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3) {
+	for (; ptr < end; ++ptr) {
+		uint8_t c = (uint8_t)*ptr;
+		if ((c == c1) || (c == c2) || (c == c3)) return ptr;
+	}
+	return end;
+}
+
+static const char *skipblank_scalar (const char *ptr, const char *end) {
+	while ((ptr < end) && symbol_is_blank((uint8_t)*ptr)) ++ptr;
+	return ptr;
+}
+
+static const char *findset_scalar (const char *ptr, const char *end, const char *set) {
+	uint8_t member[256] = {0};
+	for (const char *s = set; *s; ++s) member[(uint8_t)*s] = 1;
+	
+	for (; ptr < end; ++ptr) {
+		if (member[(uint8_t)*ptr]) return ptr;
+	}
+	return end;
+}
+
+static const char *skipliterals_scalar (const char *ptr, const char *end, bool *quoted) {
+	// no bulk mode without vectors, the caller scans byte sets from here
+	(void)end;
+	*quoted = false;
+	return ptr;
+}
+
+static inline uint64_t prefix_xor (uint64_t bits) {
+	// bit i is the parity of bits 0..i: set for the bytes inside a literal (opening quote included)
+	bits ^= bits << 1;
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= bits << 8;
+	bits ^= bits << 16;
+	bits ^= bits << 32;
+	return bits;
+}
+
+static inline uint64_t skipliterals_block (const char *ptr, uint64_t quote, uint64_t stop, uint64_t dash, uint64_t slash, uint64_t star, uint64_t *inside) {
+	// comment starts, the second byte of a pair ending the block is the first byte of the next one
+	// which always exists: a '-' or '/' ending the input must be left to the caller, who may be
+	// scanning a chunk of a stream whose next chunk completes the pair
+	uint64_t dash_next = (dash >> 1) | ((uint64_t)(ptr[64] == '-') << 63);
+	uint64_t star_next = (star >> 1) | ((uint64_t)(ptr[64] == '*') << 63);
+	stop |= (dash & dash_next) | (slash & star_next);
+	
+	// a doubled quote closes and reopens the literal so escapes need no special case
+	uint64_t literal = prefix_xor(quote) ^ *inside;
+	*inside = (uint64_t)((int64_t)literal >> 63);
+	return stop & ~literal;
+}
+
+// MARK: - SSE2 -
+
+static const char *find3_sse2 (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3) {
+	const __m128i v1 = _mm_set1_epi8((char)c1);
+	const __m128i v2 = _mm_set1_epi8((char)c2);
+	const __m128i v3 = _mm_set1_epi8((char)c3);
+
+	while (end - ptr >= 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)ptr);
+		__m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, v1), _mm_cmpeq_epi8(block, v2)), _mm_cmpeq_epi8(block, v3));
+		unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 16;
+	}
+	return find3_scalar(ptr, end, c1, c2, c3);
+}
+
+static const char *skipblank_sse2 (const char *ptr, const char *end) {
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i nl = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+
+	// most gaps between tokens are a single space so avoid vector setup costs for them
+	if ((ptr < end) && !symbol_is_blank((uint8_t)*ptr)) return ptr;
+
+	while (end - ptr >= 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)ptr);
+		__m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+									 _mm_or_si128(_mm_cmpeq_epi8(block, nl), _mm_cmpeq_epi8(block, cr)));
+		unsigned mask = ~(unsigned)_mm_movemask_epi8(blank) & 0xFFFF;
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 16;
+	}
+	return skipblank_scalar(ptr, end);
+}
+
+static const char *findset_sse2 (const char *ptr, const char *end, const char *set) {
+	// unused slots repeat the first byte so the inner loop always runs SQL3SCAN_SET_MAX compares
+	__m128i v[SQL3SCAN_SET_MAX];
+	for (int i = 0, n = 0; i < SQL3SCAN_SET_MAX; ++i) {
+		if (set[n]) v[i] = _mm_set1_epi8(set[n++]);
+		else v[i] = _mm_set1_epi8(set[0]);
+	}
+	
+	while (end - ptr >= 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)ptr);
+		__m128i hit = _mm_cmpeq_epi8(block, v[0]);
+		for (int i = 1; i < SQL3SCAN_SET_MAX; ++i) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, v[i]));
+		unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 16;
+	}
+	return findset_scalar(ptr, end, set);
+}
+
+static inline uint64_t movemask64_sse2 (__m128i m0, __m128i m1, __m128i m2, __m128i m3) {
+	return (uint64_t)(unsigned)_mm_movemask_epi8(m0) | ((uint64_t)(unsigned)_mm_movemask_epi8(m1) << 16) |
+		   ((uint64_t)(unsigned)_mm_movemask_epi8(m2) << 32) | ((uint64_t)(unsigned)_mm_movemask_epi8(m3) << 48);
+}
+
+static const char *skipliterals_sse2 (const char *ptr, const char *end, bool *quoted) {
+	const __m128i quote = _mm_set1_epi8('\'');
+	const __m128i semicolon = _mm_set1_epi8(';');
+	const __m128i dquote = _mm_set1_epi8('"');
+	const __m128i backtick = _mm_set1_epi8('`');
+	const __m128i bracket = _mm_set1_epi8('[');
+	const __m128i dash = _mm_set1_epi8('-');
+	const __m128i slash = _mm_set1_epi8('/');
+	const __m128i star = _mm_set1_epi8('*');
+	
+	uint64_t inside = 0;
+	while (end - ptr > 64) {
+		__m128i b[4], q[4], s[4], d[4], l[4], a[4];
+		for (int i = 0; i < 4; ++i) {
+			b[i] = _mm_loadu_si128((const __m128i *)(ptr + 16 * i));
+			q[i] = _mm_cmpeq_epi8(b[i], quote);
+			s[i] = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(b[i], semicolon), _mm_cmpeq_epi8(b[i], dquote)),
+								_mm_or_si128(_mm_cmpeq_epi8(b[i], backtick), _mm_cmpeq_epi8(b[i], bracket)));
+			d[i] = _mm_cmpeq_epi8(b[i], dash);
+			l[i] = _mm_cmpeq_epi8(b[i], slash);
+			a[i] = _mm_cmpeq_epi8(b[i], star);
+		}
+		
+		uint64_t stop = skipliterals_block(ptr, movemask64_sse2(q[0], q[1], q[2], q[3]), movemask64_sse2(s[0], s[1], s[2], s[3]),
+										   movemask64_sse2(d[0], d[1], d[2], d[3]), movemask64_sse2(l[0], l[1], l[2], l[3]),
+										   movemask64_sse2(a[0], a[1], a[2], a[3]), &inside);
+		if (stop) {
+			*quoted = false;
+			return ptr + __builtin_ctzll(stop);
+		}
+		ptr += 64;
+	}
+	
+	*quoted = (inside != 0);
+	return ptr;
+}
+
+// MARK: - AVX2 -
+
+#if SQL3SCAN_X86_AVX2
+
+__attribute__((target("avx2")))
+static const char *find3_avx2 (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3) {
+	const __m256i v1 = _mm256_set1_epi8((char)c1);
+	const __m256i v2 = _mm256_set1_epi8((char)c2);
+	const __m256i v3 = _mm256_set1_epi8((char)c3);
+
+	while (end - ptr >= 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i *)ptr);
+		__m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, v1), _mm256_cmpeq_epi8(block, v2)), _mm256_cmpeq_epi8(block, v3));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 32;
+	}
+	return find3_sse2(ptr, end, c1, c2, c3);
+}
+
+__attribute__((target("avx2")))
+static const char *skipblank_avx2 (const char *ptr, const char *end) {
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i nl = _mm256_set1_epi8('\n');
+	const __m256i cr = _mm256_set1_epi8('\r');
+
+	if ((ptr < end) && !symbol_is_blank((uint8_t)*ptr)) return ptr;
+
+	while (end - ptr >= 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i *)ptr);
+		__m256i blank = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+										_mm256_or_si256(_mm256_cmpeq_epi8(block, nl), _mm256_cmpeq_epi8(block, cr)));
+		unsigned mask = ~(unsigned)_mm256_movemask_epi8(blank);
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 32;
+	}
+	return skipblank_sse2(ptr, end);
+}
+
+__attribute__((target("avx2")))
+static const char *findset_avx2 (const char *ptr, const char *end, const char *set) {
+	__m256i v[SQL3SCAN_SET_MAX];
+	for (int i = 0, n = 0; i < SQL3SCAN_SET_MAX; ++i) {
+		if (set[n]) v[i] = _mm256_set1_epi8(set[n++]);
+		else v[i] = _mm256_set1_epi8(set[0]);
+	}
+	
+	while (end - ptr >= 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i *)ptr);
+		__m256i hit = _mm256_cmpeq_epi8(block, v[0]);
+		for (int i = 1; i < SQL3SCAN_SET_MAX; ++i) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(block, v[i]));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+		if (mask) return ptr + __builtin_ctz(mask);
+		ptr += 32;
+	}
+	return findset_sse2(ptr, end, set);
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t movemask64_avx2 (__m256i m0, __m256i m1) {
+	return (uint64_t)(unsigned)_mm256_movemask_epi8(m0) | ((uint64_t)(unsigned)_mm256_movemask_epi8(m1) << 32);
+}
+
+__attribute__((target("avx2")))
+static const char *skipliterals_avx2 (const char *ptr, const char *end, bool *quoted) {
+	const __m256i quote = _mm256_set1_epi8('\'');
+	const __m256i semicolon = _mm256_set1_epi8(';');
+	const __m256i dquote = _mm256_set1_epi8('"');
+	const __m256i backtick = _mm256_set1_epi8('`');
+	const __m256i bracket = _mm256_set1_epi8('[');
+	const __m256i dash = _mm256_set1_epi8('-');
+	const __m256i slash = _mm256_set1_epi8('/');
+	const __m256i star = _mm256_set1_epi8('*');
+	
+	uint64_t inside = 0;
+	while (end - ptr > 64) {
+		__m256i b0 = _mm256_loadu_si256((const __m256i *)ptr);
+		__m256i b1 = _mm256_loadu_si256((const __m256i *)(ptr + 32));
+		__m256i s0 = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(b0, semicolon), _mm256_cmpeq_epi8(b0, dquote)),
+									 _mm256_or_si256(_mm256_cmpeq_epi8(b0, backtick), _mm256_cmpeq_epi8(b0, bracket)));
+		__m256i s1 = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(b1, semicolon), _mm256_cmpeq_epi8(b1, dquote)),
+									 _mm256_or_si256(_mm256_cmpeq_epi8(b1, backtick), _mm256_cmpeq_epi8(b1, bracket)));
+		
+		uint64_t stop = skipliterals_block(ptr,
+										   movemask64_avx2(_mm256_cmpeq_epi8(b0, quote), _mm256_cmpeq_epi8(b1, quote)),
+										   movemask64_avx2(s0, s1),
+										   movemask64_avx2(_mm256_cmpeq_epi8(b0, dash), _mm256_cmpeq_epi8(b1, dash)),
+										   movemask64_avx2(_mm256_cmpeq_epi8(b0, slash), _mm256_cmpeq_epi8(b1, slash)),
+										   movemask64_avx2(_mm256_cmpeq_epi8(b0, star), _mm256_cmpeq_epi8(b1, star)), &inside);
+		if (stop) {
+			*quoted = false;
+			return ptr + __builtin_ctzll(stop);
+		}
+		ptr += 64;
+	}
+	
+	*quoted = (inside != 0);
+	return ptr;
+}
+
+#endif
+
+// MARK: - Dispatch -
+
+static const char *find3_resolve (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3);
+static const char *skipblank_resolve (const char *ptr, const char *end);
+static const char *findset_resolve (const char *ptr, const char *end, const char *set);
+static const char *skipliterals_resolve (const char *ptr, const char *end, bool *quoted);
+
+// Threads may resolve the kernels concurrently on first use (pool workers do), so the pointers are only
+// accessed atomically. Relaxed ordering is enough as nothing but the pointer itself is published.
+#define SQL3SCAN_LOAD(fn)           __atomic_load_n(&(fn), __ATOMIC_RELAXED)
+#define SQL3SCAN_STORE(fn, value)   __atomic_store_n(&(fn), (value), __ATOMIC_RELAXED)
+
+static sql3scan_find3_fn find3_impl = find3_resolve;
+static sql3scan_skipblank_fn skipblank_impl = skipblank_resolve;
+static sql3scan_findset_fn findset_impl = findset_resolve;
+static sql3scan_skipliterals_fn skipliterals_impl = skipliterals_resolve;
+
+static sql3scan_level sql3scan_cpu_level (void) {
+	#if SQL3SCAN_X86_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return SQL3SCAN_AVX2;
+	#endif
+	return SQL3SCAN_SSE2;
+}
+
+sql3scan_level sql3scan_select (sql3scan_level level) {
+	sql3scan_level max = sql3scan_cpu_level();
+	if (level > max) level = max;
+
+	switch (level) {
+		#if SQL3SCAN_X86_AVX2
+		case SQL3SCAN_AVX2:
+			SQL3SCAN_STORE(find3_impl, find3_avx2);
+			SQL3SCAN_STORE(skipblank_impl, skipblank_avx2);
+			SQL3SCAN_STORE(findset_impl, findset_avx2);
+			SQL3SCAN_STORE(skipliterals_impl, skipliterals_avx2);
+			break;
+		#endif
+
+		case SQL3SCAN_SSE2:
+			SQL3SCAN_STORE(find3_impl, find3_sse2);
+			SQL3SCAN_STORE(skipblank_impl, skipblank_sse2);
+			SQL3SCAN_STORE(findset_impl, findset_sse2);
+			SQL3SCAN_STORE(skipliterals_impl, skipliterals_sse2);
+			break;
+
+		default:
+			level = SQL3SCAN_SCALAR;
+			SQL3SCAN_STORE(find3_impl, find3_scalar);
+			SQL3SCAN_STORE(skipblank_impl, skipblank_scalar);
+			SQL3SCAN_STORE(findset_impl, findset_scalar);
+			SQL3SCAN_STORE(skipliterals_impl, skipliterals_scalar);
+			break;
+	}
+
+	return level;
+}
+
+static const char *find3_resolve (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3) {
+	sql3scan_select(SQL3SCAN_AVX2);
+	return SQL3SCAN_LOAD(find3_impl)(ptr, end, c1, c2, c3);
+}
+
+static const char *skipblank_resolve (const char *ptr, const char *end) {
+	sql3scan_select(SQL3SCAN_AVX2);
+	return SQL3SCAN_LOAD(skipblank_impl)(ptr, end);
+}
+
+static const char *findset_resolve (const char *ptr, const char *end, const char *set) {
+	sql3scan_select(SQL3SCAN_AVX2);
+	return SQL3SCAN_LOAD(findset_impl)(ptr, end, set);
+}
+
+static const char *skipliterals_resolve (const char *ptr, const char *end, bool *quoted) {
+	sql3scan_select(SQL3SCAN_AVX2);
+	return SQL3SCAN_LOAD(skipliterals_impl)(ptr, end, quoted);
+}
+
+// MARK: - Public Functions -
+
+const char *sql3scan_find3 (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3) {
+	return SQL3SCAN_LOAD(find3_impl)(ptr, end, c1, c2, c3);
+}
+
+const char *sql3scan_skipblank (const char *ptr, const char *end) {
+	return SQL3SCAN_LOAD(skipblank_impl)(ptr, end);
+}
+
+const char *sql3scan_findset (const char *ptr, const char *end, const char *set) {
+	return SQL3SCAN_LOAD(findset_impl)(ptr, end, set);
+}
+
+const char *sql3scan_skipliterals (const char *ptr, const char *end, bool *quoted) {
+	return SQL3SCAN_LOAD(skipliterals_impl)(ptr, end, quoted);
+}
+
+#else
+
+sql3scan_level sql3scan_select (sql3scan_level level) {
+	// the scalar loops are inlined by the callers, there is nothing to select
+	(void)level;
+	return SQL3SCAN_SCALAR;
+}
+
+#endif
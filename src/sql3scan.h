@@ -0,0 +1,103 @@
+//
+//  sql3scan.h
+//
+//  Byte scanning kernels used by the lexer to move over comments, quoted
+//  identifiers, literals and expressions 16 or 32 bytes at a time.
+//
+//  The best implementation (AVX2, SSE2 or portable scalar code) is selected
+//  at runtime the first time a kernel is called. AVX2 is not built for
+//  Windows, whose GCC doesn't align the stack for 32 byte locals.
+//
+//  Targets without vector kernels get the scalar loops below as inline
+//  functions, so the lexer runs them in place like the byte loops they
+//  replaced instead of calling them through a pointer.
+//
+
+#ifndef __SQL3SCAN__
+#define __SQL3SCAN__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SQL3SCAN_SET_MAX        8       // maximum number of bytes accepted by sql3scan_findset
+
+// vector kernels are built for x86 GCC and Clang, -DSQL3SCAN_X86=0 forces the inline scalar loops
+#ifndef SQL3SCAN_X86
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define SQL3SCAN_X86            1
+#else
+#define SQL3SCAN_X86            0
+#endif
+#endif
+
+typedef enum {
+	SQL3SCAN_SCALAR,
+	SQL3SCAN_SSE2,
+	SQL3SCAN_AVX2
+} sql3scan_level;
+
+#if SQL3SCAN_X86
+
+// Return a pointer to the first byte in [ptr, end) equal to c1, c2 or c3 (end if none)
+const char *sql3scan_find3 (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3);
+
+// Return a pointer to the first byte in [ptr, end) that is not ' ', '\t', '\n' or '\r' (end if none)
+const char *sql3scan_skipblank (const char *ptr, const char *end);
+
+// Return a pointer to the first byte in [ptr, end) contained in set, a NUL terminated string of
+// 1 to SQL3SCAN_SET_MAX bytes (end if none)
+const char *sql3scan_findset (const char *ptr, const char *end, const char *set);
+
+// Return a pointer to the first ';', '"', '`', '[', "--" or "/*" in [ptr, end) that is not inside a single quoted
+// literal. ptr must not be inside a literal. Input is processed 64 bytes at a time and the scan also stops when 64
+// bytes or less are left (always right away for the scalar implementation): *quoted then tells whether the returned
+// pointer is inside a literal. Meant to jump over the literals of INSERT statements, the caller finishes the job.
+const char *sql3scan_skipliterals (const char *ptr, const char *end, bool *quoted);
+
+#else
+
+static inline const char *sql3scan_find3 (const char *ptr, const char *end, uint8_t c1, uint8_t c2, uint8_t c3) {
+	for (; ptr < end; ++ptr) {
+		uint8_t c = (uint8_t)*ptr;
+		if ((c == c1) || (c == c2) || (c == c3)) return ptr;
+	}
+	return end;
+}
+
+static inline const char *sql3scan_skipblank (const char *ptr, const char *end) {
+	while ((ptr < end) && ((*ptr == ' ') || (*ptr == '\t') || (*ptr == '\n') || (*ptr == '\r'))) ++ptr;
+	return ptr;
+}
+
+static inline const char *sql3scan_findset (const char *ptr, const char *end, const char *set) {
+	for (; ptr < end; ++ptr) {
+		for (const char *s = set; *s; ++s) {
+			if (*ptr == *s) return ptr;
+		}
+	}
+	return end;
+}
+
+static inline const char *sql3scan_skipliterals (const char *ptr, const char *end, bool *quoted) {
+	// no bulk mode without vectors, the caller scans byte sets from here
+	(void)end;
+	*quoted = false;
+	return ptr;
+}
+
+#endif
+
+// Select the implementation (mainly useful for benchmarks), levels not supported by the CPU are
+// downgraded and the level actually in use is returned
+sql3scan_level sql3scan_select (sql3scan_level level);
+
+#ifdef __cplusplus
+}  // end of the 'extern "C"' block
+#endif
+
+#endif
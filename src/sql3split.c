@@ -0,0 +1,430 @@
+//
+//  sql3split.c
+//
+//  Statement splitter built on top of the sql3scan kernels.
+//
+
+#include "sql3split.h"
+#include "sql3scan.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// bytes that can start a quote, a bracket identifier, a comment or end a statement
+#define SQL3SPLIT_SPECIAL       ";'\"`[-/"
+
+// MARK: - Utils -
+
+static inline bool symbol_is_identifier (uint8_t c) {
+	return (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) ||
+			(c == '_') || (c == '$') || (c >= 0x80));
+}
+
+static inline bool symbol_is_special (uint8_t c) {
+	return ((c == ';') || (c == '\'') || (c == '"') || (c == '`') || (c == '[') || (c == '-') || (c == '/'));
+}
+
+static const char *skip_c_comment (const char *ptr, const char *end) {
+	// ptr is just after "/*", jump from '/' to '/' like the lexer does
+	const char *p = ptr;
+	while (1) {
+		p = sql3scan_find3(p, end, '/', '/', '/');
+		if (p == end) return end;
+		if ((p > ptr) && (p[-1] == '*')) return p + 1;
+		++p;
+	}
+}
+
+static const char *skip_line_comment (const char *ptr, const char *end) {
+	const char *p = sql3scan_find3(ptr, end, '\n', '\n', '\n');
+	return (p == end) ? end : p + 1;
+}
+
+static const char *skip_quoted (const char *ptr, const char *end, uint8_t closing) {
+	// ptr is just after the opening quote, a doubled quote is an escaped quote (not for brackets)
+	const char *p = ptr;
+	while (1) {
+		p = sql3scan_find3(p, end, closing, closing, closing);
+		if (p == end) return end;
+		++p;
+		if ((closing != ']') && (p < end) && ((uint8_t)*p == closing)) {++p; continue;}
+		return p;
+	}
+}
+
+static const char *skip_trivia (const char *ptr, const char *end) {
+	// skip whitespaces and comments
+	const char *p = ptr;
+	while (1) {
+		p = sql3scan_skipblank(p, end);
+		if ((p < end) && ((*p == '\v') || (*p == '\f'))) {++p; continue;}
+		if ((end - p >= 2) && (p[0] == '-') && (p[1] == '-')) {p = skip_line_comment(p + 2, end); continue;}
+		if ((end - p >= 2) && (p[0] == '/') && (p[1] == '*')) {p = skip_c_comment(p + 2, end); continue;}
+		return p;
+	}
+}
+
+static bool match_keyword (const char **ptr, const char *end, const char *keyword) {
+	// case insensitive match of a whole word, ptr is moved after the word on success
+	const char *p = *ptr;
+	for (; *keyword; ++keyword, ++p) {
+		if ((p == end) || (((uint8_t)*p | 0x20) != (uint8_t)*keyword)) return false;
+	}
+	if ((p < end) && symbol_is_identifier((uint8_t)*p)) return false;
+
+	*ptr = p;
+	return true;
+}
+
+// MARK: - Splitter -
+
+static sql3split_kind split_kind (const char *ptr, const char *end) {
+	const char *p = ptr;
+
+	if (match_keyword(&p, end, "create")) {
+		p = skip_trivia(p, end);
+		if (match_keyword(&p, end, "temp") || match_keyword(&p, end, "temporary")) p = skip_trivia(p, end);
+		if (match_keyword(&p, end, "table")) return SQL3SPLIT_CREATE_TABLE;
+		if (match_keyword(&p, end, "trigger")) return SQL3SPLIT_CREATE_TRIGGER;
+		return SQL3SPLIT_OTHER;
+	}
+
+	if (match_keyword(&p, end, "alter")) {
+		p = skip_trivia(p, end);
+		if (match_keyword(&p, end, "table")) return SQL3SPLIT_ALTER_TABLE;
+	}
+
+	return SQL3SPLIT_OTHER;
+}
+
+static const char *split_semicolon (const char *ptr, const char *end) {
+	// return the first ';' outside quotes and comments (end if none)
+	const char *p = ptr;
+	while (1) {
+		// long statements are mostly literals (INSERT rows), jump over them 64 bytes at a time
+		bool quoted;
+		p = sql3scan_skipliterals(p, end, &quoted);
+		if (quoted) p = skip_quoted(p, end, '\'');
+		
+		if ((p == end) || !symbol_is_special((uint8_t)*p)) p = sql3scan_findset(p, end, SQL3SPLIT_SPECIAL);
+		if (p == end) return end;
+
+		uint8_t c = (uint8_t)*p++;
+		switch (c) {
+			case ';': return p - 1;
+			case '\'': case '"': case '`': p = skip_quoted(p, end, c); break;
+			case '[': p = skip_quoted(p, end, ']'); break;
+			case '-': if ((p < end) && (*p == '-')) p = skip_line_comment(p + 1, end); break;
+			case '/': if ((p < end) && (*p == '*')) p = skip_c_comment(p + 1, end); break;
+		}
+	}
+}
+
+static const char *split_trigger (const char *ptr, const char *end) {
+	// trigger bodies contain complete statements so only "; END ;" closes the trigger
+	const char *p = split_semicolon(ptr, end);
+	while (p < end) {
+		const char *q = skip_trivia(p + 1, end);
+		if (match_keyword(&q, end, "end")) {
+			q = skip_trivia(q, end);
+			if ((q < end) && (*q == ';')) return q;
+		}
+		p = split_semicolon(p + 1, end);
+	}
+	return end;
+}
+
+void sql3split_init (sql3split *split, const char *buffer, size_t size) {
+	split->buffer = buffer;
+	split->size = size;
+	split->offset = 0;
+}
+
+bool sql3split_next (sql3split *split, sql3split_statement *stmt) {
+	const char *end = split->buffer + split->size;
+	const char *p = split->buffer + split->offset;
+
+	while (1) {
+		// skip blanks and empty statements, comments are kept with the statement they precede
+		p = sql3scan_skipblank(p, end);
+		if ((p < end) && ((*p == ';') || (*p == '\v') || (*p == '\f'))) {++p; continue;}
+
+		const char *start = skip_trivia(p, end);
+		if (start == end) {split->offset = split->size; return false;}
+		if (*start == ';') {p = start + 1; continue;}
+
+		sql3split_kind kind = split_kind(start, end);
+		const char *last = (kind == SQL3SPLIT_CREATE_TRIGGER) ? split_trigger(start, end) : split_semicolon(start, end);
+
+		stmt->offset = (size_t)(p - split->buffer);
+		stmt->kind = kind;
+		stmt->is_complete = (last < end);
+		if (stmt->is_complete) {
+			++last;
+		} else {
+			// do not report the trailing blanks of an unterminated statement
+			while ((last > start) && ((last[-1] == ' ') || (last[-1] == '\t') || (last[-1] == '\n') || (last[-1] == '\r'))) --last;
+		}
+		stmt->length = (size_t)(last - p);
+
+		split->offset = (size_t)(last - split->buffer);
+		return true;
+	}
+}
+
+// MARK: - Stream -
+
+typedef enum {
+	STREAM_SEEK,                    // between statements
+	STREAM_HEAD,                    // statement start accumulated until its first keyword is complete
+	STREAM_KEEP,                    // statement accumulated until its end
+	STREAM_SKIP                     // statement skipped until its end
+} sql3stream_mode;
+
+typedef enum {
+	SCAN_CODE,
+	SCAN_QUOTED,
+	SCAN_LINE_COMMENT,
+	SCAN_C_COMMENT
+} sql3stream_scan;
+
+struct sql3stream {
+	sql3stream_mode mode;
+	sql3stream_scan scan;           // where the scan of the current statement stopped
+	uint8_t         closing;        // closing quote when scan is SCAN_QUOTED
+	uint8_t         pending;        // last byte of the previous chunk if it may start or end something
+	bool            stopped;        // flag set if the callback stopped the stream
+	size_t          position;       // offset of the next chunk in the stream
+	size_t          stmt_offset;    // offset of the current statement in the stream
+	size_t          stmt_end;       // offset after the last non blank byte of the skipped statement
+	char            *buffer;        // bytes of the accumulated statement
+	size_t          used;
+	size_t          capacity;
+};
+
+static const char *stream_scan (sql3stream *stream, const char *ptr, const char *end, bool *found) {
+	// resumable split_semicolon: return a pointer after the ';' that ends the statement (end if none)
+	const char *p = ptr;
+	*found = false;
+	while (p < end) {
+		uint8_t pending = stream->pending;
+		stream->pending = 0;
+		
+		switch (stream->scan) {
+			case SCAN_CODE: {
+				// a '-' or '/' that ended the previous chunk
+				if ((pending == '-') && (*p == '-')) {++p; stream->scan = SCAN_LINE_COMMENT; break;}
+				if ((pending == '/') && (*p == '*')) {++p; stream->scan = SCAN_C_COMMENT; break;}
+				
+				bool quoted;
+				p = sql3scan_skipliterals(p, end, &quoted);
+				if (quoted) {stream->scan = SCAN_QUOTED; stream->closing = '\''; break;}
+				
+				if ((p == end) || !symbol_is_special((uint8_t)*p)) p = sql3scan_findset(p, end, SQL3SPLIT_SPECIAL);
+				if (p == end) return end;
+				
+				uint8_t c = (uint8_t)*p++;
+				switch (c) {
+					case ';': *found = true; return p;
+					case '\'': case '"': case '`': stream->scan = SCAN_QUOTED; stream->closing = c; break;
+					case '[': stream->scan = SCAN_QUOTED; stream->closing = ']'; break;
+					case '-': case '/':
+						if (p == end) stream->pending = c;
+						else if ((c == '-') && (*p == '-')) {++p; stream->scan = SCAN_LINE_COMMENT;}
+						else if ((c == '/') && (*p == '*')) {++p; stream->scan = SCAN_C_COMMENT;}
+						break;
+				}
+			} break;
+			
+			case SCAN_QUOTED: {
+				// the closing quote ended the previous chunk, unless it is doubled
+				if (pending) {
+					if ((uint8_t)*p == pending) ++p;
+					else stream->scan = SCAN_CODE;
+					break;
+				}
+				
+				uint8_t closing = stream->closing;
+				p = sql3scan_find3(p, end, closing, closing, closing);
+				if (p == end) return end;
+				++p;
+				
+				if (closing == ']') stream->scan = SCAN_CODE;
+				else if (p == end) stream->pending = closing;
+				else if ((uint8_t)*p == closing) ++p;
+				else stream->scan = SCAN_CODE;
+			} break;
+			
+			case SCAN_LINE_COMMENT:
+				p = sql3scan_find3(p, end, '\n', '\n', '\n');
+				if (p == end) return end;
+				++p;
+				stream->scan = SCAN_CODE;
+				break;
+				
+			case SCAN_C_COMMENT: {
+				// pending is '*' if the comment body of the previous chunk ended with a '*'
+				const char *start = p;
+				while (1) {
+					const char *q = sql3scan_find3(p, end, '/', '/', '/');
+					if (q == end) {
+						stream->pending = (end > start) ? ((end[-1] == '*') ? '*' : 0) : pending;
+						return end;
+					}
+					if ((q > start) ? (q[-1] == '*') : (pending == '*')) {p = q + 1; break;}
+					p = q + 1;
+				}
+				stream->scan = SCAN_CODE;
+			} break;
+		}
+	}
+	return end;
+}
+
+static bool stream_append (sql3stream *stream, const char *ptr, size_t size) {
+	if (stream->used + size > stream->capacity) {
+		size_t capacity = (stream->capacity) ? stream->capacity : 4096;
+		while (capacity < stream->used + size) capacity *= 2;
+		
+		char *buffer = (char *)realloc(stream->buffer, capacity);
+		if (!buffer) return false;
+		stream->buffer = buffer;
+		stream->capacity = capacity;
+	}
+	memcpy(stream->buffer + stream->used, ptr, size);
+	stream->used += size;
+	return true;
+}
+
+static sql3stream_mode stream_decide (const char *ptr, const char *end) {
+	// statements starting with CREATE or ALTER are kept, any other is skipped
+	const char *p = skip_trivia(ptr, end);
+	if ((end - p == 1) && ((*p == '-') || (*p == '/'))) return STREAM_HEAD;
+	
+	const char *q = p;
+	while ((q < end) && symbol_is_identifier((uint8_t)*q)) ++q;
+	if (q == end) return STREAM_HEAD;
+	
+	if (match_keyword(&p, end, "create") || match_keyword(&p, end, "alter")) return STREAM_KEEP;
+	return STREAM_SKIP;
+}
+
+static bool stream_report (sql3stream *stream, const char *sql, sql3split_statement *stmt, sql3stream_callback callback, void *xdata) {
+	if (!callback(xdata, sql, stmt)) stream->stopped = true;
+	return !stream->stopped;
+}
+
+static bool stream_report_kept (sql3stream *stream, bool is_final, sql3stream_callback callback, void *xdata) {
+	// the accumulated bytes are split again so that trigger bodies and empty statements follow
+	// the same rules as sql3split_next, return true if the statement has been reported (or dropped)
+	sql3split split;
+	sql3split_statement stmt;
+	sql3split_init(&split, stream->buffer, stream->used);
+	
+	if (!sql3split_next(&split, &stmt)) {
+		stream->used = 0;
+		return true;
+	}
+	if (!stmt.is_complete && !is_final) return false;
+	
+	// short statements which are not kept can be completed before they are recognized
+	const char *sql = stream->buffer + stmt.offset;
+	if (stream_decide(sql, sql + stmt.length) == STREAM_SKIP) sql = NULL;
+	stmt.offset += stream->stmt_offset;
+	stream->used = 0;
+	stream_report(stream, sql, &stmt, callback, xdata);
+	return true;
+}
+
+sql3stream *sql3stream_create (void) {
+	return (sql3stream *)calloc(1, sizeof(sql3stream));
+}
+
+bool sql3stream_feed (sql3stream *stream, const char *chunk, size_t size, sql3stream_callback callback, void *xdata) {
+	const char *end = chunk + size;
+	const char *p = chunk;
+	
+	while (!stream->stopped && (p < end)) {
+		if (stream->mode == STREAM_SEEK) {
+			// skip blanks and empty statements
+			p = sql3scan_skipblank(p, end);
+			if (p == end) break;
+			if ((*p == ';') || (*p == '\v') || (*p == '\f')) {++p; continue;}
+			
+			// comments followed by ';' are an empty statement
+			const char *start = skip_trivia(p, end);
+			if ((start < end) && (*start == ';')) {p = start + 1; continue;}
+			
+			stream->scan = SCAN_CODE;
+			stream->pending = 0;
+			stream->stmt_offset = stream->position + (size_t)(p - chunk);
+			stream->used = 0;
+			
+			// most statements are recognized without being copied
+			stream->mode = stream_decide(p, end);
+		}
+		
+		bool is_complete;
+		const char *q = stream_scan(stream, p, end, &is_complete);
+		
+		if (stream->mode == STREAM_SKIP) {
+			if (is_complete) {
+				sql3split_statement stmt = {stream->stmt_offset, stream->position + (size_t)(q - chunk) - stream->stmt_offset, SQL3SPLIT_OTHER, true};
+				stream->mode = STREAM_SEEK;
+				stream_report(stream, NULL, &stmt, callback, xdata);
+			} else {
+				// remember where the statement would end if the stream stopped here
+				const char *last = q;
+				while ((last > p) && ((last[-1] == ' ') || (last[-1] == '\t') || (last[-1] == '\n') || (last[-1] == '\r'))) --last;
+				if (last > p) stream->stmt_end = stream->position + (size_t)(last - chunk);
+			}
+			p = q;
+			continue;
+		}
+		
+		// STREAM_HEAD or STREAM_KEEP
+		if (!stream_append(stream, p, (size_t)(q - p))) return false;
+		p = q;
+		
+		if (is_complete) {
+			if (stream_report_kept(stream, false, callback, xdata)) stream->mode = STREAM_SEEK;
+			else stream->mode = STREAM_KEEP;
+			continue;
+		}
+		
+		if (stream->mode == STREAM_HEAD) {
+			stream->mode = stream_decide(stream->buffer, stream->buffer + stream->used);
+			if (stream->mode == STREAM_SKIP) {
+				// only the scan state is needed from now on
+				const char *last = stream->buffer + stream->used;
+				while ((last > stream->buffer) && ((last[-1] == ' ') || (last[-1] == '\t') || (last[-1] == '\n') || (last[-1] == '\r'))) --last;
+				stream->stmt_end = stream->stmt_offset + (size_t)(last - stream->buffer);
+				stream->used = 0;
+			}
+		}
+	}
+	
+	stream->position += size;
+	return !stream->stopped;
+}
+
+bool sql3stream_finish (sql3stream *stream, sql3stream_callback callback, void *xdata) {
+	if (stream->stopped) return false;
+	
+	sql3stream_mode mode = stream->mode;
+	stream->mode = STREAM_SEEK;
+	
+	if (mode == STREAM_SKIP) {
+		sql3split_statement stmt = {stream->stmt_offset, stream->stmt_end - stream->stmt_offset, SQL3SPLIT_OTHER, false};
+		return stream_report(stream, NULL, &stmt, callback, xdata);
+	}
+	
+	if ((mode == STREAM_HEAD) || (mode == STREAM_KEEP)) stream_report_kept(stream, true, callback, xdata);
+	return !stream->stopped;
+}
+
+void sql3stream_free (sql3stream *stream) {
+	if (!stream) return;
+	free(stream->buffer);
+	free(stream);
+}
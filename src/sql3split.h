@@ -0,0 +1,68 @@
+//
+//  sql3split.h
+//
+//  Splits a SQL script into statements without tokenizing it: the splitter
+//  only stops on bytes that can change the meaning of what follows (';',
+//  quotes, '[', comment starts) so it runs at the speed of sql3scan_findset.
+//
+//  Statements end at a ';' outside quotes, bracket identifiers and comments.
+//  Inside CREATE TRIGGER the ';' of the body statements do not count, the
+//  trigger ends with "; END ;" (the same rule used by sqlite3_complete).
+//
+
+#ifndef __SQL3SPLIT__
+#define __SQL3SPLIT__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	SQL3SPLIT_OTHER,                // any statement not handled by sql3parse_table
+	SQL3SPLIT_CREATE_TABLE,         // CREATE [TEMP | TEMPORARY] TABLE
+	SQL3SPLIT_ALTER_TABLE,          // ALTER TABLE
+	SQL3SPLIT_CREATE_TRIGGER        // CREATE [TEMP | TEMPORARY] TRIGGER
+} sql3split_kind;
+
+typedef struct {
+	size_t          offset;         // offset of the first byte (leading comments belong to the statement)
+	size_t          length;         // length including the terminating ';'
+	sql3split_kind  kind;           // kind guessed from the first keywords
+	bool            is_complete;    // false if the script ended before the terminating ';'
+} sql3split_statement;
+
+typedef struct {
+	const char      *buffer;        // script to split
+	size_t          size;           // size of the script
+	size_t          offset;         // offset where the next statement search begins
+} sql3split;
+
+// Prepare a splitter over buffer (the buffer is not copied and must outlive the splitter)
+void sql3split_init (sql3split *split, const char *buffer, size_t size);
+
+// Fill stmt with the next non empty statement, return false when the script is exhausted
+bool sql3split_next (sql3split *split, sql3split_statement *stmt);
+
+// Streaming: the script is fed in chunks of any size and statements are reported as soon as they are
+// complete, with offset relative to the start of the stream. Statements that may be handled by
+// sql3parse_table (the ones starting with CREATE or ALTER) are accumulated and reported with sql pointing
+// to their bytes (valid during the callback only). Any other statement is skipped as the chunks go by
+// and reported with a NULL sql, so memory does not depend on the size of the statements skipped.
+// callback returns false to stop the stream. sql3stream_feed and sql3stream_finish (which reports an
+// unterminated last statement) return false if the stream was stopped or ran out of memory.
+typedef struct sql3stream sql3stream;
+typedef bool (*sql3stream_callback) (void *xdata, const char *sql, const sql3split_statement *stmt);
+
+sql3stream *sql3stream_create (void);
+bool sql3stream_feed (sql3stream *stream, const char *chunk, size_t size, sql3stream_callback callback, void *xdata);
+bool sql3stream_finish (sql3stream *stream, sql3stream_callback callback, void *xdata);
+void sql3stream_free (sql3stream *stream);
+
+#ifdef __cplusplus
+}  // end of the 'extern "C"' block
+#endif
+
+#endif
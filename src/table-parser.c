@@ -7,28 +7,50 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 
 
 #include "sql3parse_table.h"
+#include "table-parser.h"
+#include "constants.h"
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Helper for truning an sql3string to an R CHAR
+//
+// The CHARSXP is built straight from the (ptr, length) slice of the input.
+// The input is always handed to the parser as UTF-8 (see sql_utf8()) so the
+// slice can be marked as UTF-8
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP rchr(sql3string str) {
+  if (str.ptr == NULL) {
+    return NA_STRING;
+  }
+  return mkCharLenCE(str.ptr, (int)str.length, CE_UTF8);
+}
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // Helper for truning an sql3string to an R STRING
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-SEXP rstr(sql3string *str) {
-  if (str == NULL) {
+SEXP rstr(sql3string str) {
+  if (str.ptr == NULL) {
     return R_NilValue;
   }
-  return mkString(sql3string_cstring(str));
+  return ScalarString(rchr(str));
 }
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// Helper for truning an sql3string to an R CHAR
+// Helper for getting the UTF-8 bytes of an R CHAR to hand to the parser.
+// UTF-8 and ASCII strings are used in place, anything else is translated
+// into memory which R reclaims at the end of the .Call
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-SEXP rchr(sql3string *str) {
-  if (str == NULL) {
-    return NA_STRING;
+const char *sql_utf8(SEXP chr_, size_t *len) {
+  if (getCharCE(chr_) == CE_UTF8) {
+    *len = (size_t)LENGTH(chr_);
+    return CHAR(chr_);
   }
-  return mkChar(sql3string_cstring(str));
+  const char *utf8 = translateCharUTF8(chr_);
+  *len = (utf8 == CHAR(chr_)) ? (size_t)LENGTH(chr_) : strlen(utf8);
+  return utf8;
 }
 
 
@@ -43,11 +65,7 @@ void list_to_df(SEXP list_, unsigned int nrows) {
   // Treat the VECSXP as a data.frame by setting the 'class' attribute
   // Also set some classes so that it appears as a tibble.
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  SEXP class_ = PROTECT(allocVector(STRSXP, 3)); nprotect++;
-  SET_STRING_ELT(class_, 0, mkChar("tbl_df"));
-  SET_STRING_ELT(class_, 1, mkChar("tbl"));
-  SET_STRING_ELT(class_, 2, mkChar("data.frame"));
-  SET_CLASS(list_, class_);
+  SET_CLASS(list_, tbl_df_class_);
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   // Set the row.names on the list.
@@ -77,14 +95,8 @@ SEXP parse_indexed_column(sql3tableconstraint *table_con) {
     return R_NilValue;
   }
   
-  SEXP df_       = PROTECT(allocVector(VECSXP, 3)); nprotect++;
-  SEXP df_names_ = PROTECT(allocVector(STRSXP, 3)); nprotect++;
-  
-  SET_STRING_ELT(df_names_,  0, mkChar("name"));  
-  SET_STRING_ELT(df_names_,  1, mkChar("collate"));  
-  SET_STRING_ELT(df_names_,  2, mkChar("order"));  
-  
-  setAttrib(df_, R_NamesSymbol, df_names_);
+  SEXP df_ = PROTECT(allocVector(VECSXP, 3)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, idx_cols_names_);
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   // 
@@ -160,177 +172,271 @@ SEXP parse_fk_get_column(sql3foreignkey *fk) {
 
 
 
+
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// Parse table constraints to a data.frame
+// Parse table constraints of all tables into a single long data.frame
+//
+// In 'flat' mode the 'idx_cols', 'fk_cols' and 'fk_ref_cols' list columns
+// are replaced by integer offsets (CSR style) into the flat tables built by
+// parse_flat_idx_cols() and parse_flat_fk_cols(). The entries of
+// constraint i are rows [offset, offset + count) of the flat table, where
+// count is 'num_idx_cols', 'num_fk_cols' or 'fk_num_cols'
+//
+// @param tables parsed tables. NULL entries (failed statements) are skipped
+// @param stmt_ids statement id reported for each table
+// @param ntables number of tables
+// @param flat return offsets instead of list columns
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-SEXP parse_table_constraints(sql3table *table) {
+SEXP parse_table_constraints(sql3table **tables, const int *stmt_ids, R_xlen_t ntables, bool flat) {
   
   unsigned int nprotect = 0;
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  // Constraints
+  // Count constraints first so every vector is allocated only once
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  int N = sql3table_num_constraints(table);
-  
-  if (N == 0) {
-    return R_NilValue;
+  R_xlen_t N = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    if (tables[t] != NULL) N += sql3table_num_constraints(tables[t]);
   }
   
-  SEXP df_       = PROTECT(allocVector(VECSXP, 14)); nprotect++;
-  SEXP df_names_ = PROTECT(allocVector(STRSXP, 14)); nprotect++;
-  
-  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  // Create names for constaints data.frame
-  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  SET_STRING_ELT(df_names_,  0, mkChar("name"));  
-  SET_STRING_ELT(df_names_,  1, mkChar("type"));  
-  SET_STRING_ELT(df_names_,  2, mkChar("idx_cols")); // data.frame
-  SET_STRING_ELT(df_names_,  3, mkChar("conflict_clause"));  
-  SET_STRING_ELT(df_names_,  4, mkChar("check_expr"));  
-  SET_STRING_ELT(df_names_,  5, mkChar("num_fk_cols"));  
-  SET_STRING_ELT(df_names_,  6, mkChar("fk_cols")); // data.frame
-  SET_STRING_ELT(df_names_,  7, mkChar("fk_table"));
-  SET_STRING_ELT(df_names_,  8, mkChar("fk_num_cols"));
-  SET_STRING_ELT(df_names_,  9, mkChar("fk_cols"));
-  SET_STRING_ELT(df_names_, 10, mkChar("fk_on_delete"));
-  SET_STRING_ELT(df_names_, 11, mkChar("fk_on_update"));
-  SET_STRING_ELT(df_names_, 12, mkChar("fk_match"));
-  SET_STRING_ELT(df_names_, 13, mkChar("fk_deferrable"));
-  
-  setAttrib(df_, R_NamesSymbol, df_names_);
+  SEXP df_ = PROTECT(allocVector(VECSXP, flat ? 16 : 15)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, flat ? flat_constraints_names_ : constraints_names_);
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   // Create SEXP vectors for each column in the data.frame
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  SEXP con_name_        = PROTECT(allocVector(STRSXP, N)); nprotect++; // 0
-  SEXP con_type_        = PROTECT(allocVector(INTSXP, N)); nprotect++; // 1
-  SEXP idx_cols_        = PROTECT(allocVector(VECSXP, N)); nprotect++; // 2
-  SEXP con_conflict_    = PROTECT(allocVector(INTSXP, N)); nprotect++; // 3
-  SEXP con_check_expr_  = PROTECT(allocVector(STRSXP, N)); nprotect++; // 4
-  SEXP con_num_fk_cols_ = PROTECT(allocVector(INTSXP, N)); nprotect++; // 5
-  SEXP fk_colnames_     = PROTECT(allocVector(VECSXP, N)); nprotect++; // 6
+  SEXPTYPE nested = flat ? INTSXP : VECSXP;
+  
+  SEXP stmt_id_         = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP con_name_        = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP con_type_        = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP idx_cols_        = PROTECT(allocVector(nested, N)); nprotect++;
+  SEXP num_idx_cols_    = PROTECT(allocVector(INTSXP, flat ? N : 0)); nprotect++;
+  SEXP con_conflict_    = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP con_check_expr_  = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP con_num_fk_cols_ = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP fk_colnames_     = PROTECT(allocVector(nested, N)); nprotect++;
   
   // foreignkey clause
-  SEXP fk_table_       = PROTECT(allocVector(STRSXP, N)); nprotect++; // 7
-  SEXP fk_num_cols_    = PROTECT(allocVector(INTSXP, N)); nprotect++; // 8
-  SEXP fk_cols_        = PROTECT(allocVector(VECSXP, N)); nprotect++; // 9
-  SEXP fk_on_delete_   = PROTECT(allocVector(INTSXP, N)); nprotect++; // 10
-  SEXP fk_on_update_   = PROTECT(allocVector(INTSXP, N)); nprotect++; // 11
-  SEXP fk_match_       = PROTECT(allocVector(STRSXP, N)); nprotect++; // 12
-  SEXP fk_deferrable_  = PROTECT(allocVector(INTSXP, N)); nprotect++; // 13
-  
-  SET_VECTOR_ELT(df_,  0, con_name_       );
-  SET_VECTOR_ELT(df_,  1, con_type_       );
-  SET_VECTOR_ELT(df_,  2, idx_cols_       );
-  SET_VECTOR_ELT(df_,  3, con_conflict_   );
-  SET_VECTOR_ELT(df_,  4, con_check_expr_ );
-  SET_VECTOR_ELT(df_,  5, con_num_fk_cols_);
-  SET_VECTOR_ELT(df_,  6, fk_colnames_    );
-  SET_VECTOR_ELT(df_,  7, fk_table_       );
-  SET_VECTOR_ELT(df_,  8, fk_num_cols_    );
-  SET_VECTOR_ELT(df_,  9, fk_cols_        );
-  SET_VECTOR_ELT(df_, 10, fk_on_delete_   );
-  SET_VECTOR_ELT(df_, 11, fk_on_update_   );
-  SET_VECTOR_ELT(df_, 12, fk_match_       );
-  SET_VECTOR_ELT(df_, 13, fk_deferrable_  );
-  
-  
-  for (int i = 0; i < N; i++) {
-    sql3tableconstraint *table_con = sql3table_get_constraint(table, i);
-    
-    SET_STRING_ELT(con_name_, i, rchr(sql3table_constraint_name(table_con)));             // 0
-    INTEGER(con_type_    )[i] = 1 + sql3table_constraint_type(table_con);                 // 2
-    SET_VECTOR_ELT(idx_cols_, i, parse_indexed_column(table_con));                        // 3
-    INTEGER(con_conflict_)[i] = sql3table_constraint_conflict_clause(table_con);          // 4
-    SET_STRING_ELT(con_check_expr_, i, rchr(sql3table_constraint_check_expr(table_con))); // 5
-    INTEGER(con_num_fk_cols_)[i] = sql3table_constraint_num_fkcolumns(table_con);         // 6
-    SET_VECTOR_ELT(fk_colnames_, i, parse_fk_column(table_con));                          // 7
-    
-    sql3foreignkey *fk = sql3table_constraint_foreignkey_clause(table_con);
-    if (fk != NULL) {
-      SET_STRING_ELT(fk_table_, i, rchr(sql3foreignkey_table(fk)));       //  8
-      INTEGER(fk_num_cols_)[i] = sql3foreignkey_num_columns(fk);          //  9
-      SET_VECTOR_ELT(fk_cols_, i, parse_fk_get_column(fk));               // 10
-      INTEGER(fk_on_delete_)[i] = 1 + sql3foreignkey_ondelete_action(fk); // 11
-      INTEGER(fk_on_update_)[i] = 1 + sql3foreignkey_onupdate_action(fk); // 12
-      SET_STRING_ELT(fk_match_, i, rchr(sql3foreignkey_match(fk)));       // 13
-      INTEGER(fk_deferrable_)[i] = 1 + sql3foreignkey_deferrable(fk);     // 14
-    } else {
-      SET_STRING_ELT(fk_table_, i, NA_STRING); //  8
-      INTEGER(fk_num_cols_)[i] = NA_INTEGER;   //  9
-      SET_VECTOR_ELT(fk_cols_, i, R_NilValue); // 10
-      INTEGER(fk_on_delete_)[i] = NA_INTEGER;  // 11
-      INTEGER(fk_on_update_)[i] = NA_INTEGER;  // 12
-      SET_STRING_ELT(fk_match_, i, NA_STRING); // 13
-      INTEGER(fk_deferrable_)[i] = NA_INTEGER; // 14
+  SEXP fk_table_       = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP fk_num_cols_    = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP fk_cols_        = PROTECT(allocVector(nested, N)); nprotect++;
+  SEXP fk_on_delete_   = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP fk_on_update_   = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP fk_match_       = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP fk_deferrable_  = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  
+  int col = 0;
+  SET_VECTOR_ELT(df_, col++, stmt_id_        );
+  SET_VECTOR_ELT(df_, col++, con_name_       );
+  SET_VECTOR_ELT(df_, col++, con_type_       );
+  SET_VECTOR_ELT(df_, col++, idx_cols_       );
+  if (flat) {
+    SET_VECTOR_ELT(df_, col++, num_idx_cols_ );
+  }
+  SET_VECTOR_ELT(df_, col++, con_conflict_   );
+  SET_VECTOR_ELT(df_, col++, con_check_expr_ );
+  SET_VECTOR_ELT(df_, col++, con_num_fk_cols_);
+  SET_VECTOR_ELT(df_, col++, fk_colnames_    );
+  SET_VECTOR_ELT(df_, col++, fk_table_       );
+  SET_VECTOR_ELT(df_, col++, fk_num_cols_    );
+  SET_VECTOR_ELT(df_, col++, fk_cols_        );
+  SET_VECTOR_ELT(df_, col++, fk_on_delete_   );
+  SET_VECTOR_ELT(df_, col++, fk_on_update_   );
+  SET_VECTOR_ELT(df_, col++, fk_match_       );
+  SET_VECTOR_ELT(df_, col++, fk_deferrable_  );
+
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // 1-based offsets of the next row in the flat idx_cols and fk_cols tables.
+  // Must visit entries in the same order as parse_flat_idx_cols() and
+  // parse_flat_fk_cols()
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  int idx_offset = 1;
+  int fk_offset  = 1;
+
+  R_xlen_t i = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    sql3table *table = tables[t];
+    if (table == NULL) continue;
+  
+    size_t ncons = sql3table_num_constraints(table);
+    for (size_t j = 0; j < ncons; j++, i++) {
+      sql3tableconstraint *table_con = sql3table_get_constraint(table, j);
+      size_t nidx = sql3table_constraint_num_idxcolumns(table_con);
+      size_t nfk  = sql3table_constraint_num_fkcolumns(table_con);
+  
+      INTEGER(stmt_id_)[i] = stmt_ids[t];
+      SET_STRING_ELT(con_name_, i, rchr(sql3table_constraint_name(table_con)));
+      INTEGER(con_type_    )[i] = 1 + sql3table_constraint_type(table_con);
+      INTEGER(con_conflict_)[i] = sql3table_constraint_conflict_clause(table_con);
+      SET_STRING_ELT(con_check_expr_, i, rchr(sql3table_constraint_check_expr(table_con)));
+      INTEGER(con_num_fk_cols_)[i] = (int)nfk;
+      
+      if (flat) {
+        INTEGER(idx_cols_    )[i] = idx_offset;
+        INTEGER(num_idx_cols_)[i] = (int)nidx;
+        INTEGER(fk_colnames_ )[i] = fk_offset;
+        idx_offset += (int)nidx;
+        fk_offset  += (int)nfk;
+      } else {
+        SET_VECTOR_ELT(idx_cols_   , i, parse_indexed_column(table_con));
+        SET_VECTOR_ELT(fk_colnames_, i, parse_fk_column(table_con));
+      }
+  
+      sql3foreignkey *fk = sql3table_constraint_foreignkey_clause(table_con);
+      if (fk != NULL) {
+        SET_STRING_ELT(fk_table_, i, rchr(sql3foreignkey_table(fk)));
+        INTEGER(fk_num_cols_)[i] = sql3foreignkey_num_columns(fk);
+        if (flat) {
+          INTEGER(fk_cols_)[i] = fk_offset;
+          fk_offset += (int)sql3foreignkey_num_columns(fk);
+        } else {
+          SET_VECTOR_ELT(fk_cols_, i, parse_fk_get_column(fk));
+        }
+        INTEGER(fk_on_delete_)[i] = 1 + sql3foreignkey_ondelete_action(fk);
+        INTEGER(fk_on_update_)[i] = 1 + sql3foreignkey_onupdate_action(fk);
+        SET_STRING_ELT(fk_match_, i, rchr(sql3foreignkey_match(fk)));
+        INTEGER(fk_deferrable_)[i] = 1 + sql3foreignkey_deferrable(fk);
+      } else {
+        SET_STRING_ELT(fk_table_, i, NA_STRING);
+        INTEGER(fk_num_cols_)[i] = NA_INTEGER;
+        if (flat) {
+          INTEGER(fk_cols_)[i] = NA_INTEGER;
+        } else {
+          SET_VECTOR_ELT(fk_cols_, i, R_NilValue);
+        }
+        INTEGER(fk_on_delete_)[i] = NA_INTEGER;
+        INTEGER(fk_on_update_)[i] = NA_INTEGER;
+        SET_STRING_ELT(fk_match_, i, NA_STRING);
+        INTEGER(fk_deferrable_)[i] = NA_INTEGER;
+      }
     }
   }
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   // Set factors
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  {
-    // SQL3FKACTION_NONE,
-    // SQL3FKACTION_SETNULL,
-    // SQL3FKACTION_SETDEFAULT,
-    // SQL3FKACTION_CASCADE,
-    // SQL3FKACTION_RESTRICT,
-    // SQL3FKACTION_NOACTION
-    SEXP levels_ = PROTECT(allocVector(STRSXP, 6)); 
-    SET_STRING_ELT(levels_, 0, mkChar("none"));
-    SET_STRING_ELT(levels_, 1, mkChar("set null"));
-    SET_STRING_ELT(levels_, 2, mkChar("set default"));
-    SET_STRING_ELT(levels_, 3, mkChar("cascade"));
-    SET_STRING_ELT(levels_, 4, mkChar("restrict"));
-    SET_STRING_ELT(levels_, 5, mkChar("no action"));
-    
-    setAttrib(fk_on_delete_, R_ClassSymbol, mkString("factor"));
-    setAttrib(fk_on_delete_, R_LevelsSymbol, levels_);
-    
-    setAttrib(fk_on_update_, R_ClassSymbol, mkString("factor"));
-    setAttrib(fk_on_update_, R_LevelsSymbol, levels_);
-    
-    UNPROTECT(1);
+  setAttrib(fk_on_delete_, R_ClassSymbol, factor_class_);
+  setAttrib(fk_on_delete_, R_LevelsSymbol, fk_action_levels_);
+  
+  setAttrib(fk_on_update_, R_ClassSymbol, factor_class_);
+  setAttrib(fk_on_update_, R_LevelsSymbol, fk_action_levels_);
+  
+  setAttrib(fk_deferrable_, R_ClassSymbol, factor_class_);
+  setAttrib(fk_deferrable_, R_LevelsSymbol, deferrable_levels_);
+  
+  setAttrib(con_type_, R_ClassSymbol, factor_class_);
+  setAttrib(con_type_, R_LevelsSymbol, con_type_levels_);
+  
+  list_to_df(df_, N);
+  
+  UNPROTECT(nprotect);
+  return df_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Indexed columns of every constraint of all tables as one flat data.frame.
+// Rows are addressed by the 'idx_cols' offsets of the flat constraints
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_flat_idx_cols(sql3table **tables, R_xlen_t ntables) {
+  
+  unsigned int nprotect = 0;
+  
+  R_xlen_t N = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    if (tables[t] == NULL) continue;
+    size_t ncons = sql3table_num_constraints(tables[t]);
+    for (size_t j = 0; j < ncons; j++) {
+      N += sql3table_constraint_num_idxcolumns(sql3table_get_constraint(tables[t], j));
+    }
   }
   
-  {
-    // SQL3DEFTYPE_NONE,
-    // SQL3DEFTYPE_DEFERRABLE,
-    // SQL3DEFTYPE_DEFERRABLE_INITIALLY_DEFERRED,
-    // SQL3DEFTYPE_DEFERRABLE_INITIALLY_IMMEDIATE,
-    // SQL3DEFTYPE_NOTDEFERRABLE,
-    // SQL3DEFTYPE_NOTDEFERRABLE_INITIALLY_DEFERRED,
-    // SQL3DEFTYPE_NOTDEFERRABLE_INITIALLY_IMMEDIATE
-    SEXP levels_ = PROTECT(allocVector(STRSXP, 7)); 
-    SET_STRING_ELT(levels_, 0, mkChar("none"));
-    SET_STRING_ELT(levels_, 1, mkChar("deferrable"));
-    SET_STRING_ELT(levels_, 2, mkChar("deferrable initially deferred"));
-    SET_STRING_ELT(levels_, 3, mkChar("deferrable initially immediate"));
-    SET_STRING_ELT(levels_, 4, mkChar("not deferrable"));
-    SET_STRING_ELT(levels_, 5, mkChar("not deferrable initially deferred"));
-    SET_STRING_ELT(levels_, 6, mkChar("not deferrable initially immediate"));
-    
-    setAttrib(fk_deferrable_, R_ClassSymbol, mkString("factor"));
-    setAttrib(fk_deferrable_, R_LevelsSymbol, levels_);
-    
-    UNPROTECT(1);
+  SEXP df_ = PROTECT(allocVector(VECSXP, 3)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, idx_cols_names_);
+  
+  SEXP name_    = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP collate_ = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP order_   = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  
+  SET_VECTOR_ELT(df_, 0, name_);
+  SET_VECTOR_ELT(df_, 1, collate_);
+  SET_VECTOR_ELT(df_, 2, order_);
+  
+  R_xlen_t i = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    if (tables[t] == NULL) continue;
+    size_t ncons = sql3table_num_constraints(tables[t]);
+    for (size_t j = 0; j < ncons; j++) {
+      sql3tableconstraint *table_con = sql3table_get_constraint(tables[t], j);
+      size_t nidx = sql3table_constraint_num_idxcolumns(table_con);
+      for (size_t k = 0; k < nidx; k++, i++) {
+        sql3idxcolumn *idx_col = sql3table_constraint_get_idxcolumn(table_con, k);
+        SET_STRING_ELT(name_   , i, rchr(sql3idxcolumn_name   (idx_col)));
+        SET_STRING_ELT(collate_, i, rchr(sql3idxcolumn_collate(idx_col)));
+        INTEGER(order_)[i] = 1 + sql3idxcolumn_order(idx_col);
+      }
+    }
   }
   
-  {
-    // SQL3TABLECONSTRAINT_PRIMARYKEY,
-    // SQL3TABLECONSTRAINT_UNIQUE,
-    // SQL3TABLECONSTRAINT_CHECK,
-    // SQL3TABLECONSTRAINT_FOREIGNKEY
-    SEXP levels_ = PROTECT(allocVector(STRSXP, 4)); 
-    SET_STRING_ELT(levels_, 0, mkChar("primary key"));
-    SET_STRING_ELT(levels_, 1, mkChar("unique"));
-    SET_STRING_ELT(levels_, 2, mkChar("check"));
-    SET_STRING_ELT(levels_, 3, mkChar("foreign key"));
-    
-    setAttrib(con_type_, R_ClassSymbol, mkString("factor"));
-    setAttrib(con_type_, R_LevelsSymbol, levels_);
-    
-    UNPROTECT(1);
+  setAttrib(order_, R_ClassSymbol, factor_class_);
+  setAttrib(order_, R_LevelsSymbol, order_levels_);
+  
+  list_to_df(df_, N);
+  
+  UNPROTECT(nprotect);
+  return df_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Foreign key columns of every constraint of all tables as one flat
+// data.frame. For each constraint the columns of this table come first, 
+// followed by the referenced columns of the foreign table. Rows are 
+// addressed by the 'fk_cols' and 'fk_ref_cols' offsets of the flat 
+// constraints
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_flat_fk_cols(sql3table **tables, R_xlen_t ntables) {
+  
+  unsigned int nprotect = 0;
+  
+  R_xlen_t N = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    if (tables[t] == NULL) continue;
+    size_t ncons = sql3table_num_constraints(tables[t]);
+    for (size_t j = 0; j < ncons; j++) {
+      sql3tableconstraint *table_con = sql3table_get_constraint(tables[t], j);
+      sql3foreignkey *fk = sql3table_constraint_foreignkey_clause(table_con);
+      N += sql3table_constraint_num_fkcolumns(table_con);
+      if (fk != NULL) N += sql3foreignkey_num_columns(fk);
+    }
+  }
+  
+  SEXP df_ = PROTECT(allocVector(VECSXP, 1)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, fk_cols_names_);
+  
+  SEXP name_ = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SET_VECTOR_ELT(df_, 0, name_);
+  
+  R_xlen_t i = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    if (tables[t] == NULL) continue;
+    size_t ncons = sql3table_num_constraints(tables[t]);
+    for (size_t j = 0; j < ncons; j++) {
+      sql3tableconstraint *table_con = sql3table_get_constraint(tables[t], j);
+      
+      size_t nfk = sql3table_constraint_num_fkcolumns(table_con);
+      for (size_t k = 0; k < nfk; k++, i++) {
+        SET_STRING_ELT(name_, i, rchr(sql3table_constraint_get_fkcolumn(table_con, k)));
+      }
+      
+      sql3foreignkey *fk = sql3table_constraint_foreignkey_clause(table_con);
+      if (fk == NULL) continue;
+      size_t nref = sql3foreignkey_num_columns(fk);
+      for (size_t k = 0; k < nref; k++, i++) {
+        SET_STRING_ELT(name_, i, rchr(sql3foreignkey_get_column(fk, k)));
+      }
+    }
   }
   
   list_to_df(df_, N);
@@ -341,54 +447,33 @@ SEXP parse_table_constraints(sql3table *table) {
 
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// Parse database column information into a data.frame
+// Parse database column information of all tables into a single long
+// data.frame
 //
 // @return data.frame
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-SEXP parse_column_info(sql3table *table) {
+SEXP parse_column_info(sql3table **tables, const int *stmt_ids, R_xlen_t ntables) {
   
   unsigned int nprotect = 0;
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  // Column Info
+  // Count columns first so every vector is allocated only once
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  int N = sql3table_num_columns(table);
-  
-  if (N == 0) {
-    return R_NilValue;
+  R_xlen_t N = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    if (tables[t] != NULL) N += sql3table_num_columns(tables[t]);
   }
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   // Create columns data.frame and name it
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  SEXP df_       = PROTECT(allocVector(VECSXP, 16)); nprotect++;
-  SEXP df_names_ = PROTECT(allocVector(STRSXP, 16)); nprotect++;
-  
-  SET_STRING_ELT(df_names_,  0, mkChar("name"));  
-  SET_STRING_ELT(df_names_,  1, mkChar("type"));  
-  SET_STRING_ELT(df_names_,  2, mkChar("length"));  
-  SET_STRING_ELT(df_names_,  3, mkChar("constraint_name"));  
-  SET_STRING_ELT(df_names_,  4, mkChar("comment"));
-  
-  SET_STRING_ELT(df_names_,  5, mkChar("primary_key"));
-  SET_STRING_ELT(df_names_,  6, mkChar("auto_increment"));
-  SET_STRING_ELT(df_names_,  7, mkChar("not_null"));
-  SET_STRING_ELT(df_names_,  8, mkChar("unique"));
-  
-  SET_STRING_ELT(df_names_,  9, mkChar("order_pk"));
-  SET_STRING_ELT(df_names_, 10, mkChar("conflict_pk"));
-  SET_STRING_ELT(df_names_, 11, mkChar("conflict_no_null"));
-  SET_STRING_ELT(df_names_, 12, mkChar("conflict_unique"));
-  
-  SET_STRING_ELT(df_names_, 13, mkChar("check_expr"));
-  SET_STRING_ELT(df_names_, 14, mkChar("default_expr"));
-  SET_STRING_ELT(df_names_, 15, mkChar("collate_name"));
-  
-  setAttrib(df_, R_NamesSymbol, df_names_);
+  SEXP df_ = PROTECT(allocVector(VECSXP, 17)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, columns_names_);
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   // Create SEXP vectors for each column and place in data.frame
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP stmt_id_    = PROTECT(allocVector(INTSXP, N)); nprotect++;
   SEXP col_names_  = PROTECT(allocVector(STRSXP, N)); nprotect++;
   SEXP col_types_  = PROTECT(allocVector(STRSXP, N)); nprotect++;
   SEXP col_lens_   = PROTECT(allocVector(STRSXP, N)); nprotect++;
@@ -409,91 +494,77 @@ SEXP parse_column_info(sql3table *table) {
   // Set factors
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
   {
-    // Order 
-    SEXP order_levels_ = PROTECT(allocVector(STRSXP, 3)); 
-    SET_STRING_ELT(order_levels_, 0, mkChar("none"));
-    SET_STRING_ELT(order_levels_, 1, mkChar("ascending"));
-    SET_STRING_ELT(order_levels_, 2, mkChar("descending"));
-    setAttrib(col_order_, R_ClassSymbol, mkString("factor"));
+    setAttrib(col_order_, R_ClassSymbol, factor_class_);
     setAttrib(col_order_, R_LevelsSymbol, order_levels_);
-    UNPROTECT(1);
-    
-    
-    // Conflict 
-    // SQL3CONFLICT_NONE,
-    // SQL3CONFLICT_ROLLBACK,
-    // SQL3CONFLICT_ABORT,
-    // SQL3CONFLICT_FAIL,
-    // SQL3CONFLICT_IGNORE,
-    // SQL3CONFLICT_REPLACE
-    SEXP conflict_levels_ = PROTECT(allocVector(STRSXP, 6)); 
-    SET_STRING_ELT(conflict_levels_, 0, mkChar("none"));
-    SET_STRING_ELT(conflict_levels_, 1, mkChar("rollback"));
-    SET_STRING_ELT(conflict_levels_, 2, mkChar("abort"));
-    SET_STRING_ELT(conflict_levels_, 3, mkChar("fail"));
-    SET_STRING_ELT(conflict_levels_, 4, mkChar("ignore"));
-    SET_STRING_ELT(conflict_levels_, 5, mkChar("replace"));
-    
-    setAttrib(col_conf_pk_      , R_ClassSymbol, mkString("factor"));
-    setAttrib(col_conf_not_null_, R_ClassSymbol, mkString("factor"));
-    setAttrib(col_conf_unique_  , R_ClassSymbol, mkString("factor"));
-    
+  
+    setAttrib(col_conf_pk_      , R_ClassSymbol, factor_class_);
+    setAttrib(col_conf_not_null_, R_ClassSymbol, factor_class_);
+    setAttrib(col_conf_unique_  , R_ClassSymbol, factor_class_);
+  
     setAttrib(col_conf_pk_      , R_LevelsSymbol, conflict_levels_);
     setAttrib(col_conf_not_null_, R_LevelsSymbol, conflict_levels_);
     setAttrib(col_conf_unique_  , R_LevelsSymbol, conflict_levels_);
-    UNPROTECT(1);
   }
   
   SEXP col_check_expr_   = PROTECT(allocVector(STRSXP, N)); nprotect++;
   SEXP col_default_expr_ = PROTECT(allocVector(STRSXP, N)); nprotect++;
   SEXP col_collate_name_ = PROTECT(allocVector(STRSXP, N)); nprotect++;
   
-  SET_VECTOR_ELT(df_,  0, col_names_);
-  SET_VECTOR_ELT(df_,  1, col_types_);
-  SET_VECTOR_ELT(df_,  2, col_lens_);
-  SET_VECTOR_ELT(df_,  3, col_cnames_);
-  SET_VECTOR_ELT(df_,  4, col_comm_);
+  SET_VECTOR_ELT(df_,  0, stmt_id_);
+  SET_VECTOR_ELT(df_,  1, col_names_);
+  SET_VECTOR_ELT(df_,  2, col_types_);
+  SET_VECTOR_ELT(df_,  3, col_lens_);
+  SET_VECTOR_ELT(df_,  4, col_cnames_);
+  SET_VECTOR_ELT(df_,  5, col_comm_);
   
-  SET_VECTOR_ELT(df_,  5, col_primkey_);
-  SET_VECTOR_ELT(df_,  6, col_autoinc_);
-  SET_VECTOR_ELT(df_,  7, col_notnull_);
-  SET_VECTOR_ELT(df_,  8, col_unique_);
+  SET_VECTOR_ELT(df_,  6, col_primkey_);
+  SET_VECTOR_ELT(df_,  7, col_autoinc_);
+  SET_VECTOR_ELT(df_,  8, col_notnull_);
+  SET_VECTOR_ELT(df_,  9, col_unique_);
   
-  SET_VECTOR_ELT(df_,  9, col_order_);
-  SET_VECTOR_ELT(df_, 10, col_conf_pk_);
-  SET_VECTOR_ELT(df_, 11, col_conf_not_null_);
-  SET_VECTOR_ELT(df_, 12, col_conf_unique_);
+  SET_VECTOR_ELT(df_, 10, col_order_);
+  SET_VECTOR_ELT(df_, 11, col_conf_pk_);
+  SET_VECTOR_ELT(df_, 12, col_conf_not_null_);
+  SET_VECTOR_ELT(df_, 13, col_conf_unique_);
   
-  SET_VECTOR_ELT(df_, 13, col_check_expr_);
-  SET_VECTOR_ELT(df_, 14, col_default_expr_);
-  SET_VECTOR_ELT(df_, 15, col_collate_name_);
+  SET_VECTOR_ELT(df_, 14, col_check_expr_);
+  SET_VECTOR_ELT(df_, 15, col_default_expr_);
+  SET_VECTOR_ELT(df_, 16, col_collate_name_);
   
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  // Populate the data.frame columns 
+  // Populate the data.frame columns
   //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  for (int col_idx = 0; col_idx < N; col_idx++) {
-    
-    sql3column *col = sql3table_get_column(table, col_idx);
-    
-    SET_STRING_ELT(col_names_ , col_idx, rchr(sql3column_name(col)));
-    SET_STRING_ELT(col_types_ , col_idx, rchr(sql3column_type(col)));
-    SET_STRING_ELT(col_lens_  , col_idx, rchr(sql3column_length(col)));
-    SET_STRING_ELT(col_cnames_, col_idx, rchr(sql3column_constraint_name(col)));
-    SET_STRING_ELT(col_comm_  , col_idx, rchr(sql3column_comment(col)));
-    
-    LOGICAL(col_primkey_)[col_idx] = sql3column_is_primarykey(col);
-    LOGICAL(col_autoinc_)[col_idx] = sql3column_is_autoincrement(col);
-    LOGICAL(col_notnull_)[col_idx] = sql3column_is_notnull(col);
-    LOGICAL(col_unique_ )[col_idx] = sql3column_is_unique(col);
-    
-    INTEGER(col_order_        )[col_idx] = 1 + sql3column_pk_order(col);
-    INTEGER(col_conf_pk_      )[col_idx] = 1 + sql3column_pk_conflictclause(col);
-    INTEGER(col_conf_not_null_)[col_idx] = 1 + sql3column_notnull_conflictclause(col);
-    INTEGER(col_conf_unique_  )[col_idx] = 1 + sql3column_unique_conflictclause(col);
-    
-    SET_STRING_ELT(col_check_expr_  , col_idx, rchr(sql3column_check_expr(col)));
-    SET_STRING_ELT(col_default_expr_, col_idx, rchr(sql3column_default_expr(col)));
-    SET_STRING_ELT(col_collate_name_, col_idx, rchr(sql3column_collate_name(col)));
+  R_xlen_t col_idx = 0;
+  for (R_xlen_t t = 0; t < ntables; t++) {
+    sql3table *table = tables[t];
+    if (table == NULL) continue;
+  
+    size_t ncols = sql3table_num_columns(table);
+    for (size_t j = 0; j < ncols; j++, col_idx++) {
+      sql3column *col = sql3table_get_column(table, j);
+  
+      INTEGER(stmt_id_)[col_idx] = stmt_ids[t];
+  
+      SET_STRING_ELT(col_names_ , col_idx, rchr(sql3column_name(col)));
+      SET_STRING_ELT(col_types_ , col_idx, rchr(sql3column_type(col)));
+      SET_STRING_ELT(col_lens_  , col_idx, rchr(sql3column_length(col)));
+      SET_STRING_ELT(col_cnames_, col_idx, rchr(sql3column_constraint_name(col)));
+      SET_STRING_ELT(col_comm_  , col_idx, rchr(sql3column_comment(col)));
+  
+      LOGICAL(col_primkey_)[col_idx] = sql3column_is_primarykey(col);
+      LOGICAL(col_autoinc_)[col_idx] = sql3column_is_autoincrement(col);
+      LOGICAL(col_notnull_)[col_idx] = sql3column_is_notnull(col);
+      LOGICAL(col_unique_ )[col_idx] = sql3column_is_unique(col);
+  
+      INTEGER(col_order_        )[col_idx] = 1 + sql3column_pk_order(col);
+      INTEGER(col_conf_pk_      )[col_idx] = 1 + sql3column_pk_conflictclause(col);
+      INTEGER(col_conf_not_null_)[col_idx] = 1 + sql3column_notnull_conflictclause(col);
+      INTEGER(col_conf_unique_  )[col_idx] = 1 + sql3column_unique_conflictclause(col);
+  
+      SET_STRING_ELT(col_check_expr_  , col_idx, rchr(sql3column_check_expr(col)));
+      SET_STRING_ELT(col_default_expr_, col_idx, rchr(sql3column_default_expr(col)));
+      SET_STRING_ELT(col_collate_name_, col_idx, rchr(sql3column_collate_name(col)));
+    }
   }
   
   list_to_df(df_, N);
@@ -504,65 +575,319 @@ SEXP parse_column_info(sql3table *table) {
 
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// Parse CREATE TABLE
+// Message reported in the 'error' column of the tables data.frame
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_error_message(sql3table *table, sql3error_code err) {
+  if (table != NULL) {
+    return NA_STRING;
+  }
+  
+  switch (err) {
+  case SQL3ERROR_SYNTAX        : return STRING_ELT(error_messages_, 0);
+  case SQL3ERROR_UNSUPPORTEDSQL: return STRING_ELT(error_messages_, 1);
+  case SQL3ERROR_MEMORY        : return STRING_ELT(error_messages_, 2);
+  default                      : return STRING_ELT(error_messages_, 3);
+  }
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Parse table level information of all tables into a long data.frame
+// with one row per statement
 //
-// @param sql_ an sqlite3 "CREATE TABLE" statement
-// @return named list of information about the table
+// @param errors parse error for each statement. May be NULL if every
+//        table is non-NULL
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-SEXP parse_(SEXP sql_) {
+SEXP parse_table_info(sql3table **tables, const int *stmt_ids, const sql3error_code *errors, R_xlen_t ntables) {
   
   unsigned int nprotect = 0;
-  sql3error_code err;
-  sql3table *table = sql3parse_table(CHAR(asChar(sql_)), 0, &err);
+  R_xlen_t N = ntables;
+  
+  SEXP df_ = PROTECT(allocVector(VECSXP, 11)); nprotect++;
+  setAttrib(df_, R_NamesSymbol, tables_names_);
+  
+  SEXP stmt_id_       = PROTECT(allocVector(INTSXP, N)); nprotect++;
+  SEXP name_          = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP schema_        = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP comment_       = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP temporary_     = PROTECT(allocVector(LGLSXP, N)); nprotect++;
+  SEXP if_not_exists_ = PROTECT(allocVector(LGLSXP, N)); nprotect++;
+  SEXP without_rowid_ = PROTECT(allocVector(LGLSXP, N)); nprotect++;
+  SEXP type_          = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP current_name_  = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP new_name_      = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  SEXP error_         = PROTECT(allocVector(STRSXP, N)); nprotect++;
+  
+  SET_VECTOR_ELT(df_,  0, stmt_id_);
+  SET_VECTOR_ELT(df_,  1, name_);
+  SET_VECTOR_ELT(df_,  2, schema_);
+  SET_VECTOR_ELT(df_,  3, comment_);
+  SET_VECTOR_ELT(df_,  4, temporary_);
+  SET_VECTOR_ELT(df_,  5, if_not_exists_);
+  SET_VECTOR_ELT(df_,  6, without_rowid_);
+  SET_VECTOR_ELT(df_,  7, type_);
+  SET_VECTOR_ELT(df_,  8, current_name_);
+  SET_VECTOR_ELT(df_,  9, new_name_);
+  SET_VECTOR_ELT(df_, 10, error_);
+  
+  for (R_xlen_t i = 0; i < N; i++) {
+    sql3table *table = tables[i];
+    INTEGER(stmt_id_)[i] = stmt_ids[i];
+    SET_STRING_ELT(error_, i, parse_error_message(table, errors ? errors[i] : SQL3ERROR_NONE));
+  
+    if (table == NULL) {
+      SET_STRING_ELT(name_        , i, NA_STRING);
+      SET_STRING_ELT(schema_      , i, NA_STRING);
+      SET_STRING_ELT(comment_     , i, NA_STRING);
+      LOGICAL(temporary_    )[i] = NA_LOGICAL;
+      LOGICAL(if_not_exists_)[i] = NA_LOGICAL;
+      LOGICAL(without_rowid_)[i] = NA_LOGICAL;
+      SET_STRING_ELT(type_        , i, NA_STRING);
+      SET_STRING_ELT(current_name_, i, NA_STRING);
+      SET_STRING_ELT(new_name_    , i, NA_STRING);
+      continue;
+    }
   
-  if (table == NULL) {
-    error("Couldn't parse CREATE TABLE from given sql");
+    SET_STRING_ELT(name_   , i, rchr(sql3table_name   (table)));
+    SET_STRING_ELT(schema_ , i, rchr(sql3table_schema (table)));
+    SET_STRING_ELT(comment_, i, rchr(sql3table_comment(table)));
+    LOGICAL(temporary_    )[i] = sql3table_is_temporary(table);
+    LOGICAL(if_not_exists_)[i] = sql3table_is_ifnotexists(table);
+    LOGICAL(without_rowid_)[i] = sql3table_is_withoutrowid(table);
+    SET_STRING_ELT(type_        , i, STRING_ELT(table_types_, sql3table_type(table)));
+    SET_STRING_ELT(current_name_, i, rchr(sql3table_current_name(table)));
+    SET_STRING_ELT(new_name_    , i, rchr(sql3table_new_name(table)));
   }
   
-  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  // Assemble 'table_info' list
-  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-  static char *types[] = {
-    "unknown",
-    "table",
-    "rename table",
-    "rename column",
-    "add column",
-    "drop column"
-  };
+  list_to_df(df_, N);
   
-  SEXP table_info_  = PROTECT(allocVector(VECSXP, 11)); nprotect++;
-  SEXP table_names_ = PROTECT(allocVector(STRSXP, 11)); nprotect++;
-  SET_STRING_ELT(table_names_,  0, mkChar("name"));  
-  SET_STRING_ELT(table_names_,  1, mkChar("schema"));
-  SET_STRING_ELT(table_names_,  2, mkChar("comment"));
-  SET_STRING_ELT(table_names_,  3, mkChar("temporary"));
-  SET_STRING_ELT(table_names_,  4, mkChar("if_not_exists"));
-  SET_STRING_ELT(table_names_,  5, mkChar("without_rowid"));
-  SET_STRING_ELT(table_names_,  6, mkChar("columns"));
-  SET_STRING_ELT(table_names_,  7, mkChar("constraints"));
-  SET_STRING_ELT(table_names_,  8, mkChar("type"));
-  SET_STRING_ELT(table_names_,  9, mkChar("current_name"));
-  SET_STRING_ELT(table_names_, 10, mkChar("new_name"));
-  setAttrib(table_info_, R_NamesSymbol, table_names_);
-  
-  SET_VECTOR_ELT(table_info_,  0, rstr(sql3table_name  (table)));
-  SET_VECTOR_ELT(table_info_,  1, rstr(sql3table_schema(table)));
-  SET_VECTOR_ELT(table_info_,  2, rstr(sql3table_comment(table)));
-  SET_VECTOR_ELT(table_info_,  3, ScalarLogical(sql3table_is_temporary(table)));
-  SET_VECTOR_ELT(table_info_,  4, ScalarLogical(sql3table_is_ifnotexists(table)));
-  SET_VECTOR_ELT(table_info_,  5, ScalarLogical(sql3table_is_withoutrowid(table)));
-  SET_VECTOR_ELT(table_info_,  6, parse_column_info(table));
-  SET_VECTOR_ELT(table_info_,  7, parse_table_constraints(table));
-  SET_VECTOR_ELT(table_info_,  8, mkString(types[sql3table_type(table)]));
-  SET_VECTOR_ELT(table_info_,  9, rstr(sql3table_current_name(table)));
-  SET_VECTOR_ELT(table_info_, 10, rstr(sql3table_new_name(table)));
-  
-  
-  sql3table_free(table);
   UNPROTECT(nprotect);
-  return table_info_;
+  return df_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Assemble the list of 'tables', 'columns' and 'constraints' data.frames
+// for a batch of parsed statements. In 'flat' mode the flat 'idx_cols' and
+// 'fk_cols' tables are appended
+//
+// @param keep_ if not NULL the 'columns' data.frame is made of lazy vectors
+//        which read from the parsed tables. 'keep_' must hold everything
+//        the tables point into and is kept alive by those vectors
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_result(sql3table **tables, const int *stmt_ids, const sql3error_code *errors, R_xlen_t ntables, bool flat, SEXP keep_) {
+  
+  unsigned int nprotect = 0;
+  
+  SEXP res_ = PROTECT(allocVector(VECSXP, flat ? 5 : 3)); nprotect++;
+  setAttrib(res_, R_NamesSymbol, flat ? flat_result_names_ : result_names_);
+  
+  SET_VECTOR_ELT(res_, 0, parse_table_info       (tables, stmt_ids, errors, ntables));
+  if (keep_ == R_NilValue) {
+    SET_VECTOR_ELT(res_, 1, parse_column_info    (tables, stmt_ids, ntables));
+  } else {
+    SET_VECTOR_ELT(res_, 1, parse_column_info_lazy(tables, stmt_ids, ntables, keep_));
+  }
+  SET_VECTOR_ELT(res_, 2, parse_table_constraints(tables, stmt_ids, ntables, flat));
+  if (flat) {
+    SET_VECTOR_ELT(res_, 3, parse_flat_idx_cols(tables, ntables));
+    SET_VECTOR_ELT(res_, 4, parse_flat_fk_cols (tables, ntables));
+  }
+  
+  UNPROTECT(nprotect);
+  return res_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Convert the 'fields' argument to the SQL3FIELD_* flags of the parser.
+// 'types' and 'column_constraints' are details of the columns so they 
+// bring the column names along
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+unsigned parse_fields(SEXP fields_) {
+  static const struct {
+    const char *name;
+    unsigned    flags;
+  } field_names[] = {
+    {"all"               , SQL3FIELD_ALL},
+    {"columns"           , SQL3FIELD_COLUMNS},
+    {"types"             , SQL3FIELD_COLUMNS | SQL3FIELD_TYPES},
+    {"column_constraints", SQL3FIELD_COLUMNS | SQL3FIELD_COLUMN_CONSTRAINTS},
+    {"constraints"       , SQL3FIELD_TABLE_CONSTRAINTS},
+    {"foreign_keys"      , SQL3FIELD_FOREIGNKEYS},
+    {"comments"          , SQL3FIELD_COMMENTS}
+  };
+  int nnames = (int)(sizeof(field_names) / sizeof(field_names[0]));
+  
+  if (!isString(fields_)) {
+    error("'fields' must be a character vector");
+  }
+  
+  unsigned fields = 0;
+  for (R_xlen_t i = 0; i < xlength(fields_); i++) {
+    SEXP field_ = STRING_ELT(fields_, i);
+    int j = 0;
+    while (j < nnames && (field_ == NA_STRING || strcmp(CHAR(field_), field_names[j].name) != 0)) j++;
+    if (j == nnames) {
+      error("Unknown field '%s'. Must be one of: all, columns, types, column_constraints, constraints, foreign_keys, comments", 
+            field_ == NA_STRING ? "NA" : CHAR(field_));
+    }
+    fields |= field_names[j].flags;
+  }
+  
+  return fields;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Finalizer for a parser wrapped in an external pointer.
+// The parser is normally released explicitly at the end of the .Call, this
+// only catches the case where an R error longjmps out of the conversion
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+static void parser_finalizer(SEXP parser_) {
+  sql3parser *parser = (sql3parser *)R_ExternalPtrAddr(parser_);
+  if (parser != NULL) {
+    sql3parser_free(parser);
+    R_ClearExternalPtr(parser_);
+  }
 }
 
 
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Create a parser owned by an external pointer, so it is released even
+// if the caller is interrupted by an R error
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parser_create(void) {
+  sql3parser *parser = sql3parser_create();
+  if (parser == NULL) {
+    error("Couldn't allocate the sql parser");
+  }
+  
+  SEXP parser_ = PROTECT(R_MakeExternalPtr(parser, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(parser_, parser_finalizer, FALSE);
+  UNPROTECT(1);
+  return parser_;
+}
+
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Release the parser (and every table it returned) as soon as the R
+// objects have been built rather than waiting for the garbage collector
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+void parser_release(SEXP parser_) {
+  parser_finalizer(parser_);
+}
+
 
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Parse CREATE TABLE statements
+//
+// The statements are parsed on a pool of 'threads' workers, each with its 
+// own parser. R API calls are not thread-safe so the CHAR pointers are 
+// gathered up front and all R objects are created afterwards on the main 
+// thread, in input order. The tables stay alive inside the parser arenas 
+// so the R vectors can be sized exactly before they are filled
+//
+// Only the requested 'fields' are extracted. Everything else is skipped
+// over by the parser and reported as NA/FALSE/'none' (or no rows)
+//
+// With 'lazy' the parsers are not released at the end of the call. They are
+// kept alive, together with the input strings, by the lazy vectors of the
+// 'columns' data.frame
+//
+// @param sql_ character vector of sqlite3 "CREATE TABLE" statements
+// @param threads_ number of threads to use
+// @param flat_ return flat 'idx_cols' and 'fk_cols' tables instead of list columns
+// @param lazy_ return a 'columns' data.frame of lazy vectors
+// @param fields_ character vector of the fields to extract
+// @return named list of 'tables', 'columns' and 'constraints' data.frames
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+SEXP parse_(SEXP sql_, SEXP threads_, SEXP flat_, SEXP lazy_, SEXP fields_) {
+  
+  unsigned int nprotect = 0;
+  
+  if (!isString(sql_)) {
+    error("'sql' must be a character vector");
+  }
+  
+  R_xlen_t N = xlength(sql_);
+  int nthreads = asInteger(threads_);
+  if (nthreads == NA_INTEGER || nthreads < 1) {
+    error("'threads' must be a positive integer");
+  }
+  int flat = asLogical(flat_);
+  if (flat == NA_LOGICAL) {
+    error("'flat' must be TRUE or FALSE");
+  }
+  int lazy = asLogical(lazy_);
+  if (lazy == NA_LOGICAL) {
+    error("'lazy' must be TRUE or FALSE");
+  }
+  unsigned fields = parse_fields(fields_);
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // One parser per thread
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  SEXP parsers_ = PROTECT(allocVector(VECSXP, nthreads)); nprotect++;
+  sql3parser **parsers = (sql3parser **)R_alloc(nthreads, sizeof(sql3parser *));
+  for (int i = 0; i < nthreads; i++) {
+    SET_VECTOR_ELT(parsers_, i, parser_create());
+    parsers[i] = (sql3parser *)R_ExternalPtrAddr(VECTOR_ELT(parsers_, i));
+    sql3parser_set_fields(parsers[i], fields);
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Gather the statements on the main thread
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  const char    **sql      = (const char **)   R_alloc(N, sizeof(const char *));
+  size_t         *len      = (size_t *)        R_alloc(N, sizeof(size_t));
+  sql3table     **tables   = (sql3table **)    R_alloc(N, sizeof(sql3table *));
+  sql3error_code *errors   = (sql3error_code *)R_alloc(N, sizeof(sql3error_code));
+  int            *stmt_ids = (int *)           R_alloc(N, sizeof(int));
+  
+  // lazy results outlive this call so translated input can't live in R_alloc() memory
+  SEXP utf8_ = PROTECT(allocVector(STRSXP, lazy ? N : 0)); nprotect++;
+  
+  for (R_xlen_t i = 0; i < N; i++) {
+    SEXP sql_elt_ = STRING_ELT(sql_, i);
+    stmt_ids[i] = (int)(i + 1);
+    
+    if (sql_elt_ == NA_STRING || LENGTH(sql_elt_) == 0) {
+      sql[i] = NULL;
+      len[i] = 0;
+    } else {
+      sql[i] = sql_utf8(sql_elt_, &len[i]);
+      if (lazy && sql[i] != CHAR(sql_elt_)) {
+        SET_STRING_ELT(utf8_, i, mkCharLenCE(sql[i], (int)len[i], CE_UTF8));
+        sql[i] = CHAR(STRING_ELT(utf8_, i));
+      }
+    }
+  }
+  
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Parse. No R API calls are allowed until all workers have finished
+  //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  sql3parse_batch(parsers, (size_t)nthreads, sql, len, (size_t)N, tables, errors);
+  
+  for (R_xlen_t i = 0; i < N; i++) {
+    if (errors[i] == SQL3ERROR_MEMORY) {
+      for (int j = 0; j < nthreads; j++) parser_release(VECTOR_ELT(parsers_, j));
+      error("Out of memory while parsing sql");
+    }
+  }
+  
+  if (lazy) {
+    SEXP keep_ = PROTECT(list3(sql_, utf8_, parsers_)); nprotect++;
+    SEXP res_  = PROTECT(parse_result(tables, stmt_ids, errors, N, flat, keep_)); nprotect++;
+    UNPROTECT(nprotect);
+    return res_;
+  }
+  
+  SEXP res_ = PROTECT(parse_result(tables, stmt_ids, errors, N, flat, R_NilValue)); nprotect++;
+  
+  for (int i = 0; i < nthreads; i++) {
+    parser_release(VECTOR_ELT(parsers_, i));
+  }
+  UNPROTECT(nprotect);
+  return res_;
+}
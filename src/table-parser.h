@@ -0,0 +1,26 @@
+#ifndef TABLE_PARSER_H
+#define TABLE_PARSER_H
+
+#include <R.h>
+#include <Rinternals.h>
+#include <stdbool.h>
+
+#include "sql3parse_table.h"
+
+SEXP rstr(sql3string str);
+SEXP rchr(sql3string str);
+const char *sql_utf8(SEXP chr_, size_t *len);
+void list_to_df(SEXP list_, unsigned int nrows);
+
+unsigned parse_fields(SEXP fields_);
+
+SEXP parser_create(void);
+void parser_release(SEXP parser_);
+
+SEXP parse_error_message(sql3table *table, sql3error_code err);
+SEXP parse_result(sql3table **tables, const int *stmt_ids, const sql3error_code *errors, R_xlen_t ntables, bool flat, SEXP keep_);
+
+void init_lazy_columns(DllInfo *dll);
+SEXP parse_column_info_lazy(sql3table **tables, const int *stmt_ids, R_xlen_t ntables, SEXP keep_);
+
+#endif
@@ -0,0 +1,58 @@
+CREATE TABLE t1 (a, b, c);
+CREATE TABLE t2 (id INTEGER PRIMARY KEY, name TEXT NOT NULL, score REAL DEFAULT 0.5);
+create table lower_case (x integer primary key autoincrement, y text unique);
+CrEaTe TaBlE MiXeD (Id InTeGeR PrImArY kEy DeSc, VaL tExT cOlLaTe NoCaSe);
+CREATE TEMP TABLE tmp1 (a INT);
+CREATE TEMPORARY TABLE IF NOT EXISTS tmp2 (a INT, b BLOB);
+CREATE TABLE IF NOT EXISTS main.schema_qualified (a TEXT);
+CREATE TABLE "quoted table" ("quoted column" TEXT, "second column" INT);
+CREATE TABLE `backticks` (`col one` INTEGER, `col two` TEXT);
+CREATE TABLE [brackets] ([col one] INTEGER, [col two] TEXT);
+CREATE TABLE 'single quoted' ('a' INT);
+CREATE TABLE types (a VARCHAR(20), b NUMERIC(10, 2), c DOUBLE PRECISION, d UNSIGNED BIG INT, e NATIVE CHARACTER(70), f DECIMAL(10,5));
+CREATE TABLE wr (k TEXT PRIMARY KEY, v BLOB) WITHOUT ROWID;
+CREATE TABLE strict_table (a INTEGER, b TEXT, c ANY) STRICT;
+CREATE TABLE both_options (a INTEGER PRIMARY KEY, b TEXT) STRICT, WITHOUT ROWID;
+CREATE TABLE pk_conflict (a INTEGER PRIMARY KEY ASC ON CONFLICT ROLLBACK, b INT NOT NULL ON CONFLICT ABORT, c INT UNIQUE ON CONFLICT FAIL);
+CREATE TABLE conflicts2 (a INT PRIMARY KEY ON CONFLICT IGNORE, b INT UNIQUE ON CONFLICT REPLACE);
+CREATE TABLE checks (a INT CHECK (a > 0), b INT CHECK (b BETWEEN 1 AND 10 AND (b % 2) = 0), CHECK (a < b));
+CREATE TABLE defaults (a INT DEFAULT 1, b INT DEFAULT -1, c REAL DEFAULT +2.5, d TEXT DEFAULT 'it''s', e TEXT DEFAULT "dq", f INT DEFAULT (1 + 2), g TEXT DEFAULT CURRENT_TIMESTAMP, h BLOB DEFAULT x'0102', i INT DEFAULT NULL, j INT DEFAULT TRUE);
+CREATE TABLE collations (a TEXT COLLATE NOCASE, b TEXT COLLATE BINARY, c TEXT COLLATE RTRIM NOT NULL);
+CREATE TABLE named (a INT CONSTRAINT pk PRIMARY KEY, b INT CONSTRAINT nn NOT NULL, CONSTRAINT u1 UNIQUE (a, b), CONSTRAINT ck CHECK (a <> b));
+CREATE TABLE child (id INTEGER PRIMARY KEY, parent_id INTEGER REFERENCES parent(id) ON DELETE CASCADE ON UPDATE SET NULL);
+CREATE TABLE child2 (a INT, b INT, FOREIGN KEY (a, b) REFERENCES parent2 (x, y) ON DELETE SET DEFAULT ON UPDATE RESTRICT MATCH FULL DEFERRABLE INITIALLY DEFERRED);
+CREATE TABLE child3 (a INT REFERENCES p3 NOT DEFERRABLE INITIALLY IMMEDIATE, b INT REFERENCES p4 (z) ON DELETE NO ACTION DEFERRABLE);
+CREATE TABLE child4 (a INT, CONSTRAINT fk1 FOREIGN KEY (a) REFERENCES p5 (b) NOT DEFERRABLE, CONSTRAINT fk2 FOREIGN KEY (a) REFERENCES p6 DEFERRABLE INITIALLY IMMEDIATE);
+CREATE TABLE multi_pk (a TEXT, b TEXT, c INT, PRIMARY KEY (a COLLATE NOCASE ASC, b DESC, c));
+CREATE TABLE multi_unique (a TEXT, b TEXT, UNIQUE (a, b) ON CONFLICT REPLACE, UNIQUE (b));
+CREATE TABLE generated (a INT, b INT GENERATED ALWAYS AS (a * 2) STORED, c INT AS (a + 1) VIRTUAL, d INT AS (a - 1));
+CREATE TABLE no_types (a, b, c PRIMARY KEY, d UNIQUE, e NOT NULL);
+CREATE TABLE /* table comment */ commented (a INT /* comment a */, b TEXT /* comment b */);
+CREATE TABLE spaces	(	a	INT	,	b	TEXT	);
+CREATE TABLE keyword_like (tab INT, tables TEXT, primary_key INT, "key" TEXT, "order" INT, "select" TEXT, uniqueness INT, notnull_flag INT);
+CREATE TABLE long_check (a INT CHECK (a IN (1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32)), b TEXT DEFAULT 'a long default literal that spans well over sixty four bytes of text, to cross a block');
+CREATE TABLE nested_parens (a INT CHECK ((a > 0) AND ((a < 10) OR (a = 100))), b INT DEFAULT ((1)));
+CREATE TABLE check_strings (a TEXT CHECK (a IN ('x)', '(y', 'z''s')));
+CREATE TABLE autoinc (id INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL UNIQUE);
+CREATE TABLE many_constraints (a INT PRIMARY KEY NOT NULL UNIQUE CHECK (a > 0) DEFAULT 1 COLLATE BINARY REFERENCES other (x));
+CREATE TABLE trailing_comma_free (a INT, b INT, c INT, d INT, e INT, f INT, g INT, h INT, i INT, j INT, k INT, l INT);
+CREATE TABLE IF NOT EXISTS "main"."quoted schema" (a INT);
+ALTER TABLE t1 RENAME TO t1_renamed;
+ALTER TABLE main.t1 RENAME COLUMN a TO a2;
+ALTER TABLE t1 RENAME a TO a3;
+ALTER TABLE t1 ADD COLUMN d TEXT NOT NULL DEFAULT 'x';
+ALTER TABLE t1 ADD e INTEGER REFERENCES t2 (id);
+ALTER TABLE t1 DROP COLUMN b;
+ALTER TABLE t1 DROP c;
+CREATE TABLE syntax_error (a INT,;
+CREATE TABLE missing_paren (a INT, b TEXT;
+CREATE TABLE bad_constraint (a INT, PRIMARY (a));
+CREATE TABLE (a INT);
+CREATE TABLE as_select AS SELECT 1;
+CREATE INDEX idx ON t1 (a);
+CREATE VIEW v AS SELECT 1;
+SELECT * FROM t1;
+DROP TABLE t1;
+ALTER TABLE t1 SOMETHING;
+CREATE TABLE unterminated_check (a INT CHECK (a > 0);
+CREATE TABLE t_final (z INTEGER PRIMARY KEY DESC ON CONFLICT REPLACE AUTOINCREMENT, y TEXT NOT NULL ON CONFLICT IGNORE COLLATE NOCASE DEFAULT 'y');
@@ -0,0 +1,104 @@
+# Write the SQLite databases used by the tests. Run from this directory:
+#
+#   python3 make-databases.py
+#
+# The expected values in the tests were read from these files with sqlite.
+import os
+import shutil
+import sqlite3
+
+
+def remove(*paths):
+    for path in paths:
+        for suffix in ("", "-wal", "-shm", "-journal"):
+            if os.path.exists(path + suffix):
+                os.remove(path + suffix)
+
+
+def connect(path, page_size=1024, encoding=None):
+    remove(path)
+    con = sqlite3.connect(path, isolation_level=None)
+    con.execute(f"PRAGMA page_size = {page_size}")
+    if encoding:
+        con.execute(f"PRAGMA encoding = '{encoding}'")
+    return con
+
+
+# rollback journal: WITHOUT ROWID, overflow pages, ALTER TABLE ADD COLUMN,
+# values which don't fit the declared type
+con = connect("rollback.sqlite")
+con.executescript("""
+CREATE TABLE people (id INTEGER PRIMARY KEY, name TEXT NOT NULL, score REAL, age INTEGER, note, data BLOB);
+CREATE INDEX people_name ON people (name);
+CREATE TABLE "order items" ("order" INTEGER, item TEXT, qty NUMERIC DEFAULT 1, PRIMARY KEY ("order", item));
+CREATE TABLE kv (k TEXT PRIMARY KEY, v INTEGER) WITHOUT ROWID;
+CREATE TABLE nums (i INTEGER, n NUMERIC, t TEXT);
+CREATE TABLE big (id INTEGER PRIMARY KEY, body TEXT);
+CREATE VIEW adults AS SELECT * FROM people WHERE age >= 18;
+CREATE TRIGGER people_ai AFTER INSERT ON people BEGIN SELECT 1; END;
+
+INSERT INTO people VALUES (1, 'Ann', 1.5, 30, NULL, x'00ff');
+INSERT INTO people VALUES (2, 'Bob', NULL, 17, 'n', NULL);
+INSERT INTO people VALUES (3, 'Zoë', -2.25, NULL, 42, x'');
+ALTER TABLE people ADD COLUMN extra TEXT DEFAULT 'none';
+INSERT INTO people VALUES (5, 'Eve', 3, 65, 'text', NULL, 'set');
+
+INSERT INTO "order items" VALUES (2, 'y', 3), (1, 'x', 1.5);
+INSERT INTO kv VALUES ('b', 2), ('a', 1), ('c', NULL);
+INSERT INTO nums VALUES (1, 2.5, 'a'), (3000000000, 1, 2), (-7, NULL, x'cafe');
+""")
+con.execute("INSERT INTO big VALUES (1, ?), (2, ?)", ("a" * 3000, "é" * 10000))
+con.close()
+
+
+# UTF-16 text in both byte orders, overflowing in the little endian one
+for encoding, path in (("UTF-16le", "utf16le.sqlite"), ("UTF-16be", "utf16be.sqlite")):
+    con = connect(path, encoding=encoding)
+    con.execute('CREATE TABLE "naïve" (id INTEGER PRIMARY KEY, "名前" TEXT, v)')
+    con.execute('INSERT INTO "naïve" VALUES (1, \'Zoë\', 1), (2, \'日本語\', \'ü\')')
+    if encoding == "UTF-16le":
+        con.execute('INSERT INTO "naïve" VALUES (3, ?, NULL)', ("ü" * 2000,))
+    con.close()
+
+
+# storage: b-trees of several levels, overflow pages, automatic indexes
+con = connect("storage.sqlite")
+con.executescript("""
+CREATE TABLE log (id INTEGER PRIMARY KEY, level TEXT NOT NULL, msg TEXT);
+CREATE INDEX log_level ON log (level, id);
+CREATE TABLE tags (tag TEXT PRIMARY KEY, n INTEGER) WITHOUT ROWID;
+CREATE TABLE pairs (a INTEGER CHECK (a > 0), b TEXT, UNIQUE (a, b));
+""")
+con.execute("BEGIN")
+con.executemany("INSERT INTO log VALUES (?, ?, ?)", [(i, ("info", "warn", "error")[i % 3], "m" * (i % 50)) for i in range(1, 501)])
+con.executemany("INSERT INTO log VALUES (?, 'error', ?)", [(1000, "o" * 3000), (1001, "p" * 5000)])
+con.executemany("INSERT INTO tags VALUES (?, ?)", [(f"tag {i:04d} " + "t" * 20, i) for i in range(300)])
+con.executemany("INSERT INTO pairs VALUES (?, ?)", [(i, str(i * i)) for i in range(1, 51)])
+con.execute("COMMIT")
+con.close()
+
+
+# WAL mode: the database file holds table t1 only. The -wal file holds the
+# committed creation of t2 and more rows of t1, followed by the uncommitted
+# frames of a transaction creating t3
+con = connect("wal-src.sqlite")
+con.execute("PRAGMA journal_mode = WAL")
+con.execute("CREATE TABLE t1 (a INTEGER PRIMARY KEY, b TEXT)")
+con.executemany("INSERT INTO t1 VALUES (?, ?)", [(i, f"row {i}") for i in range(1, 11)])
+con.execute("PRAGMA wal_checkpoint(TRUNCATE)")
+con.execute("PRAGMA wal_autocheckpoint = 0")
+con.execute("CREATE TABLE t2 (c REAL)")
+con.execute("INSERT INTO t2 VALUES (0.5)")
+con.executemany("INSERT INTO t1 VALUES (?, ?)", [(i, f"row {i}") for i in range(11, 21)])
+
+writer = sqlite3.connect("wal-src.sqlite", isolation_level=None)
+writer.execute("PRAGMA cache_size = 1")
+writer.execute("BEGIN")
+writer.execute("CREATE TABLE t3 (d)")
+writer.executemany("INSERT INTO t1 VALUES (?, ?)", [(i, "x" * 200) for i in range(21, 201)])
+shutil.copy("wal-src.sqlite", "wal.sqlite")
+shutil.copy("wal-src.sqlite-wal", "wal.sqlite-wal")
+writer.execute("ROLLBACK")
+writer.close()
+con.close()
+remove("wal-src.sqlite")
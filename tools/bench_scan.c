@@ -0,0 +1,74 @@
+//
+//  bench_scan.c
+//
+//  Measures sql3parse_table throughput on a comment-heavy corpus with each
+//  sql3scan implementation (scalar, SSE2 and AVX2 when the CPU supports them).
+//
+//      cc -O2 -Isrc -o bench_scan tools/bench_scan.c src/sql3parse_table.c src/sql3scan.c src/sql3split.c src/sql3pool.c -pthread
+//      ./bench_scan [repetitions]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sql3parse_table.h"
+#include "sql3scan.h"
+
+static const char *level_name[] = {"scalar", "sse2", "avx2"};
+
+static size_t append (char *buffer, size_t offset, const char *s) {
+	size_t n = strlen(s);
+	memcpy(buffer + offset, s, n);
+	return offset + n;
+}
+
+static char *make_corpus (size_t ncolumns, size_t *length) {
+	char *buffer = malloc(ncolumns * 1024 + 4096);
+	char line[1024];
+	size_t n = 0;
+
+	n = append(buffer, n, "CREATE TABLE audit_log (\n");
+	for (size_t i = 0; i < ncolumns; ++i) {
+		// banner comment, long quoted default and a nested check expression per column
+		n = append(buffer, n, "    /*****************************************************************\n"
+							  "     * generated column, see the data dictionary for the definition  *\n"
+							  "     *****************************************************************/\n");
+		snprintf(line, sizeof(line), "    \"attribute %zu\" TEXT DEFAULT 'lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor' "
+									 "CHECK ((length(\"attribute %zu\") > 0) AND ((substr(\"attribute %zu\", 1, 1) != ' '))), -- trailing note for this column\n", i, i, i);
+		n = append(buffer, n, line);
+	}
+	n = append(buffer, n, "    id INTEGER PRIMARY KEY\n);\n");
+
+	*length = n;
+	return buffer;
+}
+
+int main (int argc, char *argv[]) {
+	int reps = (argc > 1) ? atoi(argv[1]) : 200;
+	size_t length;
+	char *sql = make_corpus(500, &length);
+
+	for (int level = SQL3SCAN_SCALAR; level <= SQL3SCAN_AVX2; ++level) {
+		if (sql3scan_select((sql3scan_level)level) != level) continue;
+
+		struct timespec t0, t1;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for (int i = 0; i < reps; ++i) {
+			sql3error_code err;
+			sql3table *table = sql3parse_table(sql, length, &err);
+			if (!table) {
+				fprintf(stderr, "parse error %d\n", err);
+				return EXIT_FAILURE;
+			}
+			sql3table_free(table);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+		printf("%-8s %8.1f MB/s\n", level_name[level], (double)length * reps / secs / 1e6);
+	}
+
+	free(sql);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+//
+//  mkkeywordhash.c
+//
+//  Generates src/sql3keywordhash.h, the perfect hash used by sql3lexer_keyword.
+//
+//  To add a keyword: add its TOK_ value to sql3token_t in sql3parse_table.c,
+//  append it to the keywords array below and regenerate the header with:
+//
+//      cc -o mkkeywordhash tools/mkkeywordhash.c
+//      ./mkkeywordhash > src/sql3keywordhash.h
+//
+//  The hash combines the first two bytes, the last byte and the length of the
+//  case-folded keyword. The generator searches for multipliers that map every
+//  keyword to a distinct slot, so a lookup is one table read followed by a
+//  single fixed-width compare.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define KEYWORD_WIDTH       16      // fixed compare width (longest keyword must be shorter)
+#define MAX_SLOTS           256     // largest table the search is allowed to use
+#define MAX_MULTIPLIER      64      // search range for the multipliers
+
+typedef struct {
+	const char  *name;              // lowercase keyword
+	const char  *token;             // sql3token_t returned for the keyword
+} keyword;
+
+static const keyword keywords[] = {
+	{"if", "TOK_IF"},
+	{"on", "TOK_ON"},
+	{"no", "TOK_NO"},
+	{"as", "TOK_AS"},
+	{"to", "TOK_TO"},
+	{"not", "TOK_NOT"},
+	{"key", "TOK_KEY"},
+	{"asc", "TOK_ASC"},
+	{"set", "TOK_SET"},
+	{"add", "TOK_ADD"},
+	{"temp", "TOK_TEMP"},
+	{"desc", "TOK_DESC"},
+	{"null", "TOK_NULL"},
+	{"fail", "TOK_FAIL"},
+	{"drop", "TOK_DROP"},
+	{"table", "TOK_TABLE"},
+	{"rowid", "TOK_ROWID"},
+	{"check", "TOK_CHECK"},
+	{"abort", "TOK_ABORT"},
+	{"match", "TOK_MATCH"},
+	{"alter", "TOK_ALTER"},
+	{"create", "TOK_CREATE"},
+	{"exists", "TOK_EXISTS"},
+	{"unique", "TOK_UNIQUE"},
+	{"ignore", "TOK_IGNORE"},
+	{"delete", "TOK_DELETE"},
+	{"update", "TOK_UPDATE"},
+	{"action", "TOK_ACTION"},
+	{"strict", "TOK_STRICT"},
+	{"rename", "TOK_RENAME"},
+	{"column", "TOK_COLUMN"},
+	{"without", "TOK_WITHOUT"},
+	{"primary", "TOK_PRIMARY"},
+	{"default", "TOK_DEFAULT"},
+	{"collate", "TOK_COLLATE"},
+	{"replace", "TOK_REPLACE"},
+	{"cascade", "TOK_CASCADE"},
+	{"foreign", "TOK_FOREIGN"},
+	{"conflict", "TOK_CONFLICT"},
+	{"rollback", "TOK_ROLLBACK"},
+	{"restrict", "TOK_RESTRICT"},
+	{"deferred", "TOK_DEFERRED"},
+	{"temporary", "TOK_TEMP"},
+	{"initially", "TOK_INITIALLY"},
+	{"immediate", "TOK_IMMEDIATE"},
+	{"constraint", "TOK_CONSTRAINT"},
+	{"references", "TOK_REFERENCES"},
+	{"deferrable", "TOK_DEFERRABLE"},
+	{"autoincrement", "TOK_AUTOINCREMENT"}
+};
+
+#define NUM_KEYWORDS        (sizeof(keywords) / sizeof(keywords[0]))
+
+static unsigned hash (const char *s, unsigned a, unsigned b, unsigned c, unsigned d, unsigned mask) {
+	size_t n = strlen(s);
+	return ((unsigned char)s[0]*a + (unsigned char)s[1]*b + (unsigned char)s[n-1]*c + (unsigned)n*d) & mask;
+}
+
+static int search (unsigned *a, unsigned *b, unsigned *c, unsigned *d, unsigned *size) {
+	for (*size = 32; *size <= MAX_SLOTS; *size *= 2) {
+		if (*size < NUM_KEYWORDS) continue;
+		for (*a = 1; *a < MAX_MULTIPLIER; ++*a) {
+			for (*b = 0; *b < MAX_MULTIPLIER; ++*b) {
+				for (*c = 1; *c < MAX_MULTIPLIER; ++*c) {
+					for (*d = 0; *d < 8; ++*d) {
+						unsigned char used[MAX_SLOTS] = {0};
+						size_t i = 0;
+						for (; i < NUM_KEYWORDS; ++i) {
+							unsigned h = hash(keywords[i].name, *a, *b, *c, *d, *size - 1);
+							if (used[h]) break;
+							used[h] = 1;
+						}
+						if (i == NUM_KEYWORDS) return 1;
+					}
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+int main (void) {
+	size_t maxlen = 0;
+	for (size_t i = 0; i < NUM_KEYWORDS; ++i) {
+		size_t n = strlen(keywords[i].name);
+		if (n < 2 || n >= KEYWORD_WIDTH) {
+			fprintf(stderr, "keyword '%s' must have between 2 and %d bytes\n", keywords[i].name, KEYWORD_WIDTH - 1);
+			return EXIT_FAILURE;
+		}
+		if (n > maxlen) maxlen = n;
+	}
+
+	unsigned a, b, c, d, size;
+	if (!search(&a, &b, &c, &d, &size)) {
+		fprintf(stderr, "no perfect hash found: increase MAX_SLOTS or MAX_MULTIPLIER\n");
+		return EXIT_FAILURE;
+	}
+
+	int slot[MAX_SLOTS];
+	for (unsigned i = 0; i < size; ++i) slot[i] = -1;
+	for (size_t i = 0; i < NUM_KEYWORDS; ++i) slot[hash(keywords[i].name, a, b, c, d, size - 1)] = (int)i;
+
+	printf("//\n");
+	printf("//  sql3keywordhash.h\n");
+	printf("//\n");
+	printf("//  Generated by tools/mkkeywordhash.c, do not edit by hand.\n");
+	printf("//\n\n");
+	printf("#define SQL3KEYWORD_WIDTH           %d\n", KEYWORD_WIDTH);
+	printf("#define SQL3KEYWORD_MINLEN          2\n");
+	printf("#define SQL3KEYWORD_MAXLEN          %zu\n", maxlen);
+	printf("#define SQL3KEYWORD_HASH(s,n)       ((((unsigned)(s)[0]*%u) + ((unsigned)(s)[1]*%u) + ((unsigned)(s)[(n)-1]*%u) + ((unsigned)(n)*%u)) & %u)\n\n", a, b, c, d, size - 1);
+
+	printf("// keywords padded with zeros to SQL3KEYWORD_WIDTH bytes\n");
+	printf("static const char sql3keyword_text[%zu][SQL3KEYWORD_WIDTH] = {\n", NUM_KEYWORDS);
+	for (size_t i = 0; i < NUM_KEYWORDS; ++i) printf("\t\"%s\"%s\n", keywords[i].name, (i + 1 < NUM_KEYWORDS) ? "," : "");
+	printf("};\n\n");
+
+	printf("static const sql3token_t sql3keyword_token[%zu] = {\n", NUM_KEYWORDS);
+	for (size_t i = 0; i < NUM_KEYWORDS; ++i) printf("\t%s%s\n", keywords[i].token, (i + 1 < NUM_KEYWORDS) ? "," : "");
+	printf("};\n\n");
+
+	printf("// hash slot => 1 + index inside sql3keyword_text (0 means no keyword)\n");
+	printf("static const unsigned char sql3keyword_slot[%u] = {", size);
+	for (unsigned i = 0; i < size; ++i) {
+		printf("%s%d%s", (i % 16 == 0) ? "\n\t" : " ", slot[i] + 1, (i + 1 < size) ? "," : "");
+	}
+	printf("\n};\n");
+
+	return EXIT_SUCCESS;
+}